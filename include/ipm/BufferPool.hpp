@@ -0,0 +1,70 @@
+/**
+ * @file BufferPool.hpp BufferPool Class Interface
+ *
+ * BufferPool keeps released message buffers, sorted into power-of-two size classes, so that they can be handed out
+ * again instead of allocating a new buffer for every received message. It is safe to acquire and release buffers
+ * from different threads.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef IPM_INCLUDE_IPM_BUFFERPOOL_HPP_
+#define IPM_INCLUDE_IPM_BUFFERPOOL_HPP_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+namespace dunedaq::ipm {
+
+class BufferPool
+{
+public:
+  static constexpr size_t s_min_class_bits = 8;  // Buffers smaller than 256 bytes are cheap enough to allocate
+  static constexpr size_t s_max_class_bits = 26; // Buffers larger than 64 MiB are not kept
+  static constexpr size_t s_default_max_bytes_held = 256 * 1024 * 1024;
+
+  explicit BufferPool(size_t max_bytes_held = s_default_max_bytes_held)
+    : m_max_bytes_held(max_bytes_held)
+  {}
+
+  BufferPool(const BufferPool&) = delete;
+  BufferPool& operator=(const BufferPool&) = delete;
+  BufferPool(BufferPool&&) = delete;
+  BufferPool& operator=(BufferPool&&) = delete;
+
+  // Returns an empty buffer with a capacity of at least size, reusing a pooled one if possible
+  std::vector<char> acquire(size_t size);
+
+  // Takes a buffer back for reuse. Buffers outside the pooled size range, or which would take the pool over its
+  // limit, are freed instead.
+  void release(std::vector<char>&& buffer);
+
+  // Counts of acquire() calls served from the pool (hits) and by allocating (misses) since the last call
+  size_t take_hits() noexcept { return m_hits.exchange(0); }
+  size_t take_misses() noexcept { return m_misses.exchange(0); }
+
+  // Total capacity of the buffers currently held for reuse
+  size_t bytes_held() const noexcept { return m_bytes_held.load(); }
+
+private:
+  struct SizeClass
+  {
+    std::mutex mutex;
+    std::vector<std::vector<char>> buffers;
+  };
+
+  std::array<SizeClass, s_max_class_bits - s_min_class_bits + 1> m_classes;
+  size_t m_max_bytes_held;
+  std::atomic<size_t> m_bytes_held{ 0 };
+  std::atomic<size_t> m_hits{ 0 };
+  std::atomic<size_t> m_misses{ 0 };
+};
+
+} // namespace dunedaq::ipm
+
+#endif // IPM_INCLUDE_IPM_BUFFERPOOL_HPP_
@@ -0,0 +1,78 @@
+/**
+ * @file LatencyHistogram.hpp LatencyHistogram Class Interface
+ *
+ * LatencyHistogram counts durations into logarithmic buckets (four per power of two, so any recorded value is known
+ * to within 25%) using relaxed atomic increments, so that it can be fed from the send and receive paths of several
+ * threads without locking. Percentiles are read out, and the histogram reset, when opmon data is generated.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef IPM_INCLUDE_IPM_LATENCYHISTOGRAM_HPP_
+#define IPM_INCLUDE_IPM_LATENCYHISTOGRAM_HPP_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace dunedaq::ipm {
+
+class LatencyHistogram
+{
+public:
+  static constexpr size_t s_sub_bucket_bits = 2;
+  static constexpr size_t s_bucket_count = (64 - s_sub_bucket_bits + 1) << s_sub_bucket_bits;
+
+  // Percentiles of the durations recorded since the last take(), in microseconds. All zero if nothing was recorded.
+  struct Summary
+  {
+    uint64_t count{ 0 };
+    double p50_us{ 0 };
+    double p90_us{ 0 };
+    double p99_us{ 0 };
+    double max_us{ 0 };
+  };
+
+  template<typename Rep, typename Period>
+  void record(std::chrono::duration<Rep, Period> duration) noexcept
+  {
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+    record_ns(ns > 0 ? static_cast<uint64_t>(ns) : 0);
+  }
+
+  void record_ns(uint64_t ns) noexcept
+  {
+    m_buckets[bucket_index(ns)].fetch_add(1, std::memory_order_relaxed);
+    auto max = m_max_ns.load(std::memory_order_relaxed);
+    while (ns > max && !m_max_ns.compare_exchange_weak(max, ns, std::memory_order_relaxed)) {
+    }
+  }
+
+  // Summarize the recorded durations and start again from an empty histogram. Durations recorded concurrently with
+  // this call are counted either in this summary or in the next one.
+  Summary take() noexcept;
+
+  // Bucket which a duration of ns nanoseconds is counted in, and the largest duration counted in a bucket
+  static size_t bucket_index(uint64_t ns) noexcept
+  {
+    if (ns < (uint64_t(1) << s_sub_bucket_bits)) {
+      return ns;
+    }
+    size_t msb = 63 - __builtin_clzll(ns);
+    size_t sub_bucket = (ns >> (msb - s_sub_bucket_bits)) & ((size_t(1) << s_sub_bucket_bits) - 1);
+    return ((msb - s_sub_bucket_bits + 1) << s_sub_bucket_bits) + sub_bucket;
+  }
+  static uint64_t bucket_upper_ns(size_t index) noexcept;
+
+private:
+  std::array<std::atomic<uint64_t>, s_bucket_count> m_buckets{};
+  std::atomic<uint64_t> m_max_ns{ 0 };
+};
+
+} // namespace dunedaq::ipm
+
+#endif // IPM_INCLUDE_IPM_LATENCYHISTOGRAM_HPP_
@@ -34,6 +34,19 @@ const std::map<IpmPluginType, std::string> ZmqPluginNames{ { IpmPluginType::Send
                                                            { IpmPluginType::Publisher, "ZmqPublisher" },
                                                            { IpmPluginType::Subscriber, "ZmqSubscriber" } };
 
+// Shared-memory transport for a sender and a receiver on the same host
+const std::map<IpmPluginType, std::string> ShmPluginNames{ { IpmPluginType::Sender, "ShmSender" },
+                                                           { IpmPluginType::Receiver, "ShmReceiver" } };
+
+// Lock-free transport for a sender and a receiver in the same process, bypassing ZMQ
+const std::map<IpmPluginType, std::string> InprocPluginNames{ { IpmPluginType::Sender, "InprocSender" },
+                                                              { IpmPluginType::Receiver, "InprocReceiver" } };
+
+// Decorators packing many small messages into one message of another plugin, named by "inner_plugin". The sender
+// reports a message as sent once it is in a batch; batches it cannot send before it is destroyed are lost.
+const std::map<IpmPluginType, std::string> CoalescingPluginNames{ { IpmPluginType::Sender, "CoalescingSender" },
+                                                                  { IpmPluginType::Receiver, "CoalescingReceiver" } };
+
 std::string
 get_recommended_plugin_name(IpmPluginType type)
 {
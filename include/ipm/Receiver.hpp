@@ -23,6 +23,9 @@
 #ifndef IPM_INCLUDE_IPM_RECEIVER_HPP_
 #define IPM_INCLUDE_IPM_RECEIVER_HPP_
 
+#include "ipm/BufferPool.hpp"
+#include "ipm/LatencyHistogram.hpp"
+
 #include "cetlib/BasicPluginFactory.h"
 #include "cetlib/compiler_macros.h"
 #include "ers/Issue.hpp"
@@ -30,8 +33,12 @@
 #include "opmonlib/MonitorableObject.hpp"
 
 #include <atomic>
+#include <functional>
 #include <memory>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
 namespace dunedaq {
@@ -40,7 +47,7 @@ ERS_DECLARE_ISSUE(ipm, KnownStateForbidsReceive, "Receiver not in a state to rec
 ERS_DECLARE_ISSUE(ipm,
                   UnexpectedNumberOfBytes,
                   "Expected " << bytes1 << " bytes in message but received " << bytes2,
-                  ((int)bytes1)((int)bytes2)) // NOLINT
+                  ((size_t)bytes1)((size_t)bytes2)) // NOLINT
 ERS_DECLARE_ISSUE(ipm,
                   ReceiveTimeoutExpired,
                   "Unable to receive within timeout period (timeout period was " << timeout << " milliseconds)",
@@ -67,6 +74,8 @@ ERS_DECLARE_ISSUE(ipm,
 
 namespace dunedaq::ipm {
 
+class CallbackAdapter;
+
   class Receiver : public opmonlib::MonitorableObject
 {
 
@@ -75,7 +84,7 @@ public:
   static constexpr duration_t s_block = duration_t::max();
   static constexpr duration_t s_no_block = duration_t::zero();
 
-  using message_size_t = int;
+  using message_size_t = size_t;
   static constexpr message_size_t s_any_size =
     0; // Since "I want 0 bytes" is pointless, "0" denotes "I don't care about the size"
 
@@ -99,9 +108,81 @@ public:
 
   Response receive(const duration_t& timeout, message_size_t num_bytes = s_any_size, bool no_tmoexcept_mode = false);
 
+  // Receive up to max_count messages into responses, waiting up to timeout for the first one and then taking only
+  // those already queued. responses is resized to the number received (which is returned); reusing the same vector
+  // across calls lets its storage and the buffers of its elements be reused. Same checks as receive(), applied to
+  // every message; ReceiveTimeoutExpired is only thrown if nothing at all was received.
+  size_t receive_many(std::vector<Response>& responses,
+                      size_t max_count,
+                      const duration_t& timeout,
+                      message_size_t num_bytes = s_any_size,
+                      bool no_tmoexcept_mode = false);
+
+  // The outcome of receive_into: the message's metadata and its full size. If the message was bigger than the
+  // destination, only the first capacity bytes were copied and truncated is set; the rest of the message is dropped.
+  struct IntoResponse
+  {
+    std::string metadata{ "" };
+    size_t size{ 0 };
+    bool truncated{ false };
+  };
+
+  // Receive a message directly into dst, which has room for capacity bytes, instead of into a new Response. Same
+  // checks as receive(); the UnexpectedNumberOfBytes check is made against the full size of the message.
+  IntoResponse receive_into(void* dst,
+                            size_t capacity,
+                            const duration_t& timeout,
+                            message_size_t num_bytes = s_any_size,
+                            bool no_tmoexcept_mode = false);
+
+  // Hand back a Response which is no longer needed, so that its buffer can be reused for a later message instead of
+  // allocating a new one. Optional; CallbackAdapter-driven callbacks do this automatically once the callback returns.
+  void release(Response&& response) { m_buffer_pool.release(std::move(response.data)); }
+
+  // A received message whose storage is still owned by the transport. data() and metadata() stay valid for as long
+  // as the view (or a copy of it) is alive, so consumers can deserialize in place without paying for a copy.
+  class ResponseView
+  {
+  public:
+    ResponseView() = default;
+    ResponseView(std::shared_ptr<const void> owner, const char* data, size_t size, std::string_view metadata)
+      : m_owner(std::move(owner))
+      , m_data(data)
+      , m_size(size)
+      , m_metadata(metadata)
+    {}
+    explicit ResponseView(Response&& response);
+
+    const char* data() const noexcept { return m_data; }
+    size_t size() const noexcept { return m_size; }
+    std::string_view metadata() const noexcept { return m_metadata; }
+    bool empty() const noexcept { return m_size == 0 && m_metadata.empty(); }
+
+  private:
+    std::shared_ptr<const void> m_owner{ nullptr };
+    const char* m_data{ nullptr };
+    size_t m_size{ 0 };
+    std::string_view m_metadata{};
+  };
+
+  // Same checks as receive(), but the message is not copied out of the transport
+  ResponseView receive_view(const duration_t& timeout,
+                            message_size_t num_bytes = s_any_size,
+                            bool no_tmoexcept_mode = false);
+
   virtual void register_callback(std::function<void(Response&)>) = 0;
   virtual void unregister_callback() = 0;
 
+  // Implementations able to dispatch ResponseViews directly should override this; by default the callback is
+  // adapted onto register_callback
+  virtual void register_view_callback(std::function<void(ResponseView&)> callback);
+
+  // Block until a message is ready to be received, the timeout expires, or wakeup_fd (if non-negative) becomes
+  // readable, and return whether a message may be ready. Used to drive callbacks without polling. Implementations
+  // which can wait on their transport should override this; by default receive_ is called with the timeout (in
+  // slices of s_wait_slice, checking wakeup_fd in between) and the message it returns is kept for the next receive.
+  virtual bool wait_for_message(const duration_t& timeout, int wakeup_fd);
+
   Receiver(const Receiver&) = delete;
   Receiver& operator=(const Receiver&) = delete;
 
@@ -114,9 +195,70 @@ protected:
   
   virtual Response receive_(const duration_t& timeout, bool no_tmoexcept_mode) = 0;
 
+  // Implementations which can hand out their receive buffers should override this; by default the Response returned
+  // by receive_ is wrapped
+  virtual ResponseView receive_view_(const duration_t& timeout, bool no_tmoexcept_mode);
+
+  // Implementations which can copy straight out of their transport should override this; by default the Response
+  // returned by receive_ is copied into dst and its buffer released for reuse. Must not copy more than capacity bytes.
+  virtual IntoResponse receive_into_(void* dst, size_t capacity, const duration_t& timeout, bool no_tmoexcept_mode);
+
+  // Fill responses[0, n) (responses holds at least max_count elements) and return n. Must not throw
+  // ReceiveTimeoutExpired. By default receive_ is called until it comes back empty.
+  virtual size_t receive_many_(std::vector<Response>& responses, size_t max_count, const duration_t& timeout);
+
+  // Implementations should build the Responses they return from receive_ with this, so that buffers handed back
+  // through release() are reused. The data member is empty, with room for data_size bytes.
+  Response make_response_(size_t data_size)
+  {
+    Response response;
+    response.data = m_buffer_pool.acquire(data_size);
+    return response;
+  }
+
 private:
+  // CallbackAdapter reports how long the registered callbacks take, and the exceptions they throw, and receives
+  // without counting its empty polls
+  friend class CallbackAdapter;
+
   mutable std::atomic<size_t> m_bytes = { 0 };
   mutable std::atomic<size_t> m_messages = { 0 };
+  mutable std::atomic<size_t> m_receive_timeouts = { 0 };
+  // Non-blocking receive calls made by the user which found no message. The empty receive with which CallbackAdapter
+  // finds that it has drained the transport is not one of them.
+  mutable std::atomic<size_t> m_empty_polls = { 0 };
+  mutable std::atomic<size_t> m_callback_exceptions = { 0 };
+  BufferPool m_buffer_pool;
+  LatencyHistogram m_receive_time;
+  LatencyHistogram m_callback_time;
+
+  // The message the default wait_for_message received to find out that one was ready, which the next receive call
+  // returns. The longest it calls receive_ for before checking its wakeup_fd again.
+  std::optional<Response> m_waited_message;
+  static constexpr duration_t s_wait_slice{ 100 };
+
+  Response take_waited_message_();
+  IntoResponse copy_into_(Response&& message, void* dst, size_t capacity);
+
+  // receive() and receive_view(), counting an empty non-blocking call in m_empty_polls only if count_empty_poll is set
+  Response receive_and_count_(const duration_t& timeout,
+                              message_size_t num_bytes,
+                              bool no_tmoexcept_mode,
+                              bool count_empty_poll);
+  ResponseView receive_view_and_count_(const duration_t& timeout,
+                                       message_size_t num_bytes,
+                                       bool no_tmoexcept_mode,
+                                       bool count_empty_poll);
+
+  // Count a receive call which came back without a message
+  void count_no_message_(const duration_t& timeout, bool count_empty_poll = true) noexcept
+  {
+    if (timeout != s_no_block) {
+      ++m_receive_timeouts;
+    } else if (count_empty_poll) {
+      ++m_empty_polls;
+    }
+  }
 };
 
 inline std::shared_ptr<Receiver>
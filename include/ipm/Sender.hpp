@@ -14,6 +14,8 @@
  *
  * - Meaningfully implement the timeout feature in send_, and have it
  *   throw the SendTimeoutExpired exception if it occurs
+ * - Call stop_async_sends in their destructor, so that send_async's thread
+ *   does not call send_ on a partly-destroyed object
  *
  * This is part of the DUNE DAQ Application Framework, copyright 2020.
  * Licensing/copyright details are in the COPYING file that you should have
@@ -23,6 +25,8 @@
 #ifndef IPM_INCLUDE_IPM_SENDER_HPP_
 #define IPM_INCLUDE_IPM_SENDER_HPP_
 
+#include "ipm/LatencyHistogram.hpp"
+
 #include "cetlib/BasicPluginFactory.h"
 #include "cetlib/compiler_macros.h"
 #include "ers/Issue.hpp"
@@ -30,14 +34,27 @@
 #include "opmonlib/MonitorableObject.hpp"
 
 #include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <future>
+#include <limits>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace dunedaq {
 // Disable coverage collection LCOV_EXCL_START
 ERS_DECLARE_ISSUE(ipm, KnownStateForbidsSend, "Sender not in a state to send data", )
 ERS_DECLARE_ISSUE(ipm, NullPointerPassedToSend, "An null pointer to memory was passed to Sender::send", )
+ERS_DECLARE_ISSUE(ipm,
+                  InvalidMessageSize,
+                  "A message size of " << size << " bytes was passed to Sender::send (a negative size converted to "
+                                       << "message_size_t?)",
+                  ((size_t)size)) // NOLINT
 ERS_DECLARE_ISSUE(ipm,
                   SendTimeoutExpired,
                   "Unable to send within timeout period (timeout period was " << timeout << " milliseconds)",
@@ -65,6 +82,9 @@ ERS_DECLARE_ISSUE(ipm,
 
 namespace dunedaq::ipm {
 
+class AsyncSendQueue;
+class ZmqSocketSender;
+
   class Sender : public opmonlib::MonitorableObject 
 {
 
@@ -73,10 +93,37 @@ public:
   static constexpr duration_t s_block = duration_t::max();
   static constexpr duration_t s_no_block = duration_t::zero();
 
-  using message_size_t = int;
+  using message_size_t = size_t;
+  // No object can be larger than this. Sizes above it, such as a negative int converted to message_size_t, are
+  // rejected with InvalidMessageSize.
+  static constexpr message_size_t s_max_message_size = std::numeric_limits<std::ptrdiff_t>::max();
+
+  // Buffers handed over to send() are released through their deleter once the transport is done with them
+  using buffer_deleter_t = std::function<void(char*)>;
+  using owned_buffer_t = std::unique_ptr<char[], buffer_deleter_t>;
+
+  // One piece of a message sent with send_segments(); the data only needs to stay valid for the call
+  struct Segment
+  {
+    const void* data;
+    message_size_t size;
+  };
+
+  // One message of a batch; the pointed-to payload and metadata only need to stay valid for the send_batch() call
+  struct BatchEntry
+  {
+    const void* message;
+    message_size_t size;
+    std::string_view metadata;
+  };
+
+  // Called once for each message given to send_async: whether it was sent, and the exception send() threw, if any
+  using async_callback_t = std::function<void(bool sent, std::exception_ptr error)>;
+  static constexpr size_t s_default_async_queue_capacity = 1024;
 
-  Sender() = default;
-  virtual ~Sender() = default;
+  // Defined with the library, where AsyncSendQueue is complete
+  Sender();
+  virtual ~Sender();
 
   virtual std::string connect_for_sends(const nlohmann::json& connection_info) = 0;
 
@@ -84,6 +131,7 @@ public:
 
   // send() will perform some universally-desirable checks before calling user-implemented send_()
   // -Throws KnownStateForbidsSend if can_send() == false
+  // -Throws InvalidMessageSize if message_size > s_max_message_size
   // -Throws NullPointerPassedToSend if message is a null pointer
   // -If message_size == 0, function is a no-op
 
@@ -93,6 +141,78 @@ public:
             std::string const& metadata = "",
             bool no_tmoexcept_mode = false);
 
+  // Zero-copy send: the Sender takes ownership of the buffer and hands it to the transport without copying it.
+  // The same checks as above apply; the buffer is released even if the send fails.
+  bool send(owned_buffer_t message,
+            message_size_t message_size,
+            const duration_t& timeout,
+            std::string const& metadata = "",
+            bool no_tmoexcept_mode = false);
+
+  // Scatter-gather send: the segments are sent as one message, in order, without first being copied into a
+  // contiguous buffer. Receivers see a single message holding the concatenated segments. The same checks as send()
+  // apply, to the total size and to every non-empty segment.
+  bool send_segments(const Segment* segments,
+                     size_t segment_count,
+                     const duration_t& timeout,
+                     std::string const& metadata = "",
+                     bool no_tmoexcept_mode = false);
+  bool send_segments(std::vector<Segment> const& segments,
+                     const duration_t& timeout,
+                     std::string const& metadata = "",
+                     bool no_tmoexcept_mode = false)
+  {
+    return send_segments(segments.data(), segments.size(), timeout, metadata, no_tmoexcept_mode);
+  }
+
+  // Send several messages in order, checking state once and sharing one timeout budget between them.
+  // Returns the number of leading entries which were accepted; the rest were not sent. Entries of size 0 are
+  // accepted without being sent. Throws SendTimeoutExpired if not all entries were accepted, unless
+  // no_tmoexcept_mode is set.
+  size_t send_batch(const BatchEntry* entries,
+                    size_t count,
+                    const duration_t& timeout,
+                    bool no_tmoexcept_mode = false);
+  size_t send_batch(std::vector<BatchEntry> const& entries,
+                    const duration_t& timeout,
+                    bool no_tmoexcept_mode = false)
+  {
+    return send_batch(entries.data(), entries.size(), timeout, no_tmoexcept_mode);
+  }
+
+  // Asynchronous send: the message is queued, without blocking, for a thread of this Sender which passes it to send()
+  // with the given timeout, so the caller never waits on back-pressure. The future holds send()'s result (false if
+  // the timeout expired) or the exception it threw. If the queue is full the message is dropped and the future is
+  // ready at once with false. The checks of send() are made before queueing.
+  // Messages are sent in the order they were queued. Do not also call the other send functions at the same time
+  // from other threads: for transports such as ZMQ sockets they are not thread-safe.
+  std::future<bool> send_async(owned_buffer_t message,
+                               message_size_t message_size,
+                               const duration_t& timeout,
+                               std::string const& metadata = "");
+  // As above, copying the message first
+  std::future<bool> send_async(const void* message,
+                               message_size_t message_size,
+                               const duration_t& timeout,
+                               std::string const& metadata = "");
+  // As above, reporting through a callback instead of a future. The callback is called from the async thread, or at
+  // once from this one if the message could not be queued, and must not call flush_async.
+  void send_async(owned_buffer_t message,
+                  message_size_t message_size,
+                  const duration_t& timeout,
+                  std::string const& metadata,
+                  async_callback_t callback);
+
+  // Number of messages send_async can hold; takes effect when its thread starts, on the first send_async call
+  void set_async_queue_capacity(size_t capacity) { m_async_queue_capacity = capacity; }
+
+  // Waits up to timeout for all messages given to send_async so far to complete. Returns false if the timeout expired.
+  bool flush_async(const duration_t& timeout);
+
+  // Stops send_async's thread once the send in progress returns. Messages still queued, and any given to send_async
+  // afterwards, complete with false.
+  void stop_async_sends();
+
   Sender(const Sender&) = delete;
   Sender& operator=(const Sender&) = delete;
 
@@ -109,9 +229,62 @@ protected:
                      std::string const& metadata,
                      bool no_tmoexcept_mode) = 0;
 
+  // Implementations which can transmit a buffer in place should override this; by default the payload is copied
+  // via send_ and the buffer released afterwards
+  virtual bool send_owned_(owned_buffer_t message,
+                           message_size_t N,
+                           const duration_t& timeout,
+                           std::string const& metadata,
+                           bool no_tmoexcept_mode);
+
+  // Implementations which can transmit the segments separately should override this; by default they are assembled
+  // into one buffer and passed to send_. N is the total size of the segments.
+  virtual bool send_segments_(const Segment* segments,
+                              size_t segment_count,
+                              message_size_t N,
+                              const duration_t& timeout,
+                              std::string const& metadata,
+                              bool no_tmoexcept_mode);
+
+  // Implementations which can push several messages into the transport more cheaply than one send_ call each
+  // should override this. Must not throw SendTimeoutExpired; return the number of entries accepted instead.
+  virtual size_t send_batch_(const BatchEntry* entries, size_t count, const duration_t& timeout);
+
+  // Implementations report the time send_ spent blocked waiting for the transport to accept a message
+  template<typename Rep, typename Period>
+  void add_send_wait_time(std::chrono::duration<Rep, Period> wait_time) noexcept
+  {
+    if (wait_time.count() > 0) {
+      m_wait_time_us += std::chrono::duration_cast<std::chrono::microseconds>(wait_time).count();
+    }
+  }
+
+  // Implementations report each attempt to hand a message to the transport after the previous one was refused,
+  // and each multipart message which the transport stopped accepting part of the way through
+  void add_send_retry() noexcept { ++m_send_retries; }
+  void add_partial_multipart_failure() noexcept { ++m_partial_multipart_failures; }
+
 private:
+  // ZmqSocketSender reports the retries, wait time and partial multipart failures of the ZMQ Senders using it
+  friend class ZmqSocketSender;
+
   mutable std::atomic<size_t> m_bytes = { 0 };
   mutable std::atomic<size_t> m_messages = { 0 };
+  mutable std::atomic<size_t> m_wait_time_us = { 0 };
+  mutable std::atomic<size_t> m_send_timeouts = { 0 };
+  mutable std::atomic<size_t> m_send_retries = { 0 };
+  mutable std::atomic<size_t> m_partial_multipart_failures = { 0 };
+  LatencyHistogram m_send_time;
+
+  AsyncSendQueue& async_queue_();
+  static void check_message_size_(message_size_t message_size);
+  void check_async_send_(const void* message, message_size_t message_size) const;
+
+  // Created on first use and only destroyed with the Sender, so that send_async can reach it without taking the lock
+  size_t m_async_queue_capacity{ s_default_async_queue_capacity };
+  std::mutex m_async_mutex;
+  std::unique_ptr<AsyncSendQueue> m_async_queue;
+  std::atomic<AsyncSendQueue*> m_async_queue_ptr{ nullptr };
 };
 
 inline std::shared_ptr<Sender>
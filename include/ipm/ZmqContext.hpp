@@ -14,6 +14,11 @@
 #include "logging/Logging.hpp"
 #include "zmq.hpp"
 
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
 namespace dunedaq {
 
 /**
@@ -42,7 +47,7 @@ ERS_DECLARE_ISSUE(ipm,
 ERS_DECLARE_ISSUE(ipm,
                   ZmqSendError,
                   "An exception occurred while sending " << N << " bytes to " << topic << ": " << what,
-                  ((const char*)what)((int)N)((std::string)topic)) // NOLINT
+                  ((const char*)what)((size_t)N)((std::string)topic)) // NOLINT
                                                                    /// @endcond LCOV_EXCL_STOP
 
 /**
@@ -81,18 +86,40 @@ ERS_DECLARE_ISSUE(ipm,
                   ((const char*)what)((std::string)topic)) // NOLINT
 /// @endcond LCOV_EXCL_STOP
 
+/**
+ * @brief An ERS Error indicating that a ZmqContext IO thread setting could not be applied
+ * @param setting The setting (or environment variable) concerned
+ * @param reason Why it was rejected
+ * @cond Doxygen doesn't like ERS macros LCOV_EXCL_START
+ */
+ERS_DECLARE_ISSUE(ipm,
+                  ZmqContextSettingError,
+                  "Unable to apply ZMQ context setting " << setting << ": " << reason,
+                  ((std::string)setting)((std::string)reason)) // NOLINT
+/// @endcond LCOV_EXCL_STOP
+
 namespace ipm {
 class ZmqContext
 {
 public:
-  static ZmqContext& instance()
+  // Defined in the library rather than inline, so that applications and the plugins they load share one context
+  static ZmqContext& instance();
+
+  // The context called name, with IO threads of its own, created on first use; the empty name gives instance().
+  // The ZMQ plugins use the context named by "zmq_context" in their connection_info. A named context reads the same
+  // environment variables as the default one, with "_<NAME>" appended (NAME upper-cased, with any character other
+  // than a letter or digit replaced by '_'), for example IPM_ZMQ_IO_THREADS_NUMA1. Unless its affinity is given that
+  // way, a context named "numa<N>" runs its IO threads on the CPUs of NUMA node N.
+  static ZmqContext& instance(std::string const& name);
+
+  std::string const& name() const { return m_name; }
+
+  zmq::context_t& GetContext()
   {
-    static ZmqContext s_ctx;
-    return s_ctx;
+    m_context_used = true;
+    return m_context;
   }
 
-  zmq::context_t& GetContext() { return m_context; }
-
   void set_context_threads(int nthreads) { 
       TLOG_DEBUG(10) << "Setting ZMQ Context IO thread count to " << nthreads;
       m_context.set(zmq::ctxopt::io_threads, nthreads); }
@@ -100,10 +127,28 @@ public:
       TLOG_DEBUG(10) << "Setting ZMQ Context max sockets to " << max_sockets;
       m_context.set(zmq::ctxopt::max_sockets, max_sockets); }
 
+  // ZMQ applies the IO thread settings below when it starts its IO threads, which it does when the first socket is
+  // created, so they must be made before any ZMQ Sender or Receiver using the context connects (the plugins create
+  // their sockets then). Each throws ZmqContextSettingError if the setting is invalid or could not be honoured by the
+  // IO threads (for example, a real-time policy without the privilege for it), since ZMQ would otherwise abort when
+  // starting them.
+
+  // Restrict the IO threads to the given CPUs; an empty list lifts the restriction
+  void set_io_thread_affinity(std::vector<int> const& cpus);
+  // Run the IO threads under a scheduling policy (SCHED_OTHER, SCHED_BATCH, SCHED_IDLE, SCHED_FIFO or SCHED_RR).
+  // priority is the static priority for SCHED_FIFO and SCHED_RR, and must be 0 for the other policies.
+  void set_io_thread_scheduling(int policy, int priority);
+  // Name the IO threads "<prefix>/ZMQbg/IO/<n>" instead of "ZMQbg/IO/<n>"
+  void set_io_thread_name_prefix(int prefix);
+
+  // CPUs the IO threads are restricted to, empty if they are not
+  std::set<int> const& io_thread_affinity() const { return m_io_thread_cpus; }
+
 private:
-  ZmqContext()
+  explicit ZmqContext(std::string const& name = "")
+    : m_name(name)
   {
-    auto threads_c = getenv("IPM_ZMQ_IO_THREADS");
+    auto threads_c = getenv_("IPM_ZMQ_IO_THREADS");
     if (threads_c != nullptr) {
       auto threads = std::atoi(threads_c);
       if (threads > 1) {
@@ -112,7 +157,7 @@ private:
     }
 
     bool sockets_set = false;
-    auto sockets_c = getenv("IPM_ZMQ_MAX_SOCKETS");
+    auto sockets_c = getenv_("IPM_ZMQ_MAX_SOCKETS");
     if (sockets_c != nullptr) {
       auto sockets = std::atoi(sockets_c);
       if (sockets > s_minimum_sockets) {
@@ -123,10 +168,24 @@ private:
     if(!sockets_set) {
       set_context_maxsockets(s_minimum_sockets);
     }
-    
+
+    configure_io_threads_from_environment_();
   }
   ~ZmqContext() { m_context.close(); }
+  friend struct std::default_delete<ZmqContext>;
+
+  // The value of variable for this context, with the context name appended for named contexts
+  const char* getenv_(std::string const& variable) const;
+  // Apply IPM_ZMQ_IO_THREAD_AFFINITY (a CPU list such as "2,4-7"), IPM_ZMQ_IO_THREAD_SCHED_POLICY (a policy name
+  // such as "SCHED_FIFO" or "FIFO"), IPM_ZMQ_IO_THREAD_PRIORITY and IPM_ZMQ_IO_THREAD_NAME_PREFIX, or the NUMA node
+  // affinity of a "numa<N>" context. Invalid values are reported as warnings and ignored.
+  void configure_io_threads_from_environment_();
+  void warn_if_started_(std::string const& setting) const;
+
+  std::string m_name;
   zmq::context_t m_context;
+  bool m_context_used{ false };
+  std::set<int> m_io_thread_cpus;
   static constexpr int s_minimum_sockets = 16636;
 
   ZmqContext(ZmqContext const&) = delete;
@@ -0,0 +1,181 @@
+/**
+ *
+ * @file CoalescingReceiver.cpp CoalescingReceiver messaging class definitions
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "CallbackAdapter.hpp"
+#include "CoalescedBatch.hpp"
+#include "ipm/Subscriber.hpp"
+#include "ipm/opmon/ipm.pb.h"
+
+#include "logging/Logging.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace dunedaq {
+namespace ipm {
+
+// Receives through another Receiver plugin ("inner_plugin" in the connection_info, ZmqReceiver by default, which is
+// given the rest of the connection_info) and hands out the messages packed into each batch by a CoalescingSender one
+// at a time, each with the metadata of its batch. Messages which are not batches (whose metadata does not end in
+// CoalescedBatch::s_metadata_suffix) are passed on as they are, whatever their payload. With a Subscriber as the inner
+// plugin, subscriptions are passed on to it.
+class CoalescingReceiver : public Subscriber
+{
+public:
+  ~CoalescingReceiver() { unregister_callback(); }
+
+  std::string connect_for_receives(const nlohmann::json& connection_info) override
+  {
+    auto inner_plugin = connection_info.value<std::string>("inner_plugin", "ZmqReceiver");
+    if (inner_plugin == "CoalescingReceiver") {
+      throw CoalescingError(ERS_HERE, "A CoalescingReceiver cannot wrap another CoalescingReceiver");
+    }
+    if (m_inner == nullptr) {
+      m_inner = make_ipm_receiver(inner_plugin);
+      m_inner_subscriber = std::dynamic_pointer_cast<Subscriber>(m_inner);
+      if (m_inner_subscriber != nullptr) {
+        for (auto& topic : m_subscriptions) {
+          m_inner_subscriber->subscribe(topic);
+        }
+      } else if (!m_subscriptions.empty()) {
+        throw CoalescingError(ERS_HERE, inner_plugin + " does not support subscriptions");
+      }
+    }
+    auto endpoint = m_inner->connect_for_receives(connection_info);
+    TLOG() << "Unpacking coalesced messages received by " << inner_plugin << " at " << endpoint;
+
+    m_callback_adapter.configure_from(connection_info);
+    m_callback_adapter.set_receiver(this);
+    return endpoint;
+  }
+
+  bool can_receive() const noexcept override { return m_inner != nullptr && m_inner->can_receive(); }
+
+  void subscribe(std::string const& topic) override
+  {
+    if (m_inner != nullptr) {
+      if (m_inner_subscriber == nullptr) {
+        throw CoalescingError(ERS_HERE, "The inner receiver does not support subscriptions");
+      }
+      m_inner_subscriber->subscribe(topic);
+    }
+    m_subscriptions.insert(topic);
+  }
+  void unsubscribe(std::string const& topic) override
+  {
+    if (m_inner_subscriber != nullptr) {
+      m_inner_subscriber->unsubscribe(topic);
+    }
+    auto subscription = m_subscriptions.find(topic);
+    if (subscription != m_subscriptions.end()) {
+      m_subscriptions.erase(subscription);
+    }
+  }
+
+  void register_callback(std::function<void(Response&)> callback) override
+  {
+    m_callback_adapter.set_callback(callback);
+  }
+  void unregister_callback() override { m_callback_adapter.clear_callback(); }
+  void register_view_callback(std::function<void(ResponseView&)> callback) override
+  {
+    m_callback_adapter.set_view_callback(callback);
+  }
+
+  bool wait_for_message(const duration_t& timeout, int wakeup_fd) override
+  {
+    {
+      std::lock_guard<std::mutex> lk(m_mutex);
+      if (!m_pending.empty()) {
+        return true;
+      }
+    }
+    return m_inner->wait_for_message(timeout, wakeup_fd);
+  }
+
+protected:
+  void generate_opmon_data() override
+  {
+    Receiver::generate_opmon_data();
+    opmon::CoalescingInfo info;
+    info.set_batches(m_batches.exchange(0));
+    info.set_messages(m_batched_messages.exchange(0));
+    publish(std::move(info));
+  }
+
+  Receiver::Response receive_(const duration_t& timeout, bool no_tmoexcept_mode) override
+  {
+    auto start_time = std::chrono::steady_clock::now();
+    while (true) {
+      {
+        std::lock_guard<std::mutex> lk(m_mutex);
+        if (!m_pending.empty()) {
+          auto output = std::move(m_pending.front());
+          m_pending.pop_front();
+          return output;
+        }
+      }
+
+      // A batch may hold no messages, in which case keep waiting for the next one for the rest of the timeout. The
+      // lock is not held while waiting, so that other threads can take messages already unpacked meanwhile.
+      auto remaining = timeout;
+      if (timeout != s_block) {
+        auto elapsed = std::chrono::duration_cast<duration_t>(std::chrono::steady_clock::now() - start_time);
+        remaining = elapsed < timeout ? timeout - elapsed : s_no_block;
+      }
+      auto batch = m_inner->receive(remaining, s_any_size, no_tmoexcept_mode);
+      if (!CoalescedBatch::is_batch_metadata(batch.metadata)) {
+        return batch;
+      }
+      batch.metadata.resize(batch.metadata.size() - CoalescedBatch::s_metadata_suffix.size());
+
+      std::lock_guard<std::mutex> lk(m_mutex);
+      if (!CoalescedBatch::unpack(batch.data.data(), batch.data.size(), m_unpacked)) {
+        ers::error(CoalescingError(ERS_HERE, "Dropped a malformed batch of " + std::to_string(batch.data.size()) +
+                                               " bytes with metadata " + batch.metadata));
+        m_inner->release(std::move(batch));
+        continue;
+      }
+      ++m_batches;
+      m_batched_messages += m_unpacked.size();
+      for (auto& [data, size] : m_unpacked) {
+        auto response = make_response_(size);
+        response.data.assign(data, data + size);
+        response.metadata = batch.metadata;
+        m_pending.push_back(std::move(response));
+      }
+      m_inner->release(std::move(batch));
+    }
+  }
+
+private:
+  std::shared_ptr<Receiver> m_inner;
+  std::shared_ptr<Subscriber> m_inner_subscriber;
+  std::multiset<std::string> m_subscriptions; // Kept to pass on if subscribe is called before connecting
+
+  std::mutex m_mutex; // Guards the messages unpacked but not yet handed out; not held while receiving
+  std::deque<Receiver::Response> m_pending;
+  std::vector<std::pair<const char*, size_t>> m_unpacked;
+  CallbackAdapter m_callback_adapter;
+
+  std::atomic<uint64_t> m_batches{ 0 };
+  std::atomic<uint64_t> m_batched_messages{ 0 };
+};
+
+} // namespace ipm
+} // namespace dunedaq
+
+DEFINE_DUNE_IPM_RECEIVER(dunedaq::ipm::CoalescingReceiver)
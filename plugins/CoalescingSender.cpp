@@ -0,0 +1,254 @@
+/**
+ *
+ * @file CoalescingSender.cpp CoalescingSender messaging class definitions
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "CoalescedBatch.hpp"
+#include "ipm/Sender.hpp"
+#include "ipm/opmon/ipm.pb.h"
+
+#include "logging/Logging.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace dunedaq {
+namespace ipm {
+
+// Packs consecutive sends with the same metadata into one message of another Sender plugin ("inner_plugin" in the
+// connection_info, ZmqSender by default, which is given the rest of the connection_info). A batch is handed over once
+// it holds coalesce_max_messages messages or coalesce_max_bytes bytes, when a message with other metadata is sent, or
+// coalesce_max_delay_us after its first message was added. CoalescingReceiver unpacks the batches.
+//
+// Batches are sent by a background thread, one at a time and in order, while sends go on filling the next batch. The
+// thread keeps retrying a batch (coalesce_flush_timeout_ms per attempt) until it goes, and meanwhile sends which find
+// the next batch full wait for it, up to their own timeout, so back-pressure reaches the callers instead of messages
+// being dropped. A send returns true once its message is in a batch: only batches which still cannot be sent when the
+// sender is destroyed, after one more attempt, are lost, and they are reported as errors.
+class CoalescingSender : public Sender
+{
+public:
+  static constexpr size_t s_default_max_bytes = 64 * 1024;
+  static constexpr size_t s_default_max_messages = 1024;
+  static constexpr int s_default_max_delay_us = 100;
+  static constexpr int s_default_flush_timeout_ms = 1000;
+
+  ~CoalescingSender()
+  {
+    stop_async_sends();
+    {
+      std::lock_guard<std::mutex> lk(m_mutex);
+      m_running = false;
+    }
+    m_cv.notify_all();
+    if (m_flusher.joinable()) {
+      m_flusher.join();
+    }
+  }
+
+  std::string connect_for_sends(const nlohmann::json& connection_info) override
+  {
+    auto inner_plugin = connection_info.value<std::string>("inner_plugin", "ZmqSender");
+    if (inner_plugin == "CoalescingSender") {
+      throw CoalescingError(ERS_HERE, "A CoalescingSender cannot wrap another CoalescingSender");
+    }
+    if (m_inner != nullptr) {
+      throw CoalescingError(ERS_HERE, "A CoalescingSender can only be connected once");
+    }
+    m_max_bytes = connection_info.value<size_t>("coalesce_max_bytes", s_default_max_bytes);
+    m_max_messages = connection_info.value<size_t>("coalesce_max_messages", s_default_max_messages);
+    m_max_delay =
+      std::chrono::microseconds(connection_info.value<int>("coalesce_max_delay_us", s_default_max_delay_us));
+    m_flush_timeout =
+      std::chrono::milliseconds(connection_info.value<int>("coalesce_flush_timeout_ms", s_default_flush_timeout_ms));
+    if (m_max_messages == 0 || m_max_messages > UINT32_MAX) {
+      throw CoalescingError(ERS_HERE, "coalesce_max_messages must be between 1 and 2^32-1");
+    }
+
+    auto inner = make_ipm_sender(inner_plugin);
+    auto endpoint = inner->connect_for_sends(connection_info);
+    TLOG() << "Coalescing sends to " << inner_plugin << " at " << endpoint << " in batches of up to " << m_max_messages
+           << " messages, " << m_max_bytes << " bytes or " << m_max_delay.count() << " us";
+
+    m_inner = inner;
+    m_running = true;
+    m_flusher = std::thread([this]() { flusher_loop_(); });
+    return endpoint;
+  }
+
+  bool can_send() const noexcept override { return m_inner != nullptr && m_inner->can_send(); }
+
+protected:
+  void generate_opmon_data() override
+  {
+    Sender::generate_opmon_data();
+    opmon::CoalescingInfo info;
+    info.set_batches(m_batches.exchange(0));
+    info.set_messages(m_batched_messages.exchange(0));
+    info.set_deadline_flushes(m_deadline_flushes.exchange(0));
+    info.set_dropped_messages(m_dropped_messages.exchange(0));
+    info.set_flush_retries(m_flush_retries.exchange(0));
+    publish(std::move(info));
+  }
+
+  bool send_(const void* message,
+             message_size_t N,
+             const duration_t& timeout,
+             std::string const& metadata,
+             bool no_tmoexcept_mode) override
+  {
+    auto start_time = std::chrono::steady_clock::now();
+    if (CoalescedBatch::is_batch_metadata(metadata)) {
+      throw CoalescingError(ERS_HERE, "Metadata may not end in the suffix which marks batches");
+    }
+
+    std::unique_lock<std::mutex> lk(m_mutex);
+    while (!m_batch.empty() && (metadata != m_batch_metadata || full_(m_batch))) {
+      // The batch being filled has to go before this message can be added: messages with different metadata
+      // (topics) are kept apart, so that subscriptions still apply
+      if (m_outgoing.empty()) {
+        hand_over_();
+        break;
+      }
+
+      // Back-pressure: wait for the batch being sent
+      auto wait_start = std::chrono::steady_clock::now();
+      auto sent = [&] { return m_outgoing.empty(); };
+      if (timeout == s_block) {
+        m_cv.wait(lk, sent);
+      } else if (!m_cv.wait_until(lk, start_time + timeout, sent)) {
+        add_send_wait_time(std::chrono::steady_clock::now() - wait_start);
+        if (!no_tmoexcept_mode) {
+          throw SendTimeoutExpired(ERS_HERE, timeout.count());
+        }
+        return false;
+      }
+      add_send_wait_time(std::chrono::steady_clock::now() - wait_start);
+    }
+
+    if (m_batch.empty()) {
+      m_batch_metadata = metadata;
+      m_deadline = std::chrono::steady_clock::now() + m_max_delay;
+      m_cv.notify_all();
+    }
+    m_batch.append(message, N);
+    if (full_(m_batch) && m_outgoing.empty()) {
+      hand_over_();
+    }
+    return true;
+  }
+
+private:
+  bool full_(CoalescedBatch const& batch) const
+  {
+    return batch.count() >= m_max_messages || batch.bytes() >= m_max_bytes;
+  }
+
+  // Pass the batch being filled to the flusher thread, which must not be sending one. Must hold m_mutex.
+  void hand_over_()
+  {
+    std::swap(m_batch, m_outgoing);
+    std::swap(m_batch_metadata, m_outgoing_metadata);
+    m_batch.clear();
+    m_cv.notify_all();
+  }
+
+  // Send m_outgoing, without holding m_mutex: only the flusher thread touches it until it is cleared. Retries until
+  // the batch goes, or once only when stopping.
+  void send_outgoing_()
+  {
+    auto metadata = CoalescedBatch::batch_metadata(m_outgoing_metadata);
+    bool sent = false;
+    while (true) {
+      try {
+        sent = m_inner->send(m_outgoing.data(), m_outgoing.bytes(), m_flush_timeout, metadata, true);
+      } catch (ers::Issue const& err) {
+        ers::warning(err);
+        // Not a timeout, so give the inner sender a while before trying again
+        std::unique_lock<std::mutex> lk(m_mutex);
+        m_cv.wait_for(lk, m_flush_timeout, [&] { return !m_running; });
+      }
+      if (sent || !m_running) {
+        break;
+      }
+      ++m_flush_retries;
+    }
+
+    if (sent) {
+      ++m_batches;
+      m_batched_messages += m_outgoing.count();
+    } else {
+      ers::error(CoalescingError(ERS_HERE,
+                                 "Dropped a batch of " + std::to_string(m_outgoing.count()) +
+                                   " messages which could not be sent before the sender was destroyed"));
+      m_dropped_messages += m_outgoing.count();
+    }
+  }
+
+  void flusher_loop_()
+  {
+    std::unique_lock<std::mutex> lk(m_mutex);
+    while (true) {
+      if (m_outgoing.empty() && !m_batch.empty() &&
+          (!m_running || std::chrono::steady_clock::now() >= m_deadline)) {
+        if (m_running) {
+          ++m_deadline_flushes;
+        }
+        hand_over_();
+      }
+
+      if (!m_outgoing.empty()) {
+        lk.unlock();
+        send_outgoing_();
+        lk.lock();
+        m_outgoing.clear();
+        m_cv.notify_all();
+      } else if (!m_running) {
+        break;
+      } else if (m_batch.empty()) {
+        m_cv.wait(lk);
+      } else {
+        m_cv.wait_until(lk, m_deadline);
+      }
+    }
+  }
+
+  std::shared_ptr<Sender> m_inner;
+  size_t m_max_bytes{ s_default_max_bytes };
+  size_t m_max_messages{ s_default_max_messages };
+  std::chrono::microseconds m_max_delay{ s_default_max_delay_us };
+  std::chrono::milliseconds m_flush_timeout{ s_default_flush_timeout_ms };
+
+  // Guards the batch being filled, and the handing over of batches between it and m_outgoing
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  CoalescedBatch m_batch;
+  std::string m_batch_metadata;
+  std::chrono::steady_clock::time_point m_deadline;
+  // The batch the flusher thread is sending; the two buffers swap roles, so each keeps its capacity
+  CoalescedBatch m_outgoing;
+  std::string m_outgoing_metadata;
+  std::atomic<bool> m_running{ false };
+  std::thread m_flusher;
+
+  std::atomic<uint64_t> m_batches{ 0 };
+  std::atomic<uint64_t> m_batched_messages{ 0 };
+  std::atomic<uint64_t> m_deadline_flushes{ 0 };
+  std::atomic<uint64_t> m_dropped_messages{ 0 };
+  std::atomic<uint64_t> m_flush_retries{ 0 };
+};
+
+} // namespace ipm
+} // namespace dunedaq
+
+DEFINE_DUNE_IPM_SENDER(dunedaq::ipm::CoalescingSender)
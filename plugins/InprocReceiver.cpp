@@ -0,0 +1,110 @@
+/**
+ *
+ * @file InprocReceiver.cpp InprocReceiver messaging class definitions
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "CallbackAdapter.hpp"
+#include "InprocChannel.hpp"
+#include "ipm/Receiver.hpp"
+
+#include "logging/Logging.hpp"
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace dunedaq {
+namespace ipm {
+
+// Receives from InprocSenders in the same process connected to the same inproc://name connection string. Several
+// receivers on one name share out the messages between them.
+class InprocReceiver : public Receiver
+{
+public:
+  ~InprocReceiver() { unregister_callback(); }
+
+  std::string connect_for_receives(const nlohmann::json& connection_info) override
+  {
+    auto connection_string = connection_info.value<std::string>("connection_string", "inproc://default");
+    TLOG() << "Connection String is " << connection_string;
+
+    m_channel = InprocChannel::get(connection_string,
+                                   connection_info.value<size_t>("queue_capacity", InprocChannel::s_default_capacity));
+    m_connection_string = connection_string;
+
+    m_callback_adapter.configure_from(connection_info);
+    m_callback_adapter.set_receiver(this);
+
+    return m_connection_string;
+  }
+
+  bool can_receive() const noexcept override { return m_channel != nullptr; }
+
+  void register_callback(std::function<void(Response&)> callback) { m_callback_adapter.set_callback(callback); }
+  void unregister_callback() { m_callback_adapter.clear_callback(); }
+  void register_view_callback(std::function<void(ResponseView&)> callback) override
+  {
+    m_callback_adapter.set_view_callback(callback);
+  }
+
+  bool wait_for_message(const duration_t& timeout, int wakeup_fd) override
+  {
+    return m_channel->wait_readable(timeout, wakeup_fd);
+  }
+
+protected:
+  Receiver::Response receive_(const duration_t& timeout, bool no_tmoexcept_mode) override
+  {
+    Receiver::Response output;
+    InprocMessage msg;
+    if (m_channel->pop(msg, timeout)) {
+      if (msg.owned_buffer) {
+        // Response owns its data as a vector, so an owned buffer has to be copied here; receive_view avoids this
+        output = make_response_(msg.size());
+        output.data.assign(msg.payload(), msg.payload() + msg.size());
+      } else {
+        output.data = std::move(msg.data);
+      }
+      output.metadata = std::move(msg.metadata);
+    } else if (!no_tmoexcept_mode) {
+      throw ReceiveTimeoutExpired(ERS_HERE, timeout.count());
+    }
+
+    TLOG_DEBUG(15) << "Endpoint " << m_connection_string << ": Returning output with metadata size "
+                   << output.metadata.size() << " and data size " << output.data.size();
+    return output;
+  }
+
+  Receiver::ResponseView receive_view_(const duration_t& timeout, bool no_tmoexcept_mode) override
+  {
+    auto msg = std::make_shared<InprocMessage>();
+    if (!m_channel->pop(*msg, timeout)) {
+      if (!no_tmoexcept_mode) {
+        throw ReceiveTimeoutExpired(ERS_HERE, timeout.count());
+      }
+      return {};
+    }
+
+    TLOG_DEBUG(15) << "Endpoint " << m_connection_string << ": Returning view with metadata size "
+                   << msg->metadata.size() << " and data size " << msg->size();
+    auto data = msg->payload();
+    auto size = msg->size();
+    std::string_view metadata(msg->metadata);
+    return ResponseView(std::move(msg), data, size, metadata);
+  }
+
+private:
+  std::shared_ptr<InprocChannel> m_channel;
+  std::string m_connection_string;
+  CallbackAdapter m_callback_adapter;
+};
+
+} // namespace ipm
+} // namespace dunedaq
+
+DEFINE_DUNE_IPM_RECEIVER(dunedaq::ipm::InprocReceiver)
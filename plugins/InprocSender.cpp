@@ -0,0 +1,109 @@
+/**
+ *
+ * @file InprocSender.cpp InprocSender messaging class definitions
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "InprocChannel.hpp"
+#include "ipm/Sender.hpp"
+
+#include "logging/Logging.hpp"
+
+#include <memory>
+#include <string>
+#include <utility>
+
+namespace dunedaq {
+namespace ipm {
+
+// Sends to InprocReceivers in the same process connected to the same inproc://name connection string, without going
+// through ZMQ
+class InprocSender : public Sender
+{
+public:
+  ~InprocSender() { stop_async_sends(); }
+
+  bool can_send() const noexcept override { return m_channel != nullptr; }
+  std::string connect_for_sends(const nlohmann::json& connection_info) override
+  {
+    auto connection_string = connection_info.value<std::string>("connection_string", "inproc://default");
+    TLOG() << "Connection String is " << connection_string;
+
+    m_channel = InprocChannel::get(connection_string,
+                                   connection_info.value<size_t>("queue_capacity", InprocChannel::s_default_capacity));
+    m_connection_string = connection_string;
+    return m_connection_string;
+  }
+
+protected:
+  bool send_(const void* message,
+             message_size_t N,
+             const duration_t& timeout,
+             std::string const& topic,
+             bool no_tmoexcept_mode) override
+  {
+    // The caller keeps its buffer, so this is the one copy made
+    InprocMessage msg;
+    msg.metadata = topic;
+    msg.data.assign(static_cast<const char*>(message), static_cast<const char*>(message) + N);
+    return send_message_(std::move(msg), timeout, no_tmoexcept_mode);
+  }
+
+  bool send_owned_(owned_buffer_t message,
+                   message_size_t N,
+                   const duration_t& timeout,
+                   std::string const& topic,
+                   bool no_tmoexcept_mode) override
+  {
+    InprocMessage msg;
+    msg.metadata = topic;
+    msg.owned_buffer = std::move(message);
+    msg.owned_size = N;
+    return send_message_(std::move(msg), timeout, no_tmoexcept_mode);
+  }
+
+  bool send_segments_(const Segment* segments,
+                      size_t segment_count,
+                      message_size_t N,
+                      const duration_t& timeout,
+                      std::string const& topic,
+                      bool no_tmoexcept_mode) override
+  {
+    InprocMessage msg;
+    msg.metadata = topic;
+    msg.data.reserve(N);
+    for (size_t ii = 0; ii < segment_count; ++ii) {
+      auto data = static_cast<const char*>(segments[ii].data);
+      msg.data.insert(msg.data.end(), data, data + segments[ii].size);
+    }
+    return send_message_(std::move(msg), timeout, no_tmoexcept_mode);
+  }
+
+private:
+  bool send_message_(InprocMessage&& msg, const duration_t& timeout, bool no_tmoexcept_mode)
+  {
+    auto N = msg.size();
+    TLOG_DEBUG(10) << "Endpoint " << m_connection_string << ": Starting send of " << N << " bytes";
+    std::chrono::steady_clock::duration wait_time{};
+    auto sent = m_channel->push(std::move(msg), timeout, wait_time);
+    add_send_wait_time(wait_time);
+
+    if (!sent && !no_tmoexcept_mode) {
+      throw SendTimeoutExpired(ERS_HERE, timeout.count());
+    }
+
+    TLOG_DEBUG(15) << "Endpoint " << m_connection_string << ": Completed send of " << N << " bytes";
+    return sent;
+  }
+
+  std::shared_ptr<InprocChannel> m_channel;
+  std::string m_connection_string;
+};
+
+} // namespace ipm
+} // namespace dunedaq
+
+DEFINE_DUNE_IPM_SENDER(dunedaq::ipm::InprocSender)
@@ -0,0 +1,116 @@
+/**
+ *
+ * @file ShmReceiver.cpp ShmReceiver messaging class definitions
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "CallbackAdapter.hpp"
+#include "ShmRing.hpp"
+#include "ipm/Receiver.hpp"
+
+#include "logging/Logging.hpp"
+
+#include <poll.h>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <utility>
+
+namespace dunedaq {
+namespace ipm {
+
+// Receives from the ShmSender on the same host connected to the same shm://name connection string. The shared-memory
+// segment is removed when the ShmReceiver is destroyed.
+class ShmReceiver : public Receiver
+{
+public:
+  ~ShmReceiver() { unregister_callback(); }
+
+  std::string connect_for_receives(const nlohmann::json& connection_info) override
+  {
+    auto connection_string = connection_info.value<std::string>("connection_string", "shm://default");
+    TLOG() << "Connection String is " << connection_string;
+
+    m_ring = std::make_unique<ShmRing>(ShmRing::name_from_uri(connection_string),
+                                       connection_info.value<size_t>("shm_capacity", ShmRing::s_default_capacity),
+                                       true);
+    m_connection_string = connection_string;
+
+    m_callback_adapter.configure_from(connection_info);
+    m_callback_adapter.set_receiver(this);
+
+    return m_connection_string;
+  }
+
+  bool can_receive() const noexcept override { return m_ring != nullptr; }
+
+  void register_callback(std::function<void(Response&)> callback) { m_callback_adapter.set_callback(callback); }
+  void unregister_callback() { m_callback_adapter.clear_callback(); }
+  void register_view_callback(std::function<void(ResponseView&)> callback) override
+  {
+    m_callback_adapter.set_view_callback(callback);
+  }
+
+  bool wait_for_message(const duration_t& timeout, int wakeup_fd) override
+  {
+    if (wakeup_fd < 0) {
+      return m_ring->wait_readable(timeout);
+    }
+
+    // A futex can't be waited on together with a file descriptor, so wait in slices and check wakeup_fd in between
+    auto start_time = std::chrono::steady_clock::now();
+    pollfd wakeup{ wakeup_fd, POLLIN, 0 };
+    while (true) {
+      auto elapsed = std::chrono::duration_cast<duration_t>(std::chrono::steady_clock::now() - start_time);
+      auto slice = timeout == s_block ? s_wakeup_check_interval : std::min(s_wakeup_check_interval, timeout - elapsed);
+      if (m_ring->wait_readable(slice)) {
+        return true;
+      }
+      if (poll(&wakeup, 1, 0) > 0 || elapsed + slice >= timeout) {
+        return false;
+      }
+    }
+  }
+
+protected:
+  Receiver::Response receive_(const duration_t& timeout, bool no_tmoexcept_mode) override
+  {
+    Receiver::Response output;
+    if (m_ring->wait_readable(timeout)) {
+      output = make_response_(m_ring->next_data_size());
+      m_ring->read(output, s_no_block);
+    } else if (!no_tmoexcept_mode) {
+      throw ReceiveTimeoutExpired(ERS_HERE, timeout.count());
+    }
+
+    TLOG_DEBUG(15) << "Endpoint " << m_connection_string << ": Returning output with metadata size "
+                   << output.metadata.size() << " and data size " << output.data.size();
+    return output;
+  }
+
+  size_t receive_many_(std::vector<Response>& responses, size_t max_count, const duration_t& timeout) override
+  {
+    size_t received = 0;
+    // Reading into the caller's Responses reuses their buffers
+    while (received < max_count && m_ring->read(responses[received], received == 0 ? timeout : s_no_block)) {
+      ++received;
+    }
+    return received;
+  }
+
+private:
+  static constexpr duration_t s_wakeup_check_interval = std::chrono::milliseconds(10);
+
+  std::unique_ptr<ShmRing> m_ring;
+  std::string m_connection_string;
+  CallbackAdapter m_callback_adapter;
+};
+
+} // namespace ipm
+} // namespace dunedaq
+
+DEFINE_DUNE_IPM_RECEIVER(dunedaq::ipm::ShmReceiver)
@@ -0,0 +1,81 @@
+/**
+ *
+ * @file ShmSender.cpp ShmSender messaging class definitions
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "ShmRing.hpp"
+#include "ipm/Sender.hpp"
+
+#include "logging/Logging.hpp"
+
+#include <memory>
+#include <string>
+#include <utility>
+
+namespace dunedaq {
+namespace ipm {
+
+// Sends to the ShmReceiver on the same host bound to the same shm://name connection string. Only one ShmSender may
+// be connected to a given name at a time; while another is, attaching (on connect, or on the first send once the
+// receiver's segment exists) throws ShmOperationError.
+class ShmSender : public Sender
+{
+public:
+  ~ShmSender() { stop_async_sends(); }
+
+  bool can_send() const noexcept override { return m_ring != nullptr; }
+  std::string connect_for_sends(const nlohmann::json& connection_info) override
+  {
+    auto connection_string = connection_info.value<std::string>("connection_string", "shm://default");
+    TLOG() << "Connection String is " << connection_string;
+
+    // The ring is created, and sized, by the receiver; until it exists sends wait for it
+    m_ring = std::make_unique<ShmRing>(ShmRing::name_from_uri(connection_string), 0, false);
+    m_connection_string = connection_string;
+    return m_connection_string;
+  }
+
+protected:
+  bool send_(const void* message,
+             message_size_t N,
+             const duration_t& timeout,
+             std::string const& topic,
+             bool no_tmoexcept_mode) override
+  {
+    Segment segment{ message, N };
+    return send_segments_(&segment, 1, N, timeout, topic, no_tmoexcept_mode);
+  }
+
+  bool send_segments_(const Segment* segments,
+                      size_t segment_count,
+                      message_size_t N,
+                      const duration_t& timeout,
+                      std::string const& topic,
+                      bool no_tmoexcept_mode) override
+  {
+    TLOG_DEBUG(10) << "Endpoint " << m_connection_string << ": Starting send of " << N << " bytes";
+    std::chrono::steady_clock::duration wait_time{};
+    auto sent = m_ring->write(topic, segments, segment_count, N, timeout, wait_time);
+    add_send_wait_time(wait_time);
+
+    if (!sent && !no_tmoexcept_mode) {
+      throw SendTimeoutExpired(ERS_HERE, timeout.count());
+    }
+
+    TLOG_DEBUG(15) << "Endpoint " << m_connection_string << ": Completed send of " << N << " bytes";
+    return sent;
+  }
+
+private:
+  std::unique_ptr<ShmRing> m_ring;
+  std::string m_connection_string;
+};
+
+} // namespace ipm
+} // namespace dunedaq
+
+DEFINE_DUNE_IPM_SENDER(dunedaq::ipm::ShmSender)
@@ -7,6 +7,9 @@
  * received with this code.
  */
 
+#include "TopicStats.hpp"
+#include "ZmqSocketOptions.hpp"
+#include "ZmqSocketSender.hpp"
 #include "ipm/Sender.hpp"
 #include "ipm/ZmqContext.hpp"
 
@@ -15,6 +18,8 @@
 #include "zmq.hpp"
 
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
 namespace dunedaq {
@@ -22,13 +27,11 @@ namespace ipm {
 class ZmqPublisher : public Sender
 {
 public:
-  explicit ZmqPublisher()
-    : m_socket(ZmqContext::instance().GetContext(), zmq::socket_type::pub)
-  {
-  }
+  explicit ZmqPublisher() = default;
 
   ~ZmqPublisher()
   {
+    stop_async_sends();
     // Probably (cpp)zmq does this in the socket dtor anyway, but I guess it doesn't hurt to be explicit
     if (m_connection_string != "" && m_socket_connected) {
       try {
@@ -44,6 +47,16 @@ public:
   bool can_send() const noexcept override { return m_socket_connected; }
   std::string connect_for_sends(const nlohmann::json& connection_info)
   {
+    auto socket_options = ZmqSocketOptions::from_connection_info(connection_info);
+    // The socket is only created now, in the selected context, so that no other context starts its IO threads
+    auto context_name = connection_info.value<std::string>("zmq_context", m_context_name);
+    if (!m_socket) {
+      m_socket = zmq::socket_t(ZmqContext::instance(context_name).GetContext(), zmq::socket_type::pub);
+      m_context_name = context_name;
+    } else if (context_name != m_context_name) {
+      throw ZmqOperationError(
+        ERS_HERE, "change context", "send", "The socket was already created in another context", m_connection_string);
+    }
     try {
       m_socket.set(zmq::sockopt::sndtimeo, 0); // Return immediately if we can't send
     } catch (zmq::error_t const& err) {
@@ -54,6 +67,16 @@ public:
                               connection_info.value<std::string>("connection_string", "inproc://default"));
     }
 
+    try {
+      socket_options.apply(m_socket);
+    } catch (zmq::error_t const& err) {
+      throw ZmqOperationError(ERS_HERE,
+                              "set socket options",
+                              "send",
+                              err.what(),
+                              connection_info.value<std::string>("connection_string", "inproc://default"));
+    }
+
     std::vector<std::string> resolved;
     try {
       resolved =
@@ -88,58 +111,70 @@ public:
     if (!m_socket_connected) {
       throw ZmqOperationError(ERS_HERE, "bind", "send", "Bind failed for all resolved connection strings", "");
     }
+    m_socket_options_info = socket_options.effective(m_socket);
+
+    if (connection_info.contains("topic_stats_max_topics")) {
+      m_topic_stats.set_max_topics(connection_info.value<size_t>("topic_stats_max_topics", 0));
+    }
 
     return m_connection_string;
   }
 
 protected:
+  void generate_opmon_data() override
+  {
+    Sender::generate_opmon_data();
+    if (m_socket_connected) {
+      publish(opmon::SocketOptionsInfo(m_socket_options_info));
+    }
+    for (auto& [topic, info] : m_topic_stats.take()) {
+      publish(std::move(info), { { "topic", topic } });
+    }
+  }
+
   bool send_(const void* message,
-             int N,
+             message_size_t N,
              const duration_t& timeout,
              std::string const& topic,
              bool no_tmoexcept_mode) override
   {
-    TLOG_DEBUG(10) << "Endpoint " << m_connection_string << ": Starting send of " << N << " bytes";
-    auto start_time = std::chrono::steady_clock::now();
-    zmq::send_result_t res{};
-    do {
-
-      zmq::message_t topic_msg(topic.c_str(), topic.size());
-      try {
-        res = m_socket.send(topic_msg, zmq::send_flags::sndmore);
-      } catch (zmq::error_t const& err) {
-        throw ZmqSendError(ERS_HERE, err.what(), topic.size(), topic);
-      }
-
-      if (!res || res != topic.size()) {
-        TLOG_DEBUG(2) << "Endpoint " << m_connection_string << ": Unable to send message";
-        continue;
-      }
-
-      zmq::message_t msg(message, N);
-      try {
-        res = m_socket.send(msg, zmq::send_flags::none);
-      } catch (zmq::error_t const& err) {
-        throw ZmqSendError(ERS_HERE, err.what(), N, topic);
-      }
+    return m_socket_sender.send(message, N, timeout, topic, no_tmoexcept_mode);
+  }
 
-      if (!res && timeout > duration_t::zero()) {
-        usleep(1000);
-      }
-    } while (std::chrono::duration_cast<duration_t>(std::chrono::steady_clock::now() - start_time) < timeout && !res);
+  bool send_owned_(owned_buffer_t message,
+                   message_size_t N,
+                   const duration_t& timeout,
+                   std::string const& topic,
+                   bool no_tmoexcept_mode) override
+  {
+    return m_socket_sender.send_owned(std::move(message), N, timeout, topic, no_tmoexcept_mode);
+  }
 
-    if (!res && !no_tmoexcept_mode) {
-      throw SendTimeoutExpired(ERS_HERE, timeout.count());
-    }
+  bool send_segments_(const Segment* segments,
+                      size_t segment_count,
+                      message_size_t N,
+                      const duration_t& timeout,
+                      std::string const& topic,
+                      bool no_tmoexcept_mode) override
+  {
+    return m_socket_sender.send_segments(segments, segment_count, N, timeout, topic, no_tmoexcept_mode);
+  }
 
-    TLOG_DEBUG(15) << "Endpoint " << m_connection_string << ": Completed send of " << N << " bytes";
-    return res && res == N;
+  size_t send_batch_(const BatchEntry* entries, size_t count, const duration_t& timeout) override
+  {
+    return m_socket_sender.send_batch(entries, count, timeout);
   }
 
 private:
   zmq::socket_t m_socket;
   std::string m_connection_string;
-  bool m_socket_connected;
+  bool m_socket_connected{ false };
+  std::string m_context_name;
+  TopicStats m_topic_stats;
+  opmon::SocketOptionsInfo m_socket_options_info;
+  ZmqSocketSender m_socket_sender{ *this, m_socket, m_connection_string, [this](std::string_view topic, size_t N) {
+                                    m_topic_stats.add(topic, N);
+                                  } };
 };
 
 } // namespace ipm
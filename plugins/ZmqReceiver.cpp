@@ -8,6 +8,8 @@
  */
 
 #include "CallbackAdapter.hpp"
+#include "ZmqSocketOptions.hpp"
+#include "ZmqSocketReceiver.hpp"
 #include "ipm/Receiver.hpp"
 #include "ipm/ZmqContext.hpp"
 
@@ -15,6 +17,7 @@
 #include "utilities/Resolver.hpp"
 
 #include <string>
+#include <utility>
 #include <vector>
 
 namespace dunedaq {
@@ -23,9 +26,7 @@ namespace ipm {
 class ZmqReceiver : public Receiver
 {
 public:
-  ZmqReceiver()
-    : m_socket(ZmqContext::instance().GetContext(), zmq::socket_type::pull)
-  {}
+  ZmqReceiver() = default;
 
   ~ZmqReceiver()
   {
@@ -44,8 +45,21 @@ public:
 
   std::string connect_for_receives(const nlohmann::json& connection_info) override
   {
+    auto socket_options = ZmqSocketOptions::from_connection_info(connection_info);
+    // The socket is only created now, in the selected context, so that no other context starts its IO threads
+    auto context_name = connection_info.value<std::string>("zmq_context", m_context_name);
+    if (!m_socket) {
+      m_socket = zmq::socket_t(ZmqContext::instance(context_name).GetContext(), zmq::socket_type::pull);
+      m_context_name = context_name;
+    } else if (context_name != m_context_name) {
+      throw ZmqOperationError(ERS_HERE,
+                              "change context",
+                              "receive",
+                              "The socket was already created in another context",
+                              m_connection_string);
+    }
     try {
-      m_socket.set(zmq::sockopt::rcvtimeo, 0); // Return immediately if we can't receive
+      m_socket.set(zmq::sockopt::rcvtimeo, 0); // Return immediately if we can't receive, receive_ waits for POLLIN
     } catch (zmq::error_t const& err) {
       throw ZmqOperationError(ERS_HERE,
                               "set timeout",
@@ -64,6 +78,16 @@ public:
                               connection_info.value<std::string>("connection_string", "inproc://default"));
     }
 
+    try {
+      socket_options.apply(m_socket);
+    } catch (zmq::error_t const& err) {
+      throw ZmqOperationError(ERS_HERE,
+                              "set socket options",
+                              "receive",
+                              err.what(),
+                              connection_info.value<std::string>("connection_string", "inproc://default"));
+    }
+
     std::vector<std::string> resolved;
     try {
       resolved =
@@ -98,7 +122,9 @@ public:
     if (!m_socket_connected) {
       throw ZmqOperationError(ERS_HERE, "bind", "receive", "Bind failed for all resolved connection strings", "");
     }
+    m_socket_options_info = socket_options.effective(m_socket);
 
+    m_callback_adapter.configure_from(connection_info);
     m_callback_adapter.set_receiver(this);
 
     return m_connection_string;
@@ -108,49 +134,35 @@ public:
 
   void register_callback(std::function<void(Response&)> callback) { m_callback_adapter.set_callback(callback); }
   void unregister_callback() { m_callback_adapter.clear_callback(); }
+  void register_view_callback(std::function<void(ResponseView&)> callback) override
+  {
+    m_callback_adapter.set_view_callback(callback);
+  }
+
+  bool wait_for_message(const duration_t& timeout, int wakeup_fd) override
+  {
+    return m_socket_receiver.wait_for_message(timeout, wakeup_fd);
+  }
 
 protected:
+  void generate_opmon_data() override
+  {
+    Receiver::generate_opmon_data();
+    if (m_socket_connected) {
+      publish(opmon::SocketOptionsInfo(m_socket_options_info));
+    }
+  }
+
   Receiver::Response receive_(const duration_t& timeout, bool no_tmoexcept_mode) override
   {
     Receiver::Response output;
     zmq::message_t hdr, msg;
-    zmq::recv_result_t res{};
-
-    auto start_time = std::chrono::steady_clock::now();
-    do {
 
-      try {
-        TLOG_DEBUG(20) << "Endpoint " << m_connection_string << ": Going to receive header";
-        res = m_socket.recv(hdr);
-        TLOG_DEBUG(25) << "Endpoint " << m_connection_string << ": Recv res=" << res.value_or(0)
-                       << " for header (hdr.size() == " << hdr.size() << ")";
-      } catch (zmq::error_t const& err) {
-        throw ZmqReceiveError(ERS_HERE, err.what(), "header");
-      }
-      if (res || hdr.more()) {
-        TLOG_DEBUG(20) << "Endpoint " << m_connection_string << ": Going to receive data";
-        output.metadata.resize(hdr.size());
-        memcpy(&output.metadata[0], hdr.data(), hdr.size());
-
-        // ZMQ guarantees that the entire message has arrived
-
-        try {
-          res = m_socket.recv(msg);
-        } catch (zmq::error_t const& err) {
-          throw ZmqReceiveError(ERS_HERE, err.what(), "data");
-        }
-        TLOG_DEBUG(25) << "Endpoint " << m_connection_string << ": Recv res=" << res.value_or(0)
-                       << " for data (msg.size() == " << msg.size() << ")";
-        output.data.resize(msg.size());
-        memcpy(&output.data[0], msg.data(), msg.size());
-      } else if (timeout > duration_t::zero()) {
-        usleep(1000);
-      }
-    } while (std::chrono::duration_cast<duration_t>(std::chrono::steady_clock::now() - start_time) < timeout &&
-             res.value_or(0) == 0);
-
-    if (res.value_or(0) == 0 && !no_tmoexcept_mode) {
-      throw ReceiveTimeoutExpired(ERS_HERE, timeout.count());
+    if (m_socket_receiver.receive(hdr, msg, timeout, no_tmoexcept_mode)) {
+      output = make_response_(msg.size());
+      output.metadata.assign(static_cast<const char*>(hdr.data()), hdr.size());
+      auto data = static_cast<const char*>(msg.data());
+      output.data.assign(data, data + msg.size());
     }
 
     TLOG_DEBUG(15) << "Endpoint " << m_connection_string << ": Returning output with metadata size "
@@ -158,11 +170,32 @@ protected:
     return output;
   }
 
+  Receiver::ResponseView receive_view_(const duration_t& timeout, bool no_tmoexcept_mode) override
+  {
+    return m_socket_receiver.receive_view(timeout, no_tmoexcept_mode);
+  }
+
+  Receiver::IntoResponse receive_into_(void* dst,
+                                       size_t capacity,
+                                       const duration_t& timeout,
+                                       bool no_tmoexcept_mode) override
+  {
+    return m_socket_receiver.receive_into(dst, capacity, timeout, no_tmoexcept_mode);
+  }
+
+  size_t receive_many_(std::vector<Response>& responses, size_t max_count, const duration_t& timeout) override
+  {
+    return m_socket_receiver.receive_many(responses, max_count, timeout);
+  }
+
 private:
   zmq::socket_t m_socket;
   std::string m_connection_string;
   bool m_socket_connected{ false };
+  std::string m_context_name;
+  opmon::SocketOptionsInfo m_socket_options_info;
   CallbackAdapter m_callback_adapter;
+  ZmqSocketReceiver m_socket_receiver{ m_socket, m_connection_string };
 };
 } // namespace ipm
 } // namespace dunedaq
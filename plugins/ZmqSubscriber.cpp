@@ -9,13 +9,19 @@
  */
 
 #include "CallbackAdapter.hpp"
+#include "TopicStats.hpp"
+#include "ZmqSocketOptions.hpp"
+#include "ZmqSocketReceiver.hpp"
 #include "ipm/Subscriber.hpp"
 #include "ipm/ZmqContext.hpp"
 
 #include "logging/Logging.hpp"
 #include "utilities/Resolver.hpp"
 
+#include <set>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
 namespace dunedaq {
@@ -24,10 +30,7 @@ namespace ipm {
 class ZmqSubscriber : public Subscriber
 {
 public:
-  ZmqSubscriber()
-    : m_socket(ZmqContext::instance().GetContext(), zmq::socket_type::sub)
-  {
-  }
+  ZmqSubscriber() = default;
 
   ~ZmqSubscriber()
   {
@@ -48,6 +51,23 @@ public:
 
   std::string connect_for_receives(const nlohmann::json& connection_info) override
   {
+    auto socket_options = ZmqSocketOptions::from_connection_info(connection_info);
+    // The socket is only created now, in the selected context, so that no other context starts its IO threads
+    auto context_name = connection_info.value<std::string>("zmq_context", m_context_name);
+    if (!m_socket) {
+      m_socket = zmq::socket_t(ZmqContext::instance(context_name).GetContext(), zmq::socket_type::sub);
+      m_context_name = context_name;
+      for (auto& topic : m_subscriptions) {
+        try {
+          m_socket.set(zmq::sockopt::subscribe, topic);
+        } catch (zmq::error_t const& err) {
+          throw ZmqSubscribeError(ERS_HERE, err.what(), topic);
+        }
+      }
+    } else if (context_name != m_context_name) {
+      throw ZmqOperationError(
+        ERS_HERE, "change context", "receive", "The socket was already created in another context", m_endpoint);
+    }
     std::set<std::string> new_connection_strings;
     if (connection_info.contains("connection_string")) {
       if (m_connection_strings.count(connection_info.value<std::string>("connection_string", "")) == 0)
@@ -66,11 +86,21 @@ public:
     if (!m_socket_connected) {
       TLOG_DEBUG(18) << "Setting socket options";
       try {
-        m_socket.set(zmq::sockopt::rcvtimeo, 0); // Return immediately if we can't receive
+        m_socket.set(zmq::sockopt::rcvtimeo, 0); // Return immediately if we can't receive, receive_ waits for POLLIN
       } catch (zmq::error_t const& err) {
         throw ZmqOperationError(ERS_HERE, "set timeout", "receive", err.what(), *m_connection_strings.begin());
       }
     }
+    try {
+      socket_options.apply(m_socket);
+    } catch (zmq::error_t const& err) {
+      throw ZmqOperationError(ERS_HERE,
+                              "set socket options",
+                              "receive",
+                              err.what(),
+                              new_connection_strings.empty() ? *m_connection_strings.begin()
+                                                             : *new_connection_strings.begin());
+    }
     for (auto& conn_string : new_connection_strings) {
       try {
         TLOG_DEBUG(19) << "Connecting to publisher at " << conn_string;
@@ -81,78 +111,85 @@ public:
       }
     }
     m_socket_connected = true;
+    // Later calls without socket_options leave the socket as it was
+    if (connection_info.contains("socket_options") || m_socket_options_info.preset().empty()) {
+      m_socket_options_info = socket_options.effective(m_socket);
+    }
+    m_callback_adapter.configure_from(connection_info);
     m_callback_adapter.set_receiver(this);
+    if (connection_info.contains("topic_stats_max_topics")) {
+      m_topic_stats.set_max_topics(connection_info.value<size_t>("topic_stats_max_topics", 0));
+    }
 
     if (m_connection_strings.size() > 0) {
-      return *m_connection_strings.begin();
+      m_endpoint = *m_connection_strings.begin();
     }
-    return {};
+    return m_endpoint;
   }
 
   bool can_receive() const noexcept override { return m_socket_connected; }
 
+  // Before the socket is created, subscriptions are only recorded, and applied when it is
   void subscribe(std::string const& topic) override
   {
-    try {
-      m_socket.set(zmq::sockopt::subscribe, topic);
-    } catch (zmq::error_t const& err) {
-      throw ZmqSubscribeError(ERS_HERE, err.what(), topic);
+    if (m_socket) {
+      try {
+        m_socket.set(zmq::sockopt::subscribe, topic);
+      } catch (zmq::error_t const& err) {
+        throw ZmqSubscribeError(ERS_HERE, err.what(), topic);
+      }
     }
+    m_subscriptions.insert(topic);
   }
   void unsubscribe(std::string const& topic) override
   {
-    try {
-      m_socket.set(zmq::sockopt::unsubscribe, topic);
-    } catch (zmq::error_t const& err) {
-      throw ZmqUnsubscribeError(ERS_HERE, err.what(), topic);
+    if (m_socket) {
+      try {
+        m_socket.set(zmq::sockopt::unsubscribe, topic);
+      } catch (zmq::error_t const& err) {
+        throw ZmqUnsubscribeError(ERS_HERE, err.what(), topic);
+      }
+    }
+    auto subscription = m_subscriptions.find(topic);
+    if (subscription != m_subscriptions.end()) {
+      m_subscriptions.erase(subscription);
     }
   }
 
   void register_callback(std::function<void(Response&)> callback) { m_callback_adapter.set_callback(callback); }
   void unregister_callback() { m_callback_adapter.clear_callback(); }
+  void register_view_callback(std::function<void(ResponseView&)> callback) override
+  {
+    m_callback_adapter.set_view_callback(callback);
+  }
+
+  bool wait_for_message(const duration_t& timeout, int wakeup_fd) override
+  {
+    return m_socket_receiver.wait_for_message(timeout, wakeup_fd);
+  }
 
 protected:
+  void generate_opmon_data() override
+  {
+    Receiver::generate_opmon_data();
+    if (m_socket_connected) {
+      publish(opmon::SocketOptionsInfo(m_socket_options_info));
+    }
+    for (auto& [topic, info] : m_topic_stats.take()) {
+      publish(std::move(info), { { "topic", topic } });
+    }
+  }
+
   Receiver::Response receive_(const duration_t& timeout, bool no_tmoexcept_mode) override
   {
     Receiver::Response output;
     zmq::message_t hdr, msg;
-    zmq::recv_result_t res{};
-
-    auto start_time = std::chrono::steady_clock::now();
-    do {
-
-      try {
-        TLOG_DEBUG(20) << "Subscriber: Going to receive header";
-        res = m_socket.recv(hdr);
-        TLOG_DEBUG(25) << "Subscriber: Recv res=" << res.value_or(0) << " for header (hdr.size() == " << hdr.size()
-                       << ")";
-      } catch (zmq::error_t const& err) {
-        throw ZmqReceiveError(ERS_HERE, err.what(), "header");
-      }
-      if (res || hdr.more()) {
-        TLOG_DEBUG(20) << "Subscriber: Going to receive data";
-        output.metadata.resize(hdr.size());
-        memcpy(&output.metadata[0], hdr.data(), hdr.size());
-
-        // ZMQ guarantees that the entire message has arrived
-
-        try {
-          res = m_socket.recv(msg);
-        } catch (zmq::error_t const& err) {
-          throw ZmqReceiveError(ERS_HERE, err.what(), "data");
-        }
-        TLOG_DEBUG(25) << "Subscriber: Recv res=" << res.value_or(0) << " for data (msg.size() == " << msg.size()
-                       << ")";
-        output.data.resize(msg.size());
-        memcpy(&output.data[0], msg.data(), msg.size());
-      } else if (timeout > duration_t::zero()) {
-        usleep(1000);
-      }
-    } while (std::chrono::duration_cast<duration_t>(std::chrono::steady_clock::now() - start_time) < timeout &&
-             res.value_or(0) == 0);
 
-    if (res.value_or(0) == 0 && !no_tmoexcept_mode) {
-      throw ReceiveTimeoutExpired(ERS_HERE, timeout.count());
+    if (m_socket_receiver.receive(hdr, msg, timeout, no_tmoexcept_mode)) {
+      output = make_response_(msg.size());
+      output.metadata.assign(static_cast<const char*>(hdr.data()), hdr.size());
+      auto data = static_cast<const char*>(msg.data());
+      output.data.assign(data, data + msg.size());
     }
 
     TLOG_DEBUG(15) << "Subscriber: Returning output with metadata size " << output.metadata.size() << " and data size "
@@ -160,11 +197,37 @@ protected:
     return output;
   }
 
+  Receiver::ResponseView receive_view_(const duration_t& timeout, bool no_tmoexcept_mode) override
+  {
+    return m_socket_receiver.receive_view(timeout, no_tmoexcept_mode);
+  }
+
+  Receiver::IntoResponse receive_into_(void* dst,
+                                       size_t capacity,
+                                       const duration_t& timeout,
+                                       bool no_tmoexcept_mode) override
+  {
+    return m_socket_receiver.receive_into(dst, capacity, timeout, no_tmoexcept_mode);
+  }
+
+  size_t receive_many_(std::vector<Response>& responses, size_t max_count, const duration_t& timeout) override
+  {
+    return m_socket_receiver.receive_many(responses, max_count, timeout);
+  }
+
 private:
   zmq::socket_t m_socket;
   std::set<std::string> m_connection_strings{};
   bool m_socket_connected{ false };
+  std::string m_context_name;
+  std::multiset<std::string> m_subscriptions; // Kept to apply them when the socket is created
   CallbackAdapter m_callback_adapter;
+  TopicStats m_topic_stats;
+  opmon::SocketOptionsInfo m_socket_options_info;
+  std::string m_endpoint; // The first connection string, for log messages
+  ZmqSocketReceiver m_socket_receiver{ m_socket, m_endpoint, [this](std::string_view topic, size_t N) {
+                                        m_topic_stats.add(topic, N);
+                                      } };
 };
 } // namespace ipm
 } // namespace dunedaq
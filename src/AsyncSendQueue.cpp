@@ -0,0 +1,153 @@
+/**
+ *
+ * @file AsyncSendQueue.cpp ipm AsyncSendQueue class
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "AsyncSendQueue.hpp"
+
+#include <exception>
+#include <utility>
+
+namespace dunedaq::ipm {
+
+AsyncSendQueue::AsyncSendQueue(size_t capacity, send_function_t send_function)
+  : m_queue(capacity)
+  , m_send_function(std::move(send_function))
+{
+  m_thread = std::thread([this]() { run_(); });
+}
+
+AsyncSendQueue::~AsyncSendQueue() noexcept
+{
+  stop();
+}
+
+void
+AsyncSendQueue::push(AsyncSend&& entry)
+{
+  {
+    // Held across the running check and the push, so that stop() cannot clear m_running and drain the queue in between
+    // and leave this message queued with nothing to complete it
+    std::lock_guard<std::mutex> lk(m_mutex);
+    if (m_running.load()) {
+      // Counted before the push, so that flush() cannot miss a message which the thread is already sending
+      ++m_pending;
+      if (m_queue.try_push(std::move(entry))) {
+        auto current_depth = depth();
+        auto max_depth = m_max_depth.load(std::memory_order_relaxed);
+        while (current_depth > max_depth && !m_max_depth.compare_exchange_weak(max_depth, current_depth)) {
+        }
+
+        // The thread checks for messages under the lock before it sleeps, so it either sees this one or is waiting
+        if (m_thread_waiting.load()) {
+          m_data_cv.notify_one();
+        }
+        return;
+      }
+      if (--m_pending == 0) {
+        m_idle_cv.notify_all();
+      }
+    }
+  }
+
+  ++m_rejected;
+  complete_(entry, false, nullptr);
+}
+
+bool
+AsyncSendQueue::flush(const duration_t& timeout)
+{
+  std::unique_lock<std::mutex> lk(m_mutex);
+  auto idle = [&] { return m_pending.load() == 0; };
+  if (timeout == duration_t::max()) {
+    m_idle_cv.wait(lk, idle);
+    return true;
+  }
+  return m_idle_cv.wait_for(lk, timeout, idle);
+}
+
+void
+AsyncSendQueue::stop()
+{
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    m_running = false;
+  }
+  m_data_cv.notify_all();
+  if (m_thread.joinable()) {
+    m_thread.join();
+  }
+
+  // Anything pushed while the thread was finishing up
+  AsyncSend entry;
+  while (m_queue.try_pop(entry)) {
+    complete_(entry, false, nullptr);
+    finish_one_();
+  }
+}
+
+void
+AsyncSendQueue::run_()
+{
+  while (true) {
+    AsyncSend entry;
+    if (m_queue.try_pop(entry)) {
+      if (!m_running.load()) {
+        complete_(entry, false, nullptr);
+      } else {
+        bool sent = false;
+        std::exception_ptr error;
+        try {
+          sent = m_send_function(entry);
+        } catch (...) {
+          error = std::current_exception();
+        }
+        complete_(entry, sent, error);
+      }
+      finish_one_();
+      continue;
+    }
+
+    // A message which has been claimed by a producer but not yet stored makes the queue look non-empty, so this
+    // only sleeps once it is really empty
+    std::unique_lock<std::mutex> lk(m_mutex);
+    if (!m_running.load() && m_queue.empty()) {
+      break;
+    }
+    m_thread_waiting = true;
+    m_data_cv.wait(lk, [&] { return !m_queue.empty() || !m_running.load(); });
+    m_thread_waiting = false;
+  }
+}
+
+void
+AsyncSendQueue::finish_one_()
+{
+  if (--m_pending == 0) {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    m_idle_cv.notify_all();
+  }
+}
+
+void
+AsyncSendQueue::complete_(AsyncSend& entry, bool sent, std::exception_ptr error)
+{
+  // The buffer goes back to its owner first, so that the callback may reuse it
+  entry.message.reset();
+  if (!entry.callback) {
+    return;
+  }
+  try {
+    entry.callback(sent, error);
+  } catch (std::exception const& err) {
+    ers::error(AsyncSendCallbackException(ERS_HERE, err.what()));
+  } catch (...) {
+    ers::error(AsyncSendCallbackException(ERS_HERE, "unknown exception"));
+  }
+}
+
+} // namespace dunedaq::ipm
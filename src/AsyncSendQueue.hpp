@@ -0,0 +1,114 @@
+/**
+ *
+ * @file AsyncSendQueue.hpp IPM AsyncSendQueue class
+ *
+ * The queue behind Sender::send_async: producers push messages into a bounded lock-free queue, and a dedicated thread
+ * pops them and hands each to a send function, reporting the outcome through the message's completion callback.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef IPM_SRC_ASYNCSENDQUEUE_HPP_
+#define IPM_SRC_ASYNCSENDQUEUE_HPP_
+
+#include "LockFreeQueue.hpp"
+#include "ipm/Sender.hpp"
+
+#include "ers/Issue.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace dunedaq {
+
+/**
+ * @brief An ERS Error indicating that a send_async completion callback threw an exception. The exception is not
+ * propagated, so that the async send thread goes on to the next message.
+ * @param what The exception message
+ * @cond Doxygen doesn't like ERS macros LCOV_EXCL_START
+ */
+ERS_DECLARE_ISSUE(ipm,
+                  AsyncSendCallbackException,
+                  "A send_async completion callback threw an exception: " << what,
+                  ((std::string)what)) // NOLINT
+/// @endcond LCOV_EXCL_STOP
+
+namespace ipm {
+
+struct AsyncSend
+{
+  Sender::owned_buffer_t message;
+  Sender::message_size_t size{ 0 };
+  Sender::duration_t timeout{ Sender::s_no_block };
+  std::string metadata;
+  Sender::async_callback_t callback;
+};
+
+class AsyncSendQueue
+{
+public:
+  using duration_t = Sender::duration_t;
+  // Sends one message, returning whether it was sent; exceptions are passed on to the message's callback
+  using send_function_t = std::function<bool(AsyncSend&)>;
+
+  AsyncSendQueue(size_t capacity, send_function_t send_function);
+  ~AsyncSendQueue() noexcept;
+
+  AsyncSendQueue(const AsyncSendQueue&) = delete;
+  AsyncSendQueue& operator=(const AsyncSendQueue&) = delete;
+  AsyncSendQueue(AsyncSendQueue&&) = delete;
+  AsyncSendQueue& operator=(AsyncSendQueue&&) = delete;
+
+  // Never waits for room in the queue. If the queue is full or stopped, the message's callback is called at once with
+  // false.
+  void push(AsyncSend&& entry);
+
+  // Waits up to timeout for every message pushed so far to complete. Returns false if the timeout expired.
+  bool flush(const duration_t& timeout);
+
+  // Stops the thread once the send in progress, if any, returns. Messages still queued, and any pushed afterwards,
+  // complete with false.
+  void stop();
+
+  size_t depth() const noexcept { return m_queue.size(); }
+  size_t capacity() const noexcept { return m_queue.capacity(); }
+
+  // The deepest the queue has been, and the number of messages rejected because it was full or stopped, since the
+  // last call
+  size_t take_max_depth() noexcept { return m_max_depth.exchange(depth()); }
+  size_t take_rejected() noexcept { return m_rejected.exchange(0); }
+
+private:
+  void run_();
+  void finish_one_();
+  static void complete_(AsyncSend& entry, bool sent, std::exception_ptr error);
+
+  LockFreeQueue<AsyncSend> m_queue;
+  send_function_t m_send_function;
+  std::atomic<bool> m_running{ true };
+
+  // The thread sleeps on m_data_cv when the queue is empty; flush() waits on m_idle_cv for m_pending to reach 0.
+  // push() holds m_mutex, so that it cannot race with stop() or with the thread going to sleep.
+  std::mutex m_mutex;
+  std::condition_variable m_data_cv;
+  std::condition_variable m_idle_cv;
+  std::atomic<bool> m_thread_waiting{ false };
+  std::atomic<size_t> m_pending{ 0 };
+
+  std::atomic<size_t> m_max_depth{ 0 };
+  std::atomic<size_t> m_rejected{ 0 };
+
+  std::thread m_thread;
+};
+
+} // namespace ipm
+} // namespace dunedaq
+
+#endif // IPM_SRC_ASYNCSENDQUEUE_HPP_
@@ -0,0 +1,64 @@
+/**
+ * @file BufferPool.cpp BufferPool Class implementations
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "ipm/BufferPool.hpp"
+
+#include <utility>
+#include <vector>
+
+std::vector<char>
+dunedaq::ipm::BufferPool::acquire(size_t size)
+{
+  // The smallest class whose buffers are all big enough
+  size_t class_bits = s_min_class_bits;
+  while (class_bits <= s_max_class_bits && (size_t(1) << class_bits) < size) {
+    ++class_bits;
+  }
+
+  std::vector<char> buffer;
+  if (class_bits <= s_max_class_bits) {
+    auto& size_class = m_classes[class_bits - s_min_class_bits];
+    std::lock_guard<std::mutex> lk(size_class.mutex);
+    if (!size_class.buffers.empty()) {
+      buffer = std::move(size_class.buffers.back());
+      size_class.buffers.pop_back();
+    }
+  }
+
+  if (buffer.capacity() != 0) {
+    m_bytes_held -= buffer.capacity();
+    ++m_hits;
+  } else {
+    ++m_misses;
+    // Allocate the whole class size, so that the buffer can serve any request of its class when it comes back
+    buffer.reserve(class_bits <= s_max_class_bits ? size_t(1) << class_bits : size);
+  }
+  return buffer;
+}
+
+void
+dunedaq::ipm::BufferPool::release(std::vector<char>&& buffer)
+{
+  auto capacity = buffer.capacity();
+  if (capacity < (size_t(1) << s_min_class_bits) || capacity >= (size_t(1) << (s_max_class_bits + 1)) ||
+      m_bytes_held + capacity > m_max_bytes_held) {
+    return;
+  }
+
+  // The largest class which the buffer is big enough for
+  size_t class_bits = s_min_class_bits;
+  while (class_bits < s_max_class_bits && (size_t(1) << (class_bits + 1)) <= capacity) {
+    ++class_bits;
+  }
+
+  buffer.clear();
+  m_bytes_held += capacity;
+  auto& size_class = m_classes[class_bits - s_min_class_bits];
+  std::lock_guard<std::mutex> lk(size_class.mutex);
+  size_class.buffers.push_back(std::move(buffer));
+}
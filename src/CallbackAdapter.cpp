@@ -11,19 +11,40 @@
 
 #include "logging/Logging.hpp"
 
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <functional>
 #include <string>
+#include <string_view>
 #include <utility>
 
 namespace dunedaq::ipm {
 
+CallbackAdapter::CallbackAdapter()
+  : m_wakeup_fd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+{
+  // Without it the receive thread could not be woken, and unregistering the callback would hang
+  if (m_wakeup_fd < 0) {
+    throw CallbackWakeupError(ERS_HERE, strerror(errno));
+  }
+}
+
 CallbackAdapter::~CallbackAdapter() noexcept
 {
   {
     std::lock_guard<std::mutex> lk(m_callback_mutex);
     m_callback = nullptr;
+    m_view_callback = nullptr;
   }
   shutdown();
   m_receiver_ptr = nullptr;
+  close(m_wakeup_fd);
 }
 
 void
@@ -34,7 +55,7 @@ CallbackAdapter::set_receiver(Receiver* receiver_ptr)
     m_receiver_ptr = receiver_ptr;
   }
 
-  if (m_receiver_ptr != nullptr && m_callback != nullptr) {
+  if (m_receiver_ptr != nullptr && has_callback()) {
     startup();
   }
 }
@@ -45,9 +66,24 @@ CallbackAdapter::set_callback(std::function<void(Receiver::Response&)> callback)
   {
     std::lock_guard<std::mutex> lk(m_callback_mutex);
     m_callback = callback;
+    m_view_callback = nullptr;
   }
 
-  if (m_receiver_ptr != nullptr && m_callback != nullptr) {
+  if (m_receiver_ptr != nullptr && has_callback()) {
+    startup();
+  }
+}
+
+void
+CallbackAdapter::set_view_callback(std::function<void(Receiver::ResponseView&)> callback)
+{
+  {
+    std::lock_guard<std::mutex> lk(m_callback_mutex);
+    m_view_callback = callback;
+    m_callback = nullptr;
+  }
+
+  if (m_receiver_ptr != nullptr && has_callback()) {
     startup();
   }
 }
@@ -58,16 +94,51 @@ CallbackAdapter::clear_callback()
   {
     std::lock_guard<std::mutex> lk(m_callback_mutex);
     m_callback = nullptr;
+    m_view_callback = nullptr;
   }
   shutdown();
 }
 
+void
+CallbackAdapter::set_dispatch_workers(size_t worker_count, bool preserve_order, size_t queue_capacity)
+{
+  m_worker_count = worker_count;
+  m_preserve_order = preserve_order;
+  m_queue_capacity = queue_capacity;
+
+  if (m_thread != nullptr) {
+    startup();
+  }
+}
+
+void
+CallbackAdapter::configure_from(const nlohmann::json& connection_info)
+{
+  if (connection_info.contains("callback_workers")) {
+    set_dispatch_workers(connection_info.value<size_t>("callback_workers", 0),
+                         connection_info.value<bool>("callback_preserve_order", false),
+                         connection_info.value<size_t>("callback_queue_capacity", s_default_queue_capacity));
+  }
+}
+
 void
 CallbackAdapter::shutdown()
 {
-  if (m_thread && m_thread->joinable())
+  m_running = false;
+  if (m_thread && m_thread->joinable()) {
+    // Wake the receive thread if it is waiting for a message
+    uint64_t one = 1;
+    if (write(m_wakeup_fd, &one, sizeof(one)) < 0) {
+      TLOG_DEBUG(5) << "Unable to signal the receive thread, shutdown will wait for the next message";
+    }
     m_thread->join();
 
+    uint64_t signals = 0;
+    while (read(m_wakeup_fd, &signals, sizeof(signals)) > 0) {
+    }
+  }
+  stop_workers();
+
   m_is_listening = false;
   m_thread.reset(nullptr);
 }
@@ -77,6 +148,14 @@ CallbackAdapter::startup()
 {
   shutdown();
   m_is_listening = false;
+  m_running = true;
+  {
+    std::lock_guard<std::mutex> lk(m_callback_mutex);
+    m_dispatch_views = m_view_callback != nullptr;
+    m_worker_callback = m_callback;
+    m_worker_view_callback = m_view_callback;
+  }
+  start_workers();
   m_thread.reset(new std::thread([&] { thread_loop(); }));
 
   while (!m_is_listening.load()) {
@@ -87,22 +166,168 @@ CallbackAdapter::startup()
 void
 CallbackAdapter::thread_loop()
 {
-  do {
-    try {
-      auto response = m_receiver_ptr->receive(Receiver::s_no_block);
+  m_is_listening = true;
+  while (m_running.load()) {
+    if (!m_receiver_ptr->wait_for_message(Receiver::s_block, m_wakeup_fd)) {
+      continue;
+    }
+
+    // Drain everything that is already queued before waiting again
+    while (m_running.load() && dispatch_one()) {
+    }
+  }
+}
+
+bool
+CallbackAdapter::dispatch_one()
+{
+  // The receive which comes back empty once the transport is drained is not counted as one of the user's empty polls
+  if (m_dispatch_views) {
+    auto view = m_receiver_ptr->receive_view_and_count_(Receiver::s_no_block, Receiver::s_any_size, true, false);
+    if (view.empty()) {
+      return false;
+    }
+
+    TLOG_DEBUG(25) << "Received " << view.size() << " bytes. Dispatching to view callback.";
+    if (!m_workers.empty()) {
+      auto key = std::hash<std::string_view>()(view.metadata());
+      enqueue(QueuedMessage{ {}, std::move(view) }, key);
+      return true;
+    }
+    std::lock_guard<std::mutex> lk(m_callback_mutex);
+    if (m_view_callback != nullptr) {
+      invoke(m_view_callback, view);
+    }
+    return true;
+  }
+
+  auto response = m_receiver_ptr->receive_and_count_(Receiver::s_no_block, Receiver::s_any_size, true, false);
+  if (response.data.empty() && response.metadata.empty()) {
+    return false;
+  }
+
+  TLOG_DEBUG(25) << "Received " << response.data.size() << " bytes. Dispatching to callback.";
+  if (!m_workers.empty()) {
+    auto key = std::hash<std::string>()(response.metadata);
+    enqueue(QueuedMessage{ std::move(response), {} }, key);
+    return true;
+  }
+  {
+    std::lock_guard<std::mutex> lk(m_callback_mutex);
+    if (m_callback != nullptr) {
+      invoke(m_callback, response);
+    }
+  }
+  m_receiver_ptr->release(std::move(response));
+  return true;
+}
+
+void
+CallbackAdapter::enqueue(QueuedMessage&& message, size_t key)
+{
+  auto& work_queue = *m_work_queues[m_work_queues.size() == 1 ? 0 : key % m_work_queues.size()];
+  while (!work_queue.queue.try_push(std::move(message))) {
+    // Workers are saturated: hold off receiving more until they catch up. They keep running until this thread has
+    // stopped, so the message is never dropped.
+    std::this_thread::yield();
+  }
+
+  // Pairs with the fence in worker_loop, so that either the worker sees the message or we see it is asleep
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (work_queue.sleepers.load() > 0) {
+    std::lock_guard<std::mutex> lk(work_queue.mutex);
+    work_queue.cv.notify_one();
+  }
+}
+
+void
+CallbackAdapter::start_workers()
+{
+  if (m_worker_count == 0) {
+    return;
+  }
+  m_workers_running = true;
+
+  // Ordered dispatch needs a queue per worker; otherwise all workers share one queue
+  size_t queue_count = m_preserve_order ? m_worker_count : 1;
+  for (size_t ii = 0; ii < queue_count; ++ii) {
+    m_work_queues.emplace_back(new WorkQueue(m_queue_capacity));
+  }
+  for (size_t ii = 0; ii < m_worker_count; ++ii) {
+    auto& work_queue = *m_work_queues[ii % queue_count];
+    m_workers.emplace_back([&] { worker_loop(work_queue); });
+  }
+  TLOG_DEBUG(10) << "Started " << m_worker_count << " callback workers on " << queue_count << " queues";
+}
+
+void
+CallbackAdapter::stop_workers()
+{
+  // Called once the receive thread has stopped, so nothing more is queued; the workers finish what is there
+  for (auto& work_queue : m_work_queues) {
+    std::lock_guard<std::mutex> lk(work_queue->mutex);
+    m_workers_running = false;
+    work_queue->cv.notify_all();
+  }
+  for (auto& worker : m_workers) {
+    if (worker.joinable()) {
+      worker.join();
+    }
+  }
+  m_workers.clear();
+  m_work_queues.clear();
+}
 
-      TLOG_DEBUG(25) << "Received " << response.data.size() << " bytes. Dispatching to callback.";
-      {
-        std::lock_guard<std::mutex> lk(m_callback_mutex);
-        if (m_callback != nullptr) {
-          m_callback(response);
-        }
+void
+CallbackAdapter::worker_loop(WorkQueue& work_queue)
+{
+  QueuedMessage message;
+  while (true) {
+    if (!work_queue.queue.try_pop(message)) {
+      // A message claimed by the receive thread but not yet stored makes the queue look non-empty, so this only
+      // leaves once the queue is really drained
+      if (!m_workers_running.load() && work_queue.queue.empty()) {
+        break;
       }
-    } catch (ipm::ReceiveTimeoutExpired const& tmo) {
-      usleep(10000);
+      std::unique_lock<std::mutex> lk(work_queue.mutex);
+      ++work_queue.sleepers;
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      work_queue.cv.wait(lk, [&] { return !m_workers_running.load() || !work_queue.queue.empty(); });
+      --work_queue.sleepers;
+      continue;
     }
-    m_is_listening = true;
-  } while (m_callback != nullptr && m_receiver_ptr != nullptr);
+
+    if (m_dispatch_views) {
+      invoke(m_worker_view_callback, message.view);
+    } else {
+      invoke(m_worker_callback, message.response);
+      m_receiver_ptr->release(std::move(message.response));
+    }
+    message = QueuedMessage();
+  }
+}
+
+template<typename Callback, typename Message>
+void
+CallbackAdapter::invoke(Callback& callback, Message& message)
+{
+  auto start_time = std::chrono::steady_clock::now();
+  try {
+    callback(message);
+  } catch (std::exception const& err) {
+    ++m_receiver_ptr->m_callback_exceptions;
+    ers::error(CallbackException(ERS_HERE, err.what()));
+  } catch (...) {
+    ++m_receiver_ptr->m_callback_exceptions;
+    ers::error(CallbackException(ERS_HERE, "unknown exception"));
+  }
+  m_receiver_ptr->m_callback_time.record(std::chrono::steady_clock::now() - start_time);
+}
+
+bool
+CallbackAdapter::has_callback() const
+{
+  return m_callback != nullptr || m_view_callback != nullptr;
 }
 
 } // namespace dunedaq::ipm
\ No newline at end of file
@@ -10,38 +10,122 @@
 #ifndef IPM_SRC_CALLBACKADAPTER_HPP_
 #define IPM_SRC_CALLBACKADAPTER_HPP_
 
+#include "LockFreeQueue.hpp"
 #include "ipm/Receiver.hpp"
 
+#include "ers/Issue.hpp"
+#include "nlohmann/json.hpp"
+
 #include <atomic>
+#include <condition_variable>
 #include <functional>
 #include <memory>
 #include <mutex>
+#include <string>
 #include <thread>
+#include <vector>
 
 namespace dunedaq {
+
+/**
+ * @brief An ERS Error indicating that a receive callback threw an exception. The exception is not propagated, so
+ * that the receive thread (or worker) goes on to the next message.
+ * @param what The exception message
+ * @cond Doxygen doesn't like ERS macros LCOV_EXCL_START
+ */
+ERS_DECLARE_ISSUE(ipm, CallbackException, "A receive callback threw an exception: " << what, ((std::string)what))
+/// @endcond LCOV_EXCL_STOP
+
+/**
+ * @brief An ERS Error indicating that the eventfd used to wake the receive thread on shutdown could not be created
+ * @param what The system error message
+ * @cond Doxygen doesn't like ERS macros LCOV_EXCL_START
+ */
+ERS_DECLARE_ISSUE(ipm,
+                  CallbackWakeupError,
+                  "Unable to create the eventfd which wakes the callback receive thread: " << what,
+                  ((std::string)what)) // NOLINT
+/// @endcond LCOV_EXCL_STOP
+
 namespace ipm {
 
 class CallbackAdapter
 {
 public:
-  CallbackAdapter() = default; // Explicitly defaulted
+  CallbackAdapter();
 
   virtual ~CallbackAdapter() noexcept;
 
   void set_receiver(Receiver* receiver_ptr);
   void set_callback(std::function<void(Receiver::Response&)> callback);
+  void set_view_callback(std::function<void(Receiver::ResponseView&)> callback);
   void clear_callback();
 
+  static constexpr size_t s_default_queue_capacity = 1024;
+
+  // Hand received messages to a pool of worker threads instead of running the callback on the receive thread.
+  // With preserve_order, messages with the same metadata always go to the same worker and so are processed in the
+  // order they were received. A worker_count of 0 restores dispatch on the receive thread.
+  void set_dispatch_workers(size_t worker_count,
+                            bool preserve_order = false,
+                            size_t queue_capacity = s_default_queue_capacity);
+  // Apply the callback_workers, callback_preserve_order and callback_queue_capacity entries of a receiver's
+  // connection_info, if callback_workers is given
+  void configure_from(const nlohmann::json& connection_info);
+
 private:
+  struct QueuedMessage
+  {
+    Receiver::Response response;
+    Receiver::ResponseView view;
+  };
+
+  struct WorkQueue
+  {
+    explicit WorkQueue(size_t capacity)
+      : queue(capacity)
+    {}
+
+    LockFreeQueue<QueuedMessage> queue;
+    std::mutex mutex; // Only used to let idle workers sleep
+    std::condition_variable cv;
+    std::atomic<size_t> sleepers{ 0 };
+  };
+
   void startup();
   void shutdown();
   void thread_loop();
+  bool dispatch_one();
+  bool has_callback() const;
+  void enqueue(QueuedMessage&& message, size_t key);
+  void start_workers();
+  void stop_workers();
+  void worker_loop(WorkQueue& work_queue);
+
+  // Run callback on message, timing it and counting (rather than propagating) any exception it throws
+  template<typename Callback, typename Message>
+  void invoke(Callback& callback, Message& message);
 
   Receiver* m_receiver_ptr{ nullptr };
   std::function<void(Receiver::Response&)> m_callback{ nullptr };
+  std::function<void(Receiver::ResponseView&)> m_view_callback{ nullptr };
   mutable std::mutex m_callback_mutex;
   std::unique_ptr<std::thread> m_thread{ nullptr };
   std::atomic<bool> m_is_listening{ false };
+  std::atomic<bool> m_running{ false };
+  bool m_dispatch_views{ false };
+  int m_wakeup_fd{ -1 }; // eventfd used to interrupt the receive thread's wait on shutdown
+
+  size_t m_worker_count{ 0 };
+  bool m_preserve_order{ false };
+  size_t m_queue_capacity{ s_default_queue_capacity };
+  std::vector<std::unique_ptr<WorkQueue>> m_work_queues;
+  std::vector<std::thread> m_workers;
+  // Cleared only after the receive thread has stopped, so that the workers drain their queues before exiting
+  std::atomic<bool> m_workers_running{ false };
+  // Copies of the callbacks taken at startup, so that workers can run them concurrently without holding the lock
+  std::function<void(Receiver::Response&)> m_worker_callback{ nullptr };
+  std::function<void(Receiver::ResponseView&)> m_worker_view_callback{ nullptr };
 };
 } // namespace ipm
 } // namespace dunedaq
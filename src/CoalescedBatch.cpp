@@ -0,0 +1,93 @@
+/**
+ *
+ * @file CoalescedBatch.cpp ipm CoalescedBatch class
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "CoalescedBatch.hpp"
+
+#include <cstring>
+#include <utility>
+#include <vector>
+
+namespace dunedaq::ipm {
+
+void
+CoalescedBatch::append(const void* data, size_t size)
+{
+  uint64_t size64 = size;
+  auto offset = m_frame.size();
+  m_frame.resize(offset + sizeof(size64) + size);
+  memcpy(m_frame.data() + offset, &size64, sizeof(size64));
+  memcpy(m_frame.data() + offset + sizeof(size64), data, size);
+  ++m_count;
+  memcpy(m_frame.data() + sizeof(s_magic), &m_count, sizeof(m_count));
+}
+
+void
+CoalescedBatch::truncate(size_t frame_bytes, size_t message_count)
+{
+  m_frame.resize(frame_bytes);
+  m_count = static_cast<uint32_t>(message_count);
+  memcpy(m_frame.data() + sizeof(s_magic), &m_count, sizeof(m_count));
+}
+
+void
+CoalescedBatch::clear()
+{
+  // Keeps the capacity, so that a sender reuses one buffer for all its batches
+  m_frame.resize(s_header_size);
+  m_count = 0;
+  memcpy(m_frame.data(), &s_magic, sizeof(s_magic));
+  memcpy(m_frame.data() + sizeof(s_magic), &m_count, sizeof(m_count));
+}
+
+bool
+CoalescedBatch::is_batch_metadata(std::string_view metadata)
+{
+  return metadata.size() >= s_metadata_suffix.size() &&
+         metadata.substr(metadata.size() - s_metadata_suffix.size()) == s_metadata_suffix;
+}
+
+bool
+CoalescedBatch::unpack(const char* frame, size_t size, std::vector<std::pair<const char*, size_t>>& messages)
+{
+  messages.clear();
+  uint32_t magic = 0;
+  uint32_t count = 0;
+  if (size < s_header_size) {
+    return false;
+  }
+  memcpy(&magic, frame, sizeof(magic));
+  memcpy(&count, frame + sizeof(magic), sizeof(count));
+  if (magic != s_magic) {
+    return false;
+  }
+
+  size_t offset = s_header_size;
+  for (uint32_t ii = 0; ii < count; ++ii) {
+    uint64_t message_size = 0;
+    if (size - offset < sizeof(message_size)) {
+      messages.clear();
+      return false;
+    }
+    memcpy(&message_size, frame + offset, sizeof(message_size));
+    offset += sizeof(message_size);
+    if (size - offset < message_size) {
+      messages.clear();
+      return false;
+    }
+    messages.emplace_back(frame + offset, message_size);
+    offset += message_size;
+  }
+  if (offset != size) {
+    messages.clear();
+    return false;
+  }
+  return true;
+}
+
+} // namespace dunedaq::ipm
@@ -0,0 +1,79 @@
+/**
+ *
+ * @file CoalescedBatch.hpp IPM CoalescedBatch class
+ *
+ * The frame in which CoalescingSender packs several small messages into one transport message, and CoalescingReceiver
+ * unpacks them again. A frame is an 8-byte header (a magic number and the message count, both 32-bit) followed, for
+ * each message, by its 64-bit size and its bytes. All numbers are in host byte order, since both ends run on the same
+ * kind of host.
+ *
+ * A frame is sent with the metadata of its messages followed by s_metadata_suffix, which is what marks it as a batch:
+ * any other message, whatever its payload, is passed through. Being a suffix, it leaves topic (prefix) subscriptions
+ * working.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef IPM_SRC_COALESCEDBATCH_HPP_
+#define IPM_SRC_COALESCEDBATCH_HPP_
+
+#include "ers/Issue.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace dunedaq {
+
+/**
+ * @brief An ERS Error indicating that a coalescing plugin was misconfigured or misused
+ * @param reason What was wrong
+ * @cond Doxygen doesn't like ERS macros LCOV_EXCL_START
+ */
+ERS_DECLARE_ISSUE(ipm, CoalescingError, "Coalescing plugin error: " << reason, ((std::string)reason)) // NOLINT
+/// @endcond LCOV_EXCL_STOP
+
+namespace ipm {
+
+class CoalescedBatch
+{
+public:
+  static constexpr uint32_t s_magic = 0x424d5049; // "IPMB"
+  static constexpr size_t s_header_size = 2 * sizeof(uint32_t);
+  static constexpr std::string_view s_metadata_suffix{ "\0ipm-batch", 10 };
+
+  // The metadata a batch of messages with the given metadata is sent with
+  static std::string batch_metadata(std::string const& metadata) { return metadata + std::string(s_metadata_suffix); }
+  static bool is_batch_metadata(std::string_view metadata);
+
+  CoalescedBatch() { clear(); }
+
+  void append(const void* data, size_t size);
+  // Remove the messages appended since bytes() returned frame_bytes, when count() returned message_count
+  void truncate(size_t frame_bytes, size_t message_count);
+  void clear();
+
+  bool empty() const { return m_count == 0; }
+  size_t count() const { return m_count; }
+  // Size of the frame, including its header
+  size_t bytes() const { return m_frame.size(); }
+  const char* data() const { return m_frame.data(); }
+
+  // Split a frame into (pointer, size) pairs pointing into it. Returns false, leaving messages empty, if the bytes
+  // are not a well-formed frame.
+  static bool unpack(const char* frame, size_t size, std::vector<std::pair<const char*, size_t>>& messages);
+
+private:
+  std::vector<char> m_frame;
+  uint32_t m_count{ 0 };
+};
+
+} // namespace ipm
+} // namespace dunedaq
+
+#endif // IPM_SRC_COALESCEDBATCH_HPP_
@@ -0,0 +1,159 @@
+/**
+ *
+ * @file InprocChannel.cpp ipm InprocChannel class
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "InprocChannel.hpp"
+
+#include "logging/Logging.hpp"
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+
+namespace dunedaq::ipm {
+
+std::shared_ptr<InprocChannel>
+InprocChannel::get(std::string const& connection_string, size_t capacity)
+{
+  const std::string scheme = "inproc://";
+  if (connection_string.compare(0, scheme.size(), scheme) != 0 || connection_string.size() == scheme.size()) {
+    throw InprocOperationError(
+      ERS_HERE, "parse", connection_string, "connection string must have the form inproc://name");
+  }
+
+  // Channels live for as long as a sender or receiver refers to them
+  static std::mutex s_channels_mutex;
+  static std::map<std::string, std::weak_ptr<InprocChannel>> s_channels;
+
+  std::lock_guard<std::mutex> lk(s_channels_mutex);
+  auto channel = s_channels[connection_string].lock();
+  if (channel == nullptr) {
+    channel = std::make_shared<InprocChannel>(capacity);
+    s_channels[connection_string] = channel;
+    TLOG_DEBUG(10) << "Created in-process channel " << connection_string << " with room for " << capacity
+                   << " messages";
+  }
+  return channel;
+}
+
+InprocChannel::InprocChannel(size_t capacity)
+  : m_queue(capacity)
+  , m_data_fd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+{
+  if (m_data_fd < 0) {
+    throw InprocOperationError(ERS_HERE, "eventfd creation", "", "unable to create eventfd");
+  }
+}
+
+InprocChannel::~InprocChannel()
+{
+  close(m_data_fd);
+}
+
+bool
+InprocChannel::push(InprocMessage&& message, const duration_t& timeout, std::chrono::steady_clock::duration& wait_time)
+{
+  auto start_time = std::chrono::steady_clock::now();
+  while (!m_queue.try_push(std::move(message))) {
+    auto elapsed = std::chrono::duration_cast<duration_t>(std::chrono::steady_clock::now() - start_time);
+    if (elapsed >= timeout) {
+      return false;
+    }
+
+    auto wait_start = std::chrono::steady_clock::now();
+    {
+      std::unique_lock<std::mutex> lk(m_space_mutex);
+      ++m_waiting_senders;
+      // Pairs with the fence in pop, so that either we see the room it made or it sees that we are waiting
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      auto has_room = [&] { return m_queue.size() < m_queue.capacity(); };
+      if (timeout == duration_t::max()) {
+        m_space_cv.wait(lk, has_room);
+      } else {
+        m_space_cv.wait_for(lk, timeout - elapsed, has_room);
+      }
+      --m_waiting_senders;
+    }
+    wait_time += std::chrono::steady_clock::now() - wait_start;
+  }
+
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (m_waiting_receivers.load() > 0) {
+    uint64_t signal = 1;
+    auto written = write(m_data_fd, &signal, sizeof(signal));
+    static_cast<void>(written); // The counter can only saturate if nobody is reading it, which is harmless
+  }
+  return true;
+}
+
+bool
+InprocChannel::wait_readable(const duration_t& timeout, int wakeup_fd)
+{
+  auto start_time = std::chrono::steady_clock::now();
+  while (m_queue.empty()) {
+    auto elapsed = std::chrono::duration_cast<duration_t>(std::chrono::steady_clock::now() - start_time);
+    if (elapsed >= timeout) {
+      return false;
+    }
+
+    ++m_waiting_receivers;
+    // Pairs with the fence in push, so that either we see its message or it sees that we are waiting
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    pollfd fds[] = { { m_data_fd, POLLIN, 0 }, { wakeup_fd, POLLIN, 0 } };
+    if (m_queue.empty()) {
+      duration_t::rep poll_timeout = -1;
+      if (timeout != duration_t::max()) {
+        poll_timeout = std::min<duration_t::rep>((timeout - elapsed).count(), INT_MAX);
+      }
+      poll(fds, wakeup_fd >= 0 ? 2 : 1, static_cast<int>(poll_timeout));
+    }
+    --m_waiting_receivers;
+
+    uint64_t signals = 0;
+    while (read(m_data_fd, &signals, sizeof(signals)) > 0) {
+    }
+    if (fds[1].revents & POLLIN) {
+      return !m_queue.empty();
+    }
+  }
+  return true;
+}
+
+bool
+InprocChannel::pop(InprocMessage& message, const duration_t& timeout)
+{
+  // A message which has been claimed by a sender but not yet stored makes the queue look non-empty, so keep trying
+  // until the (very short) window has passed
+  auto start_time = std::chrono::steady_clock::now();
+  while (!m_queue.try_pop(message)) {
+    auto remaining = timeout;
+    if (timeout != duration_t::max()) {
+      auto elapsed = std::chrono::duration_cast<duration_t>(std::chrono::steady_clock::now() - start_time);
+      remaining = elapsed < timeout ? timeout - elapsed : duration_t::zero();
+    }
+    if (!wait_readable(remaining)) {
+      return false;
+    }
+  }
+
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (m_waiting_senders.load() > 0) {
+    std::lock_guard<std::mutex> lk(m_space_mutex);
+    m_space_cv.notify_all();
+  }
+  return true;
+}
+
+} // namespace dunedaq::ipm
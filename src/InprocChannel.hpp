@@ -0,0 +1,103 @@
+/**
+ *
+ * @file InprocChannel.hpp IPM InprocChannel class
+ *
+ * Named, process-wide message queue shared by InprocSenders and InprocReceivers. Messages are moved through a
+ * lock-free queue, so a buffer handed to the sender reaches the receiver without being copied; the only system
+ * calls made are to wake a side which has gone to sleep on an empty or full queue.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef IPM_SRC_INPROCCHANNEL_HPP_
+#define IPM_SRC_INPROCCHANNEL_HPP_
+
+#include "LockFreeQueue.hpp"
+#include "ipm/Sender.hpp"
+
+#include "ers/Issue.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace dunedaq {
+
+/**
+ * @brief An ERS Error indicating that an in-process channel could not be set up
+ * @param operation The operation that failed
+ * @param connection_string The connection string that caused the error
+ * @param what Description of the failure
+ * @cond Doxygen doesn't like ERS macros LCOV_EXCL_START
+ */
+ERS_DECLARE_ISSUE(ipm,
+                  InprocOperationError,
+                  "Error during " << operation << " of in-process channel " << connection_string << ": " << what,
+                  ((std::string)operation)((std::string)connection_string)((std::string)what)) // NOLINT
+                                                                                               /// @endcond LCOV_EXCL_STOP
+
+namespace ipm {
+
+// A message in flight. Payloads sent by pointer are copied once, into data; owned buffers are passed on as they are.
+struct InprocMessage
+{
+  std::string metadata;
+  std::vector<char> data;
+  Sender::owned_buffer_t owned_buffer{ nullptr, nullptr };
+  size_t owned_size{ 0 };
+
+  const char* payload() const noexcept { return owned_buffer ? owned_buffer.get() : data.data(); }
+  size_t size() const noexcept { return owned_buffer ? owned_size : data.size(); }
+};
+
+class InprocChannel
+{
+public:
+  using duration_t = std::chrono::milliseconds;
+  static constexpr size_t s_default_capacity = 1024;
+
+  // Returns the channel named by an inproc://name connection string, creating it with the given capacity (in
+  // messages) if no sender or receiver currently holds it
+  static std::shared_ptr<InprocChannel> get(std::string const& connection_string, size_t capacity);
+
+  explicit InprocChannel(size_t capacity);
+  ~InprocChannel();
+
+  InprocChannel(const InprocChannel&) = delete;
+  InprocChannel& operator=(const InprocChannel&) = delete;
+  InprocChannel(InprocChannel&&) = delete;
+  InprocChannel& operator=(InprocChannel&&) = delete;
+
+  // Waits up to timeout for room in the queue. Returns false (leaving message untouched) if the timeout expired; time
+  // spent asleep is added to wait_time.
+  bool push(InprocMessage&& message, const duration_t& timeout, std::chrono::steady_clock::duration& wait_time);
+
+  // Waits up to timeout for a message. Returns false if the timeout expired.
+  bool pop(InprocMessage& message, const duration_t& timeout);
+
+  // Waits up to timeout for a message to be available, returning early (and false) if wakeup_fd (when non-negative)
+  // becomes readable
+  bool wait_readable(const duration_t& timeout, int wakeup_fd = -1);
+
+private:
+  LockFreeQueue<InprocMessage> m_queue;
+
+  // Receivers sleep in poll() on this eventfd, so that CallbackAdapter's wakeup fd can be waited on alongside it
+  int m_data_fd{ -1 };
+  std::atomic<size_t> m_waiting_receivers{ 0 };
+
+  std::mutex m_space_mutex;
+  std::condition_variable m_space_cv;
+  std::atomic<size_t> m_waiting_senders{ 0 };
+};
+
+} // namespace ipm
+} // namespace dunedaq
+
+#endif // IPM_SRC_INPROCCHANNEL_HPP_
@@ -0,0 +1,59 @@
+/**
+ * @file LatencyHistogram.cpp LatencyHistogram Class implementations
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "ipm/LatencyHistogram.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+uint64_t
+dunedaq::ipm::LatencyHistogram::bucket_upper_ns(size_t index) noexcept
+{
+  if (index < (size_t(1) << s_sub_bucket_bits)) {
+    return index;
+  }
+  size_t msb = (index >> s_sub_bucket_bits) + s_sub_bucket_bits - 1;
+  uint64_t sub_bucket = index & ((size_t(1) << s_sub_bucket_bits) - 1);
+  uint64_t width = uint64_t(1) << (msb - s_sub_bucket_bits);
+  return (((uint64_t(1) << s_sub_bucket_bits) + sub_bucket) << (msb - s_sub_bucket_bits)) + (width - 1);
+}
+
+dunedaq::ipm::LatencyHistogram::Summary
+dunedaq::ipm::LatencyHistogram::take() noexcept
+{
+  std::array<uint64_t, s_bucket_count> counts;
+  Summary summary;
+  for (size_t ii = 0; ii < s_bucket_count; ++ii) {
+    counts[ii] = m_buckets[ii].exchange(0, std::memory_order_relaxed);
+    summary.count += counts[ii];
+  }
+  auto max_ns = m_max_ns.exchange(0, std::memory_order_relaxed);
+  if (summary.count == 0) {
+    return summary;
+  }
+
+  // Each percentile is reported as the top of the bucket it falls in, but never above the largest value seen
+  auto percentile_us = [&](double fraction) {
+    auto rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(fraction * summary.count)));
+    uint64_t seen = 0;
+    size_t index = 0;
+    for (; index < s_bucket_count - 1; ++index) {
+      seen += counts[index];
+      if (seen >= rank) {
+        break;
+      }
+    }
+    return static_cast<double>(std::min(bucket_upper_ns(index), max_ns)) / 1000.;
+  };
+  summary.p50_us = percentile_us(0.5);
+  summary.p90_us = percentile_us(0.9);
+  summary.p99_us = percentile_us(0.99);
+  summary.max_us = static_cast<double>(max_ns) / 1000.;
+  return summary;
+}
@@ -0,0 +1,125 @@
+/**
+ *
+ * @file LockFreeQueue.hpp IPM LockFreeQueue class
+ *
+ * Bounded multi-producer/multi-consumer queue after D. Vyukov's array-based design: each slot carries a sequence
+ * number which tells producers and consumers whether it is theirs to fill or drain, so neither side ever takes a lock.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef IPM_SRC_LOCKFREEQUEUE_HPP_
+#define IPM_SRC_LOCKFREEQUEUE_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+namespace dunedaq {
+namespace ipm {
+
+template<typename T>
+class LockFreeQueue
+{
+public:
+  // Capacity is rounded up to the next power of two
+  explicit LockFreeQueue(size_t capacity)
+  {
+    size_t size = 2;
+    while (size < capacity) {
+      size <<= 1;
+    }
+    m_mask = size - 1;
+    m_buffer.reset(new Cell[size]);
+    for (size_t ii = 0; ii < size; ++ii) {
+      m_buffer[ii].sequence.store(ii, std::memory_order_relaxed);
+    }
+  }
+
+  LockFreeQueue(const LockFreeQueue&) = delete;
+  LockFreeQueue& operator=(const LockFreeQueue&) = delete;
+  LockFreeQueue(LockFreeQueue&&) = delete;
+  LockFreeQueue& operator=(LockFreeQueue&&) = delete;
+
+  // Returns false (leaving item untouched) if the queue is full
+  bool try_push(T&& item)
+  {
+    Cell* cell;
+    size_t pos = m_enqueue_pos.load(std::memory_order_relaxed);
+    while (true) {
+      cell = &m_buffer[pos & m_mask];
+      size_t seq = cell->sequence.load(std::memory_order_acquire);
+      auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+      if (diff == 0) {
+        if (m_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = m_enqueue_pos.load(std::memory_order_relaxed);
+      }
+    }
+    cell->data = std::move(item);
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Returns false if the queue is empty
+  bool try_pop(T& item)
+  {
+    Cell* cell;
+    size_t pos = m_dequeue_pos.load(std::memory_order_relaxed);
+    while (true) {
+      cell = &m_buffer[pos & m_mask];
+      size_t seq = cell->sequence.load(std::memory_order_acquire);
+      auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos + 1);
+      if (diff == 0) {
+        if (m_dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = m_dequeue_pos.load(std::memory_order_relaxed);
+      }
+    }
+    item = std::move(cell->data);
+    cell->data = T();
+    cell->sequence.store(pos + m_mask + 1, std::memory_order_release);
+    return true;
+  }
+
+  size_t capacity() const noexcept { return m_mask + 1; }
+
+  // Only a snapshot when other threads are pushing or popping
+  size_t size() const noexcept
+  {
+    auto dequeue_pos = m_dequeue_pos.load(std::memory_order_relaxed);
+    auto enqueue_pos = m_enqueue_pos.load(std::memory_order_relaxed);
+    return enqueue_pos > dequeue_pos ? enqueue_pos - dequeue_pos : 0;
+  }
+  bool empty() const noexcept { return size() == 0; }
+
+private:
+  static constexpr size_t s_cache_line_size = 64;
+
+  struct Cell
+  {
+    std::atomic<size_t> sequence;
+    T data;
+  };
+
+  std::unique_ptr<Cell[]> m_buffer;
+  size_t m_mask{ 0 };
+  alignas(s_cache_line_size) std::atomic<size_t> m_enqueue_pos{ 0 };
+  alignas(s_cache_line_size) std::atomic<size_t> m_dequeue_pos{ 0 };
+};
+
+} // namespace ipm
+} // namespace dunedaq
+
+#endif // IPM_SRC_LOCKFREEQUEUE_HPP_
@@ -9,27 +9,298 @@
 #include "ipm/Receiver.hpp"
 #include "ipm/opmon/ipm.pb.h"
 
+#include <poll.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <utility>
+#include <vector>
+
 dunedaq::ipm::Receiver::Response
 dunedaq::ipm::Receiver::receive(const duration_t& timeout, message_size_t bytes, bool no_tmoexcept_mode)
+{
+  return receive_and_count_(timeout, bytes, no_tmoexcept_mode, true);
+}
+
+dunedaq::ipm::Receiver::Response
+dunedaq::ipm::Receiver::receive_and_count_(const duration_t& timeout,
+                                           message_size_t bytes,
+                                           bool no_tmoexcept_mode,
+                                           bool count_empty_poll)
+{
+  if (!can_receive()) {
+    throw KnownStateForbidsReceive(ERS_HERE);
+  }
+  auto start_time = std::chrono::steady_clock::now();
+  Response message;
+  try {
+    message = m_waited_message ? take_waited_message_() : receive_(timeout, no_tmoexcept_mode);
+  } catch (ReceiveTimeoutExpired const&) {
+    count_no_message_(timeout, count_empty_poll);
+    throw;
+  }
+  if (!message.data.empty() || !message.metadata.empty()) {
+    m_receive_time.record(std::chrono::steady_clock::now() - start_time);
+  } else {
+    count_no_message_(timeout, count_empty_poll);
+  }
+
+  if (bytes != s_any_size) {
+    auto received_size = message.data.size();
+    if (received_size != bytes) {
+      throw UnexpectedNumberOfBytes(ERS_HERE, received_size, bytes);
+    }
+  }
+
+  if (!message.data.empty() || !message.metadata.empty()) {
+    m_bytes += message.data.size();
+    ++m_messages;
+  }
+
+  return message;
+}
+
+size_t
+dunedaq::ipm::Receiver::receive_many(std::vector<Response>& responses,
+                                     size_t max_count,
+                                     const duration_t& timeout,
+                                     message_size_t bytes,
+                                     bool no_tmoexcept_mode)
+{
+  if (!can_receive()) {
+    throw KnownStateForbidsReceive(ERS_HERE);
+  }
+  if (max_count == 0) {
+    responses.clear();
+    return 0;
+  }
+
+  if (responses.size() < max_count) {
+    responses.resize(max_count);
+  }
+  auto start_time = std::chrono::steady_clock::now();
+  size_t received = 0;
+  if (m_waited_message) {
+    // Anything queued behind the message kept by wait_for_message is taken as receive_many_ does by default
+    responses[received++] = take_waited_message_();
+    while (received < max_count) {
+      auto message = receive_(s_no_block, true);
+      if (message.data.empty() && message.metadata.empty()) {
+        break;
+      }
+      responses[received++] = std::move(message);
+    }
+  } else {
+    received = receive_many_(responses, max_count, timeout);
+  }
+  if (received != 0) {
+    m_receive_time.record(std::chrono::steady_clock::now() - start_time);
+  } else {
+    count_no_message_(timeout);
+  }
+  responses.resize(received);
+
+  size_t received_bytes = 0;
+  for (auto& message : responses) {
+    if (bytes != s_any_size) {
+      auto received_size = message.data.size();
+      if (received_size != bytes) {
+        throw UnexpectedNumberOfBytes(ERS_HERE, received_size, bytes);
+      }
+    }
+    received_bytes += message.data.size();
+  }
+  m_bytes += received_bytes;
+  m_messages += received;
+
+  if (received == 0 && !no_tmoexcept_mode) {
+    throw ReceiveTimeoutExpired(ERS_HERE, timeout.count());
+  }
+  return received;
+}
+
+size_t
+dunedaq::ipm::Receiver::receive_many_(std::vector<Response>& responses, size_t max_count, const duration_t& timeout)
+{
+  size_t received = 0;
+  while (received < max_count) {
+    auto message = receive_(received == 0 ? timeout : s_no_block, true);
+    if (message.data.empty() && message.metadata.empty()) {
+      break;
+    }
+    responses[received++] = std::move(message);
+  }
+  return received;
+}
+
+dunedaq::ipm::Receiver::IntoResponse
+dunedaq::ipm::Receiver::receive_into(void* dst,
+                                     size_t capacity,
+                                     const duration_t& timeout,
+                                     message_size_t bytes,
+                                     bool no_tmoexcept_mode)
+{
+  if (!can_receive()) {
+    throw KnownStateForbidsReceive(ERS_HERE);
+  }
+  auto start_time = std::chrono::steady_clock::now();
+  IntoResponse message;
+  try {
+    message = m_waited_message ? copy_into_(take_waited_message_(), dst, capacity)
+                               : receive_into_(dst, capacity, timeout, no_tmoexcept_mode);
+  } catch (ReceiveTimeoutExpired const&) {
+    count_no_message_(timeout);
+    throw;
+  }
+  if (message.size != 0 || !message.metadata.empty()) {
+    m_receive_time.record(std::chrono::steady_clock::now() - start_time);
+  } else {
+    count_no_message_(timeout);
+  }
+
+  if (bytes != s_any_size) {
+    auto received_size = message.size;
+    if (received_size != bytes) {
+      throw UnexpectedNumberOfBytes(ERS_HERE, received_size, bytes);
+    }
+  }
+
+  if (message.size != 0 || !message.metadata.empty()) {
+    m_bytes += message.size;
+    ++m_messages;
+  }
+
+  return message;
+}
+
+dunedaq::ipm::Receiver::IntoResponse
+dunedaq::ipm::Receiver::receive_into_(void* dst, size_t capacity, const duration_t& timeout, bool no_tmoexcept_mode)
+{
+  return copy_into_(receive_(timeout, no_tmoexcept_mode), dst, capacity);
+}
+
+dunedaq::ipm::Receiver::IntoResponse
+dunedaq::ipm::Receiver::copy_into_(Response&& message, void* dst, size_t capacity)
+{
+  IntoResponse output;
+  output.size = message.data.size();
+  output.truncated = output.size > capacity;
+  if (output.size != 0) {
+    memcpy(dst, message.data.data(), std::min(output.size, capacity));
+  }
+  output.metadata = std::move(message.metadata);
+  release(std::move(message));
+  return output;
+}
+
+dunedaq::ipm::Receiver::ResponseView::ResponseView(Response&& response)
+{
+  auto owner = std::make_shared<Response>(std::move(response));
+  m_data = owner->data.data();
+  m_size = owner->data.size();
+  m_metadata = owner->metadata;
+  m_owner = std::move(owner);
+}
+
+dunedaq::ipm::Receiver::ResponseView
+dunedaq::ipm::Receiver::receive_view(const duration_t& timeout, message_size_t bytes, bool no_tmoexcept_mode)
+{
+  return receive_view_and_count_(timeout, bytes, no_tmoexcept_mode, true);
+}
+
+dunedaq::ipm::Receiver::ResponseView
+dunedaq::ipm::Receiver::receive_view_and_count_(const duration_t& timeout,
+                                                message_size_t bytes,
+                                                bool no_tmoexcept_mode,
+                                                bool count_empty_poll)
 {
   if (!can_receive()) {
     throw KnownStateForbidsReceive(ERS_HERE);
   }
-  auto message = receive_(timeout, no_tmoexcept_mode);
+  auto start_time = std::chrono::steady_clock::now();
+  ResponseView message;
+  try {
+    message = m_waited_message ? ResponseView(take_waited_message_()) : receive_view_(timeout, no_tmoexcept_mode);
+  } catch (ReceiveTimeoutExpired const&) {
+    count_no_message_(timeout, count_empty_poll);
+    throw;
+  }
+  if (!message.empty()) {
+    m_receive_time.record(std::chrono::steady_clock::now() - start_time);
+  } else {
+    count_no_message_(timeout, count_empty_poll);
+  }
 
   if (bytes != s_any_size) {
-    auto received_size = static_cast<message_size_t>(message.data.size());
+    auto received_size = message.size();
     if (received_size != bytes) {
       throw UnexpectedNumberOfBytes(ERS_HERE, received_size, bytes);
     }
   }
 
-  m_bytes += message.data.size();
-  ++m_messages;
+  if (!message.empty()) {
+    m_bytes += message.size();
+    ++m_messages;
+  }
+
+  return message;
+}
+
+dunedaq::ipm::Receiver::ResponseView
+dunedaq::ipm::Receiver::receive_view_(const duration_t& timeout, bool no_tmoexcept_mode)
+{
+  return ResponseView(receive_(timeout, no_tmoexcept_mode));
+}
+
+bool
+dunedaq::ipm::Receiver::wait_for_message(const duration_t& timeout, int wakeup_fd)
+{
+  if (m_waited_message) {
+    return true;
+  }
+
+  // The transport can only be waited on by receiving from it
+  auto start_time = std::chrono::steady_clock::now();
+  while (true) {
+    if (wakeup_fd >= 0) {
+      pollfd wakeup{ wakeup_fd, POLLIN, 0 };
+      if (poll(&wakeup, 1, 0) > 0) {
+        return false;
+      }
+    }
+
+    auto elapsed = std::chrono::duration_cast<duration_t>(std::chrono::steady_clock::now() - start_time);
+    auto remaining = timeout == s_block ? s_block : (elapsed < timeout ? timeout - elapsed : s_no_block);
+    auto message = receive_(std::min(remaining, s_wait_slice), true);
+    if (!message.data.empty() || !message.metadata.empty()) {
+      m_waited_message = std::move(message);
+      return true;
+    }
+    if (remaining <= s_wait_slice) {
+      return false;
+    }
+  }
+}
 
+dunedaq::ipm::Receiver::Response
+dunedaq::ipm::Receiver::take_waited_message_()
+{
+  auto message = std::move(*m_waited_message);
+  m_waited_message.reset();
   return message;
 }
 
+void
+dunedaq::ipm::Receiver::register_view_callback(std::function<void(ResponseView&)> callback)
+{
+  register_callback([callback](Response& response) {
+    ResponseView view(std::move(response));
+    callback(view);
+  });
+}
+
 void
 dunedaq::ipm::Receiver::generate_opmon_data()
 {
@@ -38,6 +309,24 @@ dunedaq::ipm::Receiver::generate_opmon_data()
 
   i.set_bytes(m_bytes.exchange(0));
   i.set_messages(m_messages.exchange(0));
+  i.set_pool_hits(m_buffer_pool.take_hits());
+  i.set_pool_misses(m_buffer_pool.take_misses());
+  i.set_pool_bytes_held(m_buffer_pool.bytes_held());
+  i.set_receive_timeouts(m_receive_timeouts.exchange(0));
+  i.set_empty_polls(m_empty_polls.exchange(0));
+  i.set_callback_exceptions(m_callback_exceptions.exchange(0));
+
+  auto receive_time = m_receive_time.take();
+  i.set_receive_time_p50_us(receive_time.p50_us);
+  i.set_receive_time_p90_us(receive_time.p90_us);
+  i.set_receive_time_p99_us(receive_time.p99_us);
+  i.set_receive_time_max_us(receive_time.max_us);
+
+  auto callback_time = m_callback_time.take();
+  i.set_callback_time_p50_us(callback_time.p50_us);
+  i.set_callback_time_p90_us(callback_time.p90_us);
+  i.set_callback_time_p99_us(callback_time.p99_us);
+  i.set_callback_time_max_us(callback_time.max_us);
 
   publish(std::move(i));
 }
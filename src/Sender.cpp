@@ -7,11 +7,24 @@
  */
 
 #include "ipm/Sender.hpp"
+#include "AsyncSendQueue.hpp"
 #include "ipm/opmon/ipm.pb.h"
 
+#include <chrono>
+#include <cstring>
+#include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
+dunedaq::ipm::Sender::Sender() = default;
+
+dunedaq::ipm::Sender::~Sender()
+{
+  // Implementations should already have done this, before their transport was torn down
+  stop_async_sends();
+}
+
 bool
 dunedaq::ipm::Sender::send(const void* message,
                            message_size_t message_size,
@@ -27,11 +40,119 @@ dunedaq::ipm::Sender::send(const void* message,
     throw KnownStateForbidsSend(ERS_HERE);
   }
 
+  check_message_size_(message_size);
   if (!message) {
     throw NullPointerPassedToSend(ERS_HERE);
   }
 
-  auto res = send_(message, message_size, timeout, metadata, no_tmoexcept_mode);
+  auto start_time = std::chrono::steady_clock::now();
+  bool res = false;
+  try {
+    res = send_(message, message_size, timeout, metadata, no_tmoexcept_mode);
+  } catch (SendTimeoutExpired const&) {
+    ++m_send_timeouts;
+    throw;
+  }
+  m_send_time.record(std::chrono::steady_clock::now() - start_time);
+  if (!res) {
+    ++m_send_timeouts;
+  }
+
+  m_bytes += message_size;
+  ++m_messages;
+
+  return res;
+}
+
+bool
+dunedaq::ipm::Sender::send(owned_buffer_t message,
+                           message_size_t message_size,
+                           const duration_t& timeout,
+                           std::string const& metadata,
+                           bool no_tmoexcept_mode)
+{
+  if (message_size == 0) {
+    return true;
+  }
+
+  if (!can_send()) {
+    throw KnownStateForbidsSend(ERS_HERE);
+  }
+
+  check_message_size_(message_size);
+  if (!message) {
+    throw NullPointerPassedToSend(ERS_HERE);
+  }
+
+  auto start_time = std::chrono::steady_clock::now();
+  bool res = false;
+  try {
+    res = send_owned_(std::move(message), message_size, timeout, metadata, no_tmoexcept_mode);
+  } catch (SendTimeoutExpired const&) {
+    ++m_send_timeouts;
+    throw;
+  }
+  m_send_time.record(std::chrono::steady_clock::now() - start_time);
+  if (!res) {
+    ++m_send_timeouts;
+  }
+
+  m_bytes += message_size;
+  ++m_messages;
+
+  return res;
+}
+
+bool
+dunedaq::ipm::Sender::send_owned_(owned_buffer_t message,
+                                  message_size_t N,
+                                  const duration_t& timeout,
+                                  std::string const& metadata,
+                                  bool no_tmoexcept_mode)
+{
+  return send_(message.get(), N, timeout, metadata, no_tmoexcept_mode);
+}
+
+bool
+dunedaq::ipm::Sender::send_segments(const Segment* segments,
+                                    size_t segment_count,
+                                    const duration_t& timeout,
+                                    std::string const& metadata,
+                                    bool no_tmoexcept_mode)
+{
+  // Checked before they are added up, so that a negative size cannot cancel out the others
+  message_size_t message_size = 0;
+  for (size_t ii = 0; ii < segment_count; ++ii) {
+    check_message_size_(segments[ii].size);
+    message_size += segments[ii].size;
+  }
+  check_message_size_(message_size);
+  if (message_size == 0) {
+    return true;
+  }
+
+  if (!can_send()) {
+    throw KnownStateForbidsSend(ERS_HERE);
+  }
+
+  for (size_t ii = 0; ii < segment_count; ++ii) {
+    if (segments[ii].size != 0 && !segments[ii].data) {
+      throw NullPointerPassedToSend(ERS_HERE);
+    }
+  }
+
+  auto start_time = std::chrono::steady_clock::now();
+  bool res = false;
+  try {
+    res = send_segments_(segments, segment_count, message_size, timeout, metadata, no_tmoexcept_mode);
+  } catch (SendTimeoutExpired const&) {
+    ++m_send_timeouts;
+    throw;
+  }
+  m_send_time.record(std::chrono::steady_clock::now() - start_time);
+  if (!res) {
+    ++m_send_timeouts;
+  }
 
   m_bytes += message_size;
   ++m_messages;
@@ -39,6 +160,197 @@ dunedaq::ipm::Sender::send(const void* message,
   return res;
 }
 
+bool
+dunedaq::ipm::Sender::send_segments_(const Segment* segments,
+                                     size_t segment_count,
+                                     message_size_t N,
+                                     const duration_t& timeout,
+                                     std::string const& metadata,
+                                     bool no_tmoexcept_mode)
+{
+  std::vector<char> message;
+  message.reserve(N);
+  for (size_t ii = 0; ii < segment_count; ++ii) {
+    auto data = static_cast<const char*>(segments[ii].data);
+    message.insert(message.end(), data, data + segments[ii].size);
+  }
+  return send_(message.data(), N, timeout, metadata, no_tmoexcept_mode);
+}
+
+size_t
+dunedaq::ipm::Sender::send_batch(const BatchEntry* entries,
+                                 size_t count,
+                                 const duration_t& timeout,
+                                 bool no_tmoexcept_mode)
+{
+  if (count == 0) {
+    return 0;
+  }
+
+  if (!can_send()) {
+    throw KnownStateForbidsSend(ERS_HERE);
+  }
+
+  if (!entries) {
+    throw NullPointerPassedToSend(ERS_HERE);
+  }
+  for (size_t ii = 0; ii < count; ++ii) {
+    check_message_size_(entries[ii].size);
+    if (entries[ii].size != 0 && !entries[ii].message) {
+      throw NullPointerPassedToSend(ERS_HERE);
+    }
+  }
+
+  auto start_time = std::chrono::steady_clock::now();
+  auto accepted = send_batch_(entries, count, timeout);
+  m_send_time.record(std::chrono::steady_clock::now() - start_time);
+
+  size_t bytes = 0;
+  size_t messages = 0;
+  for (size_t ii = 0; ii < accepted; ++ii) {
+    if (entries[ii].size != 0) {
+      bytes += entries[ii].size;
+      ++messages;
+    }
+  }
+  m_bytes += bytes;
+  m_messages += messages;
+
+  if (accepted < count) {
+    ++m_send_timeouts;
+    if (!no_tmoexcept_mode) {
+      throw SendTimeoutExpired(ERS_HERE, timeout.count());
+    }
+  }
+  return accepted;
+}
+
+size_t
+dunedaq::ipm::Sender::send_batch_(const BatchEntry* entries, size_t count, const duration_t& timeout)
+{
+  auto start_time = std::chrono::steady_clock::now();
+  size_t accepted = 0;
+  for (; accepted < count; ++accepted) {
+    auto& entry = entries[accepted];
+    if (entry.size == 0) {
+      continue;
+    }
+
+    auto remaining = timeout;
+    if (timeout != s_block) {
+      auto elapsed = std::chrono::duration_cast<duration_t>(std::chrono::steady_clock::now() - start_time);
+      remaining = elapsed < timeout ? timeout - elapsed : s_no_block;
+    }
+    if (!send_(entry.message, entry.size, remaining, std::string(entry.metadata), true)) {
+      break;
+    }
+  }
+  return accepted;
+}
+
+std::future<bool>
+dunedaq::ipm::Sender::send_async(owned_buffer_t message,
+                                 message_size_t message_size,
+                                 const duration_t& timeout,
+                                 std::string const& metadata)
+{
+  auto promise = std::make_shared<std::promise<bool>>();
+  auto future = promise->get_future();
+  send_async(std::move(message), message_size, timeout, metadata, [promise](bool sent, std::exception_ptr error) {
+    if (error) {
+      promise->set_exception(error);
+    } else {
+      promise->set_value(sent);
+    }
+  });
+  return future;
+}
+
+std::future<bool>
+dunedaq::ipm::Sender::send_async(const void* message,
+                                 message_size_t message_size,
+                                 const duration_t& timeout,
+                                 std::string const& metadata)
+{
+  check_async_send_(message, message_size);
+  owned_buffer_t buffer(new char[message_size], std::default_delete<char[]>());
+  if (message_size != 0) {
+    memcpy(buffer.get(), message, message_size);
+  }
+  return send_async(std::move(buffer), message_size, timeout, metadata);
+}
+
+void
+dunedaq::ipm::Sender::send_async(owned_buffer_t message,
+                                 message_size_t message_size,
+                                 const duration_t& timeout,
+                                 std::string const& metadata,
+                                 async_callback_t callback)
+{
+  check_async_send_(message.get(), message_size);
+  async_queue_().push({ std::move(message), message_size, timeout, metadata, std::move(callback) });
+}
+
+bool
+dunedaq::ipm::Sender::flush_async(const duration_t& timeout)
+{
+  auto async_queue = m_async_queue_ptr.load(std::memory_order_acquire);
+  return async_queue == nullptr || async_queue->flush(timeout);
+}
+
+void
+dunedaq::ipm::Sender::stop_async_sends()
+{
+  std::lock_guard<std::mutex> lk(m_async_mutex);
+  if (m_async_queue != nullptr) {
+    m_async_queue->stop();
+  }
+}
+
+dunedaq::ipm::AsyncSendQueue&
+dunedaq::ipm::Sender::async_queue_()
+{
+  auto async_queue = m_async_queue_ptr.load(std::memory_order_acquire);
+  if (async_queue == nullptr) {
+    std::lock_guard<std::mutex> lk(m_async_mutex);
+    if (m_async_queue == nullptr) {
+      // The async thread calls send(), with no_tmoexcept_mode so that an expired timeout is reported as false
+      m_async_queue = std::make_unique<AsyncSendQueue>(m_async_queue_capacity, [this](AsyncSend& entry) {
+        return send(std::move(entry.message), entry.size, entry.timeout, entry.metadata, true);
+      });
+      m_async_queue_ptr.store(m_async_queue.get(), std::memory_order_release);
+    }
+    async_queue = m_async_queue.get();
+  }
+  return *async_queue;
+}
+
+void
+dunedaq::ipm::Sender::check_message_size_(message_size_t message_size)
+{
+  if (message_size > s_max_message_size) {
+    throw InvalidMessageSize(ERS_HERE, message_size);
+  }
+}
+
+void
+dunedaq::ipm::Sender::check_async_send_(const void* message, message_size_t message_size) const
+{
+  // The same checks as send(), made here so that the caller hears of them at once
+  if (message_size == 0) {
+    return;
+  }
+
+  if (!can_send()) {
+    throw KnownStateForbidsSend(ERS_HERE);
+  }
+
+  check_message_size_(message_size);
+  if (!message) {
+    throw NullPointerPassedToSend(ERS_HERE);
+  }
+}
+
 void
 dunedaq::ipm::Sender::generate_opmon_data()
 {
@@ -47,6 +359,23 @@ dunedaq::ipm::Sender::generate_opmon_data()
 
   i.set_bytes(m_bytes.exchange(0));
   i.set_messages(m_messages.exchange(0));
+  i.set_wait_time_us(m_wait_time_us.exchange(0));
+  i.set_send_timeouts(m_send_timeouts.exchange(0));
+  i.set_send_retries(m_send_retries.exchange(0));
+  i.set_partial_multipart_failures(m_partial_multipart_failures.exchange(0));
+
+  auto send_time = m_send_time.take();
+  i.set_send_time_p50_us(send_time.p50_us);
+  i.set_send_time_p90_us(send_time.p90_us);
+  i.set_send_time_p99_us(send_time.p99_us);
+  i.set_send_time_max_us(send_time.max_us);
+
+  auto async_queue = m_async_queue_ptr.load(std::memory_order_acquire);
+  if (async_queue != nullptr) {
+    i.set_async_queue_depth(async_queue->depth());
+    i.set_async_queue_max_depth(async_queue->take_max_depth());
+    i.set_async_rejected(async_queue->take_rejected());
+  }
 
   publish(std::move(i));
 }
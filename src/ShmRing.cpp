@@ -0,0 +1,497 @@
+/**
+ *
+ * @file ShmRing.cpp ipm ShmRing class
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "ShmRing.hpp"
+
+#include "logging/Logging.hpp"
+
+#include <fcntl.h>
+#include <signal.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <thread>
+
+namespace dunedaq::ipm {
+
+namespace {
+
+constexpr int s_attach_attempts = 1000; // Milliseconds to wait for another process to finish creating a segment
+constexpr int s_spin_iterations = 1000;  // Checks before going to sleep, so that back-to-back messages avoid syscalls
+constexpr int s_attach_poll_us = 1000;   // How often a sender waiting for its receiver's segment looks for it
+
+std::atomic<uint32_t> s_sender_count{ 0 };
+
+// Spinning only helps if the other side can run at the same time
+const bool s_spin_enabled = std::thread::hardware_concurrency() > 1;
+
+template<typename Condition>
+bool
+spin_until(Condition condition)
+{
+  for (int ii = 0; s_spin_enabled && ii < s_spin_iterations; ++ii) {
+    if (condition()) {
+      return true;
+    }
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+  }
+  return condition();
+}
+
+// The futex words live in a MAP_SHARED mapping, so the (non-private) futex operations work across processes
+void
+futex_wait(std::atomic<uint32_t>* word, uint32_t expected, const ShmRing::duration_t& timeout)
+{
+  timespec ts{};
+  timespec* tsp = nullptr;
+  if (timeout != ShmRing::duration_t::max()) {
+    ts.tv_sec = timeout.count() / 1000;
+    ts.tv_nsec = (timeout.count() % 1000) * 1000000;
+    tsp = &ts;
+  }
+  // EAGAIN (the word already changed), EINTR and ETIMEDOUT are all handled by the caller re-checking its condition
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT, expected, tsp, nullptr, 0);
+}
+
+void
+futex_wake(std::atomic<uint32_t>* word)
+{
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+}
+
+} // namespace ""
+
+std::string
+ShmRing::name_from_uri(std::string const& connection_string)
+{
+  const std::string scheme = "shm://";
+  if (connection_string.compare(0, scheme.size(), scheme) != 0 || connection_string.size() == scheme.size() ||
+      connection_string.find('/', scheme.size()) != std::string::npos) {
+    throw ShmOperationError(ERS_HERE, "parse", connection_string, "connection string must have the form shm://name");
+  }
+  return connection_string.substr(scheme.size());
+}
+
+ShmRing::ShmRing(std::string const& name, size_t capacity, bool owner)
+  : m_name(name)
+  , m_owner(owner)
+{
+  if (!m_owner) {
+    m_sender_id = (static_cast<uint64_t>(getpid()) << 32) | ++s_sender_count;
+  }
+  if (m_owner) {
+    create(capacity);
+  } else if (!attach()) {
+    TLOG_DEBUG(10) << "Shared-memory ring " << m_name << " does not exist yet, waiting for its receiver";
+  }
+}
+
+ShmRing::~ShmRing()
+{
+  if (m_header == nullptr) {
+    return;
+  }
+  if (m_owner) {
+    // If a new receiver has already replaced the segment, the name is now its
+    bool replaced = m_header->closed.load() != 0;
+    close_segment(m_header);
+    if (!replaced) {
+      shm_unlink(shm_name().c_str());
+    }
+  }
+  detach();
+}
+
+void
+ShmRing::close_segment(Header* header)
+{
+  // Wake both sides, so that a sender waiting for room notices and moves on
+  header->closed.store(1);
+  header->space_seq.fetch_add(1);
+  futex_wake(&header->space_seq);
+  header->data_seq.fetch_add(1);
+  futex_wake(&header->data_seq);
+}
+
+bool
+ShmRing::live(const Header* header)
+{
+  if (header->closed.load() != 0) {
+    return false;
+  }
+  return process_live(header->receiver_pid.load());
+}
+
+bool
+ShmRing::sender_live(uint64_t sender_id)
+{
+  // A sender in this process is running until it releases its claim
+  return process_live(static_cast<int32_t>(sender_id >> 32));
+}
+
+bool
+ShmRing::process_live(int32_t pid)
+{
+  return pid == getpid() || kill(pid, 0) == 0 || errno == EPERM;
+}
+
+void
+ShmRing::create(size_t capacity)
+{
+  remove_stale();
+
+  int fd = shm_open(shm_name().c_str(), O_RDWR | O_CREAT | O_EXCL, 0660);
+  if (fd < 0) {
+    throw ShmOperationError(ERS_HERE, "shm_open", m_name, strerror(errno));
+  }
+
+  size_t ring_size = 4096;
+  while (ring_size < capacity) {
+    ring_size <<= 1;
+  }
+  m_mapped_size = sizeof(Header) + ring_size;
+  if (ftruncate(fd, static_cast<off_t>(m_mapped_size)) != 0) {
+    auto err = errno;
+    close(fd);
+    shm_unlink(shm_name().c_str());
+    throw ShmOperationError(ERS_HERE, "ftruncate", m_name, strerror(err));
+  }
+
+  void* addr = mmap(nullptr, m_mapped_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  auto err = errno;
+  close(fd);
+  if (addr == MAP_FAILED) {
+    shm_unlink(shm_name().c_str());
+    throw ShmOperationError(ERS_HERE, "mmap", m_name, strerror(err));
+  }
+  m_header = static_cast<Header*>(addr);
+  m_data = static_cast<char*>(addr) + sizeof(Header);
+
+  // A freshly truncated segment is zero-filled, so only these need setting before it is published
+  m_header->capacity = ring_size;
+  m_header->receiver_pid.store(getpid());
+  m_header->magic.store(s_magic, std::memory_order_release);
+  m_capacity = ring_size;
+
+  TLOG_DEBUG(10) << "Created shared-memory ring " << m_name << " of " << m_capacity << " bytes";
+}
+
+void
+ShmRing::remove_stale()
+{
+  int fd = shm_open(shm_name().c_str(), O_RDWR, 0);
+  if (fd < 0) {
+    return;
+  }
+
+  // Close the old segment, so that a sender still attached to it moves on to ours, unless its receiver is running
+  struct stat st = {};
+  void* addr = MAP_FAILED;
+  if (fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) >= sizeof(Header)) {
+    addr = mmap(nullptr, sizeof(Header), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  }
+  close(fd);
+  if (addr != MAP_FAILED) {
+    auto header = static_cast<Header*>(addr);
+    if (header->magic.load(std::memory_order_acquire) == s_magic) {
+      if (live(header)) {
+        auto pid = header->receiver_pid.load();
+        munmap(addr, sizeof(Header));
+        throw ShmOperationError(
+          ERS_HERE, "create", m_name, "already bound by the receiver in process " + std::to_string(pid));
+      }
+      close_segment(header);
+    }
+    munmap(addr, sizeof(Header));
+  }
+
+  shm_unlink(shm_name().c_str());
+  TLOG_DEBUG(10) << "Removed stale shared-memory ring " << m_name;
+}
+
+bool
+ShmRing::attach()
+{
+  int fd = shm_open(shm_name().c_str(), O_RDWR, 0);
+  if (fd < 0) {
+    if (errno == ENOENT) {
+      return false;
+    }
+    throw ShmOperationError(ERS_HERE, "shm_open", m_name, strerror(errno));
+  }
+
+  // The receiver may still be sizing the segment
+  struct stat st = {};
+  for (int attempt = 0; fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) <= sizeof(Header); ++attempt) {
+    if (attempt == s_attach_attempts) {
+      close(fd);
+      throw ShmOperationError(ERS_HERE, "attach", m_name, "segment was never sized by its creator");
+    }
+    usleep(1000);
+  }
+  m_mapped_size = static_cast<size_t>(st.st_size);
+  if (m_mapped_size <= sizeof(Header)) {
+    auto err = errno;
+    close(fd);
+    throw ShmOperationError(ERS_HERE, "fstat", m_name, strerror(err));
+  }
+
+  void* addr = mmap(nullptr, m_mapped_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  auto err = errno;
+  close(fd);
+  if (addr == MAP_FAILED) {
+    throw ShmOperationError(ERS_HERE, "mmap", m_name, strerror(err));
+  }
+  m_header = static_cast<Header*>(addr);
+  m_data = static_cast<char*>(addr) + sizeof(Header);
+
+  for (int attempt = 0; m_header->magic.load(std::memory_order_acquire) != s_magic; ++attempt) {
+    if (attempt == s_attach_attempts) {
+      detach();
+      throw ShmOperationError(ERS_HERE, "attach", m_name, "segment was never initialized by its creator");
+    }
+    usleep(1000);
+  }
+  m_capacity = m_header->capacity;
+  if (sizeof(Header) + m_capacity != m_mapped_size) {
+    detach();
+    throw ShmOperationError(ERS_HERE, "attach", m_name, "segment size does not match its header");
+  }
+  if (!live(m_header)) {
+    // Left behind by a receiver which has gone away; wait for the next one to replace it
+    detach();
+    return false;
+  }
+  claim();
+
+  TLOG_DEBUG(10) << "Attached to shared-memory ring " << m_name << " of " << m_capacity << " bytes";
+  return true;
+}
+
+void
+ShmRing::claim()
+{
+  // The ring has a single producer: a second sender would race on write_pos and corrupt records
+  uint64_t holder = 0;
+  while (!m_header->sender_id.compare_exchange_strong(holder, m_sender_id)) {
+    if (sender_live(holder)) {
+      detach();
+      throw ShmOperationError(ERS_HERE,
+                              "attach",
+                              m_name,
+                              "already written to by the sender in process " + std::to_string(holder >> 32));
+    }
+    // Left behind by a sender which has gone away; holder now has its ID, so try again to replace it
+  }
+}
+
+void
+ShmRing::detach()
+{
+  if (!m_owner) {
+    // Only releases the segment if this sender holds it
+    auto holder = m_sender_id;
+    m_header->sender_id.compare_exchange_strong(holder, 0);
+  }
+  munmap(m_header, m_mapped_size);
+  m_header = nullptr;
+  m_data = nullptr;
+  m_capacity = 0;
+  m_mapped_size = 0;
+}
+
+size_t
+ShmRing::record_size(size_t metadata_size, size_t N)
+{
+  auto size = sizeof(RecordHeader) + metadata_size + N;
+  return (size + s_record_alignment - 1) & ~(s_record_alignment - 1);
+}
+
+void
+ShmRing::copy_in(uint64_t pos, const void* src, size_t n)
+{
+  auto offset = pos & (m_capacity - 1);
+  auto first = std::min(n, m_capacity - offset);
+  memcpy(m_data + offset, src, first);
+  if (first < n) {
+    memcpy(m_data, static_cast<const char*>(src) + first, n - first);
+  }
+}
+
+void
+ShmRing::copy_out(uint64_t pos, void* dst, size_t n) const
+{
+  auto offset = pos & (m_capacity - 1);
+  auto first = std::min(n, m_capacity - offset);
+  memcpy(dst, m_data + offset, first);
+  if (first < n) {
+    memcpy(static_cast<char*>(dst) + first, m_data, n - first);
+  }
+}
+
+bool
+ShmRing::write(std::string_view metadata,
+               const Sender::Segment* segments,
+               size_t segment_count,
+               size_t N,
+               const duration_t& timeout,
+               std::chrono::steady_clock::duration& wait_time)
+{
+  auto size = record_size(metadata.size(), N);
+  auto start_time = std::chrono::steady_clock::now();
+  auto remaining = [&] {
+    if (timeout == duration_t::max()) {
+      return timeout;
+    }
+    auto elapsed = std::chrono::duration_cast<duration_t>(std::chrono::steady_clock::now() - start_time);
+    return elapsed < timeout ? timeout - elapsed : duration_t::zero();
+  };
+
+  while (true) {
+    // Follow the receiver to a new segment if it has gone away or been replaced, and wait for one if there is none
+    if (m_header != nullptr && m_header->closed.load() != 0) {
+      TLOG_DEBUG(10) << "Shared-memory ring " << m_name << " was closed by its receiver, reattaching";
+      detach();
+    }
+    if (m_header == nullptr && !attach()) {
+      if (remaining() == duration_t::zero()) {
+        return false;
+      }
+      auto wait_start = std::chrono::steady_clock::now();
+      usleep(s_attach_poll_us);
+      wait_time += std::chrono::steady_clock::now() - wait_start;
+      continue;
+    }
+
+    if (size > m_capacity) {
+      throw ShmMessageTooLarge(ERS_HERE, N, m_name, m_capacity);
+    }
+
+    // Only this side moves write_pos
+    auto write_pos = m_header->write_pos.load(std::memory_order_relaxed);
+    auto has_room = [&] {
+      return m_capacity - (write_pos - m_header->read_pos.load(std::memory_order_acquire)) >= size ||
+             m_header->closed.load() != 0;
+    };
+
+    bool timed_out = false;
+    while (!spin_until(has_room)) {
+      auto wait_timeout = remaining();
+      if (wait_timeout == duration_t::zero()) {
+        timed_out = true;
+        break;
+      }
+
+      // Announce that we are about to sleep, then re-check, so that a read in between is not missed
+      m_header->sender_waiting.store(1);
+      auto seq = m_header->space_seq.load();
+      if (!has_room()) {
+        auto wait_start = std::chrono::steady_clock::now();
+        futex_wait(&m_header->space_seq, seq, wait_timeout);
+        wait_time += std::chrono::steady_clock::now() - wait_start;
+      }
+      m_header->sender_waiting.store(0);
+    }
+    if (timed_out) {
+      return false;
+    }
+    if (m_header->closed.load() != 0) {
+      continue;
+    }
+
+    RecordHeader record{ N, static_cast<uint32_t>(metadata.size()), 0 };
+    auto pos = write_pos;
+    copy_in(pos, &record, sizeof(record));
+    pos += sizeof(record);
+    copy_in(pos, metadata.data(), metadata.size());
+    pos += metadata.size();
+    for (size_t ii = 0; ii < segment_count; ++ii) {
+      copy_in(pos, segments[ii].data, segments[ii].size);
+      pos += segments[ii].size;
+    }
+
+    m_header->write_pos.store(write_pos + size, std::memory_order_release);
+    m_header->data_seq.fetch_add(1);
+    if (m_header->receiver_waiting.load()) {
+      futex_wake(&m_header->data_seq);
+    }
+    return true;
+  }
+}
+
+bool
+ShmRing::readable() const
+{
+  return m_header->write_pos.load(std::memory_order_acquire) != m_header->read_pos.load(std::memory_order_relaxed);
+}
+
+bool
+ShmRing::wait_readable(const duration_t& timeout)
+{
+  auto start_time = std::chrono::steady_clock::now();
+  while (!spin_until([this] { return readable(); })) {
+    auto elapsed = std::chrono::duration_cast<duration_t>(std::chrono::steady_clock::now() - start_time);
+    if (elapsed >= timeout) {
+      return false;
+    }
+
+    m_header->receiver_waiting.store(1);
+    auto seq = m_header->data_seq.load();
+    if (!readable()) {
+      futex_wait(&m_header->data_seq, seq, timeout == duration_t::max() ? timeout : timeout - elapsed);
+    }
+    m_header->receiver_waiting.store(0);
+  }
+  return true;
+}
+
+size_t
+ShmRing::next_data_size() const
+{
+  RecordHeader record;
+  copy_out(m_header->read_pos.load(std::memory_order_relaxed), &record, sizeof(record));
+  return record.data_size;
+}
+
+bool
+ShmRing::read(Receiver::Response& response, const duration_t& timeout)
+{
+  if (!wait_readable(timeout)) {
+    return false;
+  }
+
+  // Only this side moves read_pos
+  auto read_pos = m_header->read_pos.load(std::memory_order_relaxed);
+  RecordHeader record;
+  copy_out(read_pos, &record, sizeof(record));
+  response.metadata.resize(record.metadata_size);
+  copy_out(read_pos + sizeof(record), response.metadata.data(), record.metadata_size);
+  response.data.resize(record.data_size);
+  copy_out(read_pos + sizeof(record) + record.metadata_size, response.data.data(), record.data_size);
+
+  m_header->read_pos.store(read_pos + record_size(record.metadata_size, record.data_size), std::memory_order_release);
+  m_header->space_seq.fetch_add(1);
+  if (m_header->sender_waiting.load()) {
+    futex_wake(&m_header->space_seq);
+  }
+  return true;
+}
+
+} // namespace dunedaq::ipm
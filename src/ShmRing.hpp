@@ -0,0 +1,165 @@
+/**
+ *
+ * @file ShmRing.hpp IPM ShmRing class
+ *
+ * Single-producer/single-consumer ring buffer of messages in a POSIX shared-memory segment (/dev/shm), shared by
+ * ShmSender and ShmReceiver. Each side waits on a futex in the segment when the ring is full or empty, so a
+ * message costs two memcpys and, only when the other side is asleep, one wake-up syscall.
+ *
+ * The receiver owns the segment: it creates it when it connects, replacing any segment left behind under the same
+ * name by a receiver which has gone away, and removes it when it is destroyed. The sender only attaches, once the
+ * segment exists, and moves on to the new segment when it finds its one closed by a departing or replacing receiver.
+ * Only one sender may write to a segment: it claims the segment when it attaches, and a second sender's attach fails
+ * while the first is still running.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef IPM_SRC_SHMRING_HPP_
+#define IPM_SRC_SHMRING_HPP_
+
+#include "ipm/Receiver.hpp"
+#include "ipm/Sender.hpp"
+
+#include "ers/Issue.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace dunedaq {
+
+/**
+ * @brief An ERS Error indicating that setting up a shared-memory ring failed
+ * @param operation The operation that failed
+ * @param name The name of the shared-memory segment
+ * @param what Description of the failure
+ * @cond Doxygen doesn't like ERS macros LCOV_EXCL_START
+ */
+ERS_DECLARE_ISSUE(ipm,
+                  ShmOperationError,
+                  "Error during " << operation << " of shared-memory segment " << name << ": " << what,
+                  ((std::string)operation)((std::string)name)((std::string)what)) // NOLINT
+                                                                                  /// @endcond LCOV_EXCL_STOP
+
+/**
+ * @brief An ERS Error indicating that a message can never fit in a shared-memory ring
+ * @param N number of bytes in attempted send
+ * @param name The name of the shared-memory segment
+ * @param capacity The capacity of the ring, in bytes
+ * @cond Doxygen doesn't like ERS macros LCOV_EXCL_START
+ */
+ERS_DECLARE_ISSUE(ipm,
+                  ShmMessageTooLarge,
+                  "A message of " << N << " bytes does not fit in shared-memory ring " << name << " of " << capacity
+                                  << " bytes",
+                  ((size_t)N)((std::string)name)((size_t)capacity)) // NOLINT
+                                                                    /// @endcond LCOV_EXCL_STOP
+
+namespace ipm {
+
+class ShmRing
+{
+public:
+  using duration_t = std::chrono::milliseconds;
+  static constexpr size_t s_default_capacity = 16 * 1024 * 1024;
+
+  // Extracts the segment name from a shm://name connection string
+  static std::string name_from_uri(std::string const& connection_string);
+
+  // With owner set (the receiver), creates the named segment with (at least) the given capacity, replacing a stale
+  // one; throws if the segment belongs to a receiver which is still running. Otherwise (the sender), attaches to the
+  // segment if it exists yet, and the capacity is not used; write() attaches later if it does not. Attaching throws
+  // if another sender which is still running has claimed the segment.
+  ShmRing(std::string const& name, size_t capacity, bool owner);
+  ~ShmRing();
+
+  ShmRing(const ShmRing&) = delete;
+  ShmRing& operator=(const ShmRing&) = delete;
+  ShmRing(ShmRing&&) = delete;
+  ShmRing& operator=(ShmRing&&) = delete;
+
+  std::string const& name() const noexcept { return m_name; }
+  size_t capacity() const noexcept { return m_capacity; }
+
+  // Producer side: append a message made of the concatenated segments, waiting up to timeout for room, and for the
+  // receiver's segment if it has not created it yet or has been replaced. Messages left in a closed segment are lost.
+  // Returns false if the timeout expired; time spent asleep is added to wait_time.
+  bool write(std::string_view metadata,
+             const Sender::Segment* segments,
+             size_t segment_count,
+             size_t N,
+             const duration_t& timeout,
+             std::chrono::steady_clock::duration& wait_time);
+
+  // Consumer side: take the oldest message, waiting up to timeout for one. Returns false if the timeout expired.
+  bool read(Receiver::Response& response, const duration_t& timeout);
+
+  // Consumer side: wait up to timeout for a message to be available
+  bool wait_readable(const duration_t& timeout);
+
+  // Consumer side: data size of the oldest message; only valid once wait_readable has returned true
+  size_t next_data_size() const;
+
+private:
+  struct Header
+  {
+    std::atomic<uint64_t> magic;
+    uint64_t capacity;
+    std::atomic<int32_t> receiver_pid; // Process of the receiver which created the segment
+    std::atomic<uint32_t> closed;      // Set once that receiver is gone, or replaced
+    std::atomic<uint64_t> sender_id;   // The sender writing to the segment (see m_sender_id), or 0 if none
+    alignas(64) std::atomic<uint64_t> write_pos;
+    std::atomic<uint32_t> data_seq; // Futex word, bumped after every write
+    std::atomic<uint32_t> receiver_waiting;
+    alignas(64) std::atomic<uint64_t> read_pos;
+    std::atomic<uint32_t> space_seq; // Futex word, bumped after every read
+    std::atomic<uint32_t> sender_waiting;
+  };
+
+  struct RecordHeader
+  {
+    uint64_t data_size;
+    uint32_t metadata_size;
+    uint32_t reserved;
+  };
+
+  static constexpr uint64_t s_magic = 0x33524d4853504d49; // "IPMSHMR3"
+  static constexpr size_t s_record_alignment = 8;
+
+  static size_t record_size(size_t metadata_size, size_t N);
+  static void close_segment(Header* header);
+  // Whether the receiver which created the segment is still using it
+  static bool live(const Header* header);
+  // Whether the sender which claimed a segment is still running
+  static bool sender_live(uint64_t sender_id);
+  static bool process_live(int32_t pid);
+  std::string shm_name() const { return "/ipm_" + m_name; }
+  void create(size_t capacity);
+  void remove_stale();
+  bool attach();
+  void claim();
+  void detach();
+  void copy_in(uint64_t pos, const void* src, size_t n);
+  void copy_out(uint64_t pos, void* dst, size_t n) const;
+  bool readable() const;
+
+  std::string m_name;
+  bool m_owner;
+  // For a sender, its process in the upper 32 bits and a number unique within the process in the lower ones, so that
+  // two senders in the same process are told apart
+  uint64_t m_sender_id{ 0 };
+  size_t m_capacity{ 0 };
+  size_t m_mapped_size{ 0 };
+  Header* m_header{ nullptr };
+  char* m_data{ nullptr };
+};
+
+} // namespace ipm
+} // namespace dunedaq
+
+#endif // IPM_SRC_SHMRING_HPP_
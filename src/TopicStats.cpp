@@ -0,0 +1,81 @@
+/**
+ *
+ * @file TopicStats.cpp ipm TopicStats class
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "TopicStats.hpp"
+
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace dunedaq::ipm {
+
+void
+TopicStats::add(std::string_view topic, size_t bytes)
+{
+  Counters* counters = nullptr;
+  {
+    std::shared_lock<std::shared_mutex> lk(m_mutex);
+    auto it = m_topics.find(topic);
+    if (it != m_topics.end()) {
+      counters = &it->second;
+    } else if (m_overflow != nullptr) {
+      counters = m_overflow;
+    }
+  }
+
+  if (counters == nullptr) {
+    std::unique_lock<std::shared_mutex> lk(m_mutex);
+    auto it = m_topics.find(topic);
+    if (it == m_topics.end()) {
+      if (m_topics.size() < m_max_topics) {
+        it = m_topics.try_emplace(std::string(topic)).first;
+      } else {
+        // From now on every topic not already tracked goes here
+        it = m_topics.try_emplace(std::string(s_overflow_topic)).first;
+        m_overflow = &it->second;
+      }
+    }
+    counters = &it->second;
+  }
+
+  // Map nodes are never removed, so the counters stay valid without the lock
+  counters->bytes.fetch_add(bytes, std::memory_order_relaxed);
+  counters->messages.fetch_add(1, std::memory_order_relaxed);
+}
+
+std::vector<std::pair<std::string, opmon::TopicInfo>>
+TopicStats::take()
+{
+  auto now = std::chrono::steady_clock::now();
+  double seconds = std::chrono::duration<double>(now - m_last_take).count();
+  m_last_take = now;
+
+  std::vector<std::pair<std::string, opmon::TopicInfo>> result;
+  std::shared_lock<std::shared_mutex> lk(m_mutex);
+  for (auto& [topic, counters] : m_topics) {
+    auto messages = counters.messages.exchange(0, std::memory_order_relaxed);
+    auto bytes = counters.bytes.exchange(0, std::memory_order_relaxed);
+    if (messages == 0) {
+      continue;
+    }
+
+    opmon::TopicInfo info;
+    info.set_bytes(bytes);
+    info.set_messages(messages);
+    if (seconds > 0) {
+      info.set_messages_per_second(messages / seconds);
+      info.set_bytes_per_second(bytes / seconds);
+    }
+    result.emplace_back(topic, std::move(info));
+  }
+  return result;
+}
+
+} // namespace dunedaq::ipm
@@ -0,0 +1,69 @@
+/**
+ *
+ * @file TopicStats.hpp IPM TopicStats class
+ *
+ * Per-topic message and byte counters for the publish/subscribe plugins. The number of topics tracked is bounded;
+ * once the limit is reached, traffic on further topics is counted under s_overflow_topic. Counting a message on a
+ * known topic takes a shared lock and two relaxed atomic increments.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef IPM_SRC_TOPICSTATS_HPP_
+#define IPM_SRC_TOPICSTATS_HPP_
+
+#include "ipm/opmon/ipm.pb.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace dunedaq {
+namespace ipm {
+
+class TopicStats
+{
+public:
+  static constexpr size_t s_default_max_topics = 64;
+  static constexpr std::string_view s_overflow_topic = "<overflow>";
+
+  explicit TopicStats(size_t max_topics = s_default_max_topics)
+    : m_max_topics(max_topics)
+  {}
+
+  void set_max_topics(size_t max_topics) { m_max_topics = max_topics; }
+
+  void add(std::string_view topic, size_t bytes);
+
+  // One TopicInfo, with its rates over the time since the previous call, for every topic which carried messages
+  // since then. Resets the counters; only one thread may call this.
+  std::vector<std::pair<std::string, opmon::TopicInfo>> take();
+
+private:
+  struct Counters
+  {
+    std::atomic<uint64_t> bytes{ 0 };
+    std::atomic<uint64_t> messages{ 0 };
+  };
+
+  size_t m_max_topics;
+  std::shared_mutex m_mutex; // Only taken exclusively to add a topic
+  std::map<std::string, Counters, std::less<>> m_topics;
+  Counters* m_overflow{ nullptr }; // Set once the limit has been reached
+  std::chrono::steady_clock::time_point m_last_take{ std::chrono::steady_clock::now() };
+};
+
+} // namespace ipm
+} // namespace dunedaq
+
+#endif // IPM_SRC_TOPICSTATS_HPP_
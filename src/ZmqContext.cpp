@@ -0,0 +1,279 @@
+/**
+ *
+ * @file ZmqContext.cpp ipm ZmqContext class
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "ipm/ZmqContext.hpp"
+
+#include <pthread.h>
+#include <sched.h>
+
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace dunedaq::ipm {
+
+namespace {
+
+const std::map<std::string, int> s_sched_policies{
+  { "SCHED_OTHER", SCHED_OTHER }, { "SCHED_BATCH", SCHED_BATCH }, { "SCHED_IDLE", SCHED_IDLE },
+  { "SCHED_FIFO", SCHED_FIFO },   { "SCHED_RR", SCHED_RR },
+};
+
+bool
+is_real_time(int policy)
+{
+  return policy == SCHED_FIFO || policy == SCHED_RR;
+}
+
+// Parse a CPU list such as "0,2,4-7"; throws std::invalid_argument
+std::vector<int>
+parse_cpu_list(std::string const& list)
+{
+  std::vector<int> cpus;
+  std::stringstream ss(list);
+  std::string item;
+  auto parse_cpu = [&](std::string const& text) {
+    if (text.empty() || text.find_first_not_of("0123456789") != std::string::npos) {
+      throw std::invalid_argument("Invalid CPU list " + list);
+    }
+    return std::stoi(text);
+  };
+  while (std::getline(ss, item, ',')) {
+    auto dash = item.find('-');
+    auto first = parse_cpu(item.substr(0, dash));
+    auto last = dash == std::string::npos ? first : parse_cpu(item.substr(dash + 1));
+    if (last < first) {
+      throw std::invalid_argument("Descending CPU range " + item);
+    }
+    for (auto cpu = first; cpu <= last; ++cpu) {
+      cpus.push_back(cpu);
+    }
+  }
+  return cpus;
+}
+
+// The CPUs of NUMA node node which this process may use
+std::vector<int>
+numa_node_cpus(int node)
+{
+  std::ifstream cpulist_file("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+  std::string cpulist;
+  if (!std::getline(cpulist_file, cpulist)) {
+    throw std::runtime_error("NUMA node " + std::to_string(node) + " not found");
+  }
+
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  sched_getaffinity(0, sizeof(allowed), &allowed);
+  std::vector<int> cpus;
+  for (auto cpu : parse_cpu_list(cpulist)) {
+    if (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed)) {
+      cpus.push_back(cpu);
+    }
+  }
+  if (cpus.empty()) {
+    throw std::runtime_error("None of the CPUs of NUMA node " + std::to_string(node) + " is available");
+  }
+  return cpus;
+}
+
+} // namespace ""
+
+ZmqContext&
+ZmqContext::instance()
+{
+  static ZmqContext s_ctx;
+  return s_ctx;
+}
+
+ZmqContext&
+ZmqContext::instance(std::string const& name)
+{
+  if (name.empty()) {
+    return instance();
+  }
+
+  static std::mutex s_mutex;
+  static std::map<std::string, std::unique_ptr<ZmqContext>> s_contexts;
+  std::lock_guard<std::mutex> lk(s_mutex);
+  auto& context = s_contexts[name];
+  if (!context) {
+    TLOG_DEBUG(10) << "Creating ZMQ Context " << name;
+    context.reset(new ZmqContext(name));
+  }
+  return *context;
+}
+
+const char*
+ZmqContext::getenv_(std::string const& variable) const
+{
+  if (m_name.empty()) {
+    return getenv(variable.c_str());
+  }
+  auto suffixed = variable + "_";
+  for (auto ch : m_name) {
+    suffixed += std::isalnum(static_cast<unsigned char>(ch)) ? std::toupper(static_cast<unsigned char>(ch)) : '_';
+  }
+  return getenv(suffixed.c_str());
+}
+
+void
+ZmqContext::warn_if_started_(std::string const& setting) const
+{
+  if (m_context_used) {
+    ers::warning(ZmqContextSettingError(
+      ERS_HERE, setting, "ZMQ sockets have already been created, so IO threads which are running are not affected"));
+  }
+}
+
+void
+ZmqContext::set_io_thread_affinity(std::vector<int> const& cpus)
+{
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+    throw ZmqContextSettingError(ERS_HERE, "IO thread affinity", "Unable to read the process CPU affinity");
+  }
+  for (auto cpu : cpus) {
+    // ZMQ aborts if it cannot set the affinity of an IO thread
+    if (cpu < 0 || cpu >= CPU_SETSIZE || !CPU_ISSET(cpu, &allowed)) {
+      throw ZmqContextSettingError(
+        ERS_HERE, "IO thread affinity", "CPU " + std::to_string(cpu) + " is not available to this process");
+    }
+  }
+  warn_if_started_("IO thread affinity");
+
+  for (auto cpu : m_io_thread_cpus) {
+    m_context.set(zmq::ctxopt::thread_affinity_cpu_remove, cpu);
+  }
+  m_io_thread_cpus.clear();
+  for (auto cpu : cpus) {
+    TLOG_DEBUG(10) << "Adding CPU " << cpu << " to the ZMQ Context IO thread affinity";
+    m_context.set(zmq::ctxopt::thread_affinity_cpu_add, cpu);
+    m_io_thread_cpus.insert(cpu);
+  }
+}
+
+void
+ZmqContext::set_io_thread_scheduling(int policy, int priority)
+{
+  bool known_policy = false;
+  for (auto& [name, value] : s_sched_policies) {
+    known_policy = known_policy || value == policy;
+  }
+  if (!known_policy) {
+    throw ZmqContextSettingError(ERS_HERE, "IO thread scheduling", "Unknown policy " + std::to_string(policy));
+  }
+  if (!is_real_time(policy) && priority != 0) {
+    // ZMQ would try to raise the thread's nice value instead, which needs privileges it usually lacks
+    throw ZmqContextSettingError(
+      ERS_HERE, "IO thread scheduling", "Only SCHED_FIFO and SCHED_RR take a priority other than 0");
+  }
+  if (priority < sched_get_priority_min(policy) || priority > sched_get_priority_max(policy)) {
+    throw ZmqContextSettingError(ERS_HERE,
+                                 "IO thread scheduling",
+                                 "Priority " + std::to_string(priority) + " is out of range for the policy");
+  }
+
+  // ZMQ aborts if it cannot apply the policy to an IO thread, so try it on a thread of our own first
+  int rc = 0;
+  std::thread probe([&]() {
+    sched_param param{};
+    param.sched_priority = priority;
+    rc = pthread_setschedparam(pthread_self(), policy, &param);
+  });
+  probe.join();
+  if (rc != 0) {
+    throw ZmqContextSettingError(ERS_HERE, "IO thread scheduling", std::string("Not permitted: ") + strerror(rc));
+  }
+  warn_if_started_("IO thread scheduling");
+
+  TLOG_DEBUG(10) << "Setting ZMQ Context IO thread scheduling policy to " << policy << " with priority " << priority;
+  m_context.set(zmq::ctxopt::thread_sched_policy, policy);
+  if (is_real_time(policy)) {
+    m_context.set(zmq::ctxopt::thread_priority, priority);
+  }
+}
+
+void
+ZmqContext::set_io_thread_name_prefix(int prefix)
+{
+  if (prefix < 0) {
+    throw ZmqContextSettingError(ERS_HERE, "IO thread name prefix", "The prefix must not be negative");
+  }
+  warn_if_started_("IO thread name prefix");
+
+  TLOG_DEBUG(10) << "Setting ZMQ Context IO thread name prefix to " << prefix;
+  m_context.set(zmq::ctxopt::thread_name_prefix, prefix);
+}
+
+void
+ZmqContext::configure_io_threads_from_environment_()
+{
+  auto affinity_c = getenv_("IPM_ZMQ_IO_THREAD_AFFINITY");
+  if (affinity_c != nullptr) {
+    try {
+      set_io_thread_affinity(parse_cpu_list(affinity_c));
+    } catch (ZmqContextSettingError const& err) {
+      ers::warning(err);
+    } catch (std::exception const& err) {
+      ers::warning(ZmqContextSettingError(ERS_HERE, "IPM_ZMQ_IO_THREAD_AFFINITY", err.what()));
+    }
+  } else if (m_name.rfind("numa", 0) == 0 && m_name.size() > 4 &&
+             m_name.find_first_not_of("0123456789", 4) == std::string::npos) {
+    try {
+      set_io_thread_affinity(numa_node_cpus(std::stoi(m_name.substr(4))));
+    } catch (std::exception const& err) {
+      ers::warning(ZmqContextSettingError(ERS_HERE, "NUMA affinity of ZMQ context " + m_name, err.what()));
+    }
+  }
+
+  auto policy_c = getenv_("IPM_ZMQ_IO_THREAD_SCHED_POLICY");
+  auto priority_c = getenv_("IPM_ZMQ_IO_THREAD_PRIORITY");
+  if (policy_c != nullptr || priority_c != nullptr) {
+    std::string policy_name = policy_c != nullptr ? policy_c : "SCHED_FIFO";
+    if (policy_name.rfind("SCHED_", 0) != 0) {
+      policy_name = "SCHED_" + policy_name;
+    }
+    auto policy = s_sched_policies.find(policy_name);
+    if (policy == s_sched_policies.end()) {
+      ers::warning(
+        ZmqContextSettingError(ERS_HERE, "IPM_ZMQ_IO_THREAD_SCHED_POLICY", "Unknown policy " + policy_name));
+    } else {
+      try {
+        set_io_thread_scheduling(policy->second, priority_c != nullptr ? std::stoi(priority_c) : 0);
+      } catch (ZmqContextSettingError const& err) {
+        ers::warning(err);
+      } catch (std::exception const& err) {
+        ers::warning(ZmqContextSettingError(ERS_HERE, "IPM_ZMQ_IO_THREAD_PRIORITY", err.what()));
+      }
+    }
+  }
+
+  auto prefix_c = getenv_("IPM_ZMQ_IO_THREAD_NAME_PREFIX");
+  if (prefix_c != nullptr) {
+    try {
+      set_io_thread_name_prefix(std::stoi(prefix_c));
+    } catch (ZmqContextSettingError const& err) {
+      ers::warning(err);
+    } catch (std::exception const& err) {
+      ers::warning(ZmqContextSettingError(ERS_HERE, "IPM_ZMQ_IO_THREAD_NAME_PREFIX", err.what()));
+    }
+  }
+}
+
+} // namespace dunedaq::ipm
@@ -0,0 +1,170 @@
+/**
+ *
+ * @file ZmqSocketOptions.cpp ipm ZmqSocketOptions class
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "ZmqSocketOptions.hpp"
+
+#include <limits>
+#include <string>
+
+namespace dunedaq::ipm {
+
+namespace {
+
+constexpr int64_t s_int_max = std::numeric_limits<int>::max();
+constexpr int64_t s_int64_max = std::numeric_limits<int64_t>::max();
+
+struct OptionSpec
+{
+  const char* name;
+  std::optional<int64_t> ZmqSocketOptions::*member;
+  int64_t min;
+  int64_t max;
+};
+
+// -1 selects the OS or ZMQ default where ZMQ allows it
+const OptionSpec s_options[] = {
+  { "sndhwm", &ZmqSocketOptions::sndhwm, 0, s_int_max },
+  { "rcvhwm", &ZmqSocketOptions::rcvhwm, 0, s_int_max },
+  { "sndbuf", &ZmqSocketOptions::sndbuf, -1, s_int_max },
+  { "rcvbuf", &ZmqSocketOptions::rcvbuf, -1, s_int_max },
+  { "maxmsgsize", &ZmqSocketOptions::maxmsgsize, -1, s_int64_max },
+  { "tcp_keepalive", &ZmqSocketOptions::tcp_keepalive, -1, 1 },
+  { "tcp_keepalive_idle", &ZmqSocketOptions::tcp_keepalive_idle, -1, s_int_max },
+  { "tcp_keepalive_cnt", &ZmqSocketOptions::tcp_keepalive_cnt, -1, s_int_max },
+  { "tcp_keepalive_intvl", &ZmqSocketOptions::tcp_keepalive_intvl, -1, s_int_max },
+};
+
+} // namespace ""
+
+ZmqSocketOptions
+ZmqSocketOptions::from_preset(std::string const& preset)
+{
+  ZmqSocketOptions options;
+  options.preset = preset;
+  if (preset == "bulk") {
+    // Large messages at high rate: deep queues and kernel buffers, and keepalives so that dead peers on long-lived
+    // readout links are noticed
+    options.sndhwm = 10000;
+    options.rcvhwm = 10000;
+    options.sndbuf = 16 * 1024 * 1024;
+    options.rcvbuf = 16 * 1024 * 1024;
+    options.tcp_keepalive = 1;
+    options.tcp_keepalive_idle = 60;
+    options.tcp_keepalive_cnt = 5;
+    options.tcp_keepalive_intvl = 10;
+  } else if (preset == "low-latency") {
+    // Short queues, so that back-pressure is felt by the sender instead of turning into queueing delay
+    options.sndhwm = 100;
+    options.rcvhwm = 100;
+  } else if (preset != "default") {
+    throw InvalidSocketOption(ERS_HERE, "preset " + preset, "Known presets are default, bulk and low-latency");
+  }
+  return options;
+}
+
+ZmqSocketOptions
+ZmqSocketOptions::from_connection_info(const nlohmann::json& connection_info)
+{
+  if (!connection_info.contains("socket_options")) {
+    return ZmqSocketOptions();
+  }
+  auto& json = connection_info["socket_options"];
+  if (!json.is_object()) {
+    throw InvalidSocketOption(ERS_HERE, "socket_options", "Expected an object");
+  }
+
+  std::string preset = "default";
+  if (json.contains("preset")) {
+    if (!json["preset"].is_string()) {
+      throw InvalidSocketOption(ERS_HERE, "preset", "Expected a string");
+    }
+    preset = json["preset"].get<std::string>();
+  }
+  auto options = from_preset(preset);
+
+  for (auto& [key, value] : json.items()) {
+    if (key == "preset") {
+      continue;
+    }
+    const OptionSpec* spec = nullptr;
+    for (auto& candidate : s_options) {
+      if (key == candidate.name) {
+        spec = &candidate;
+        break;
+      }
+    }
+    if (spec == nullptr) {
+      throw InvalidSocketOption(ERS_HERE, key, "Unknown option");
+    }
+    if (!value.is_number_integer()) {
+      throw InvalidSocketOption(ERS_HERE, key, "Expected an integer");
+    }
+    bool too_large = value.is_number_unsigned() && value.get<uint64_t>() > static_cast<uint64_t>(s_int64_max);
+    auto number = too_large ? s_int64_max : value.get<int64_t>();
+    if (too_large || number < spec->min || number > spec->max) {
+      throw InvalidSocketOption(ERS_HERE,
+                                key,
+                                "Value " + value.dump() + " is outside the range " + std::to_string(spec->min) +
+                                  " to " + std::to_string(spec->max));
+    }
+    options.*(spec->member) = number;
+  }
+  return options;
+}
+
+void
+ZmqSocketOptions::apply(zmq::socket_t& socket) const
+{
+  if (sndhwm) {
+    socket.set(zmq::sockopt::sndhwm, static_cast<int>(*sndhwm));
+  }
+  if (rcvhwm) {
+    socket.set(zmq::sockopt::rcvhwm, static_cast<int>(*rcvhwm));
+  }
+  if (sndbuf) {
+    socket.set(zmq::sockopt::sndbuf, static_cast<int>(*sndbuf));
+  }
+  if (rcvbuf) {
+    socket.set(zmq::sockopt::rcvbuf, static_cast<int>(*rcvbuf));
+  }
+  if (maxmsgsize) {
+    socket.set(zmq::sockopt::maxmsgsize, *maxmsgsize);
+  }
+  if (tcp_keepalive) {
+    socket.set(zmq::sockopt::tcp_keepalive, static_cast<int>(*tcp_keepalive));
+  }
+  if (tcp_keepalive_idle) {
+    socket.set(zmq::sockopt::tcp_keepalive_idle, static_cast<int>(*tcp_keepalive_idle));
+  }
+  if (tcp_keepalive_cnt) {
+    socket.set(zmq::sockopt::tcp_keepalive_cnt, static_cast<int>(*tcp_keepalive_cnt));
+  }
+  if (tcp_keepalive_intvl) {
+    socket.set(zmq::sockopt::tcp_keepalive_intvl, static_cast<int>(*tcp_keepalive_intvl));
+  }
+}
+
+opmon::SocketOptionsInfo
+ZmqSocketOptions::effective(zmq::socket_t& socket) const
+{
+  opmon::SocketOptionsInfo info;
+  info.set_preset(preset);
+  info.set_sndhwm(socket.get(zmq::sockopt::sndhwm));
+  info.set_rcvhwm(socket.get(zmq::sockopt::rcvhwm));
+  info.set_sndbuf(socket.get(zmq::sockopt::sndbuf));
+  info.set_rcvbuf(socket.get(zmq::sockopt::rcvbuf));
+  info.set_maxmsgsize(socket.get(zmq::sockopt::maxmsgsize));
+  info.set_tcp_keepalive(socket.get(zmq::sockopt::tcp_keepalive));
+  info.set_tcp_keepalive_idle(socket.get(zmq::sockopt::tcp_keepalive_idle));
+  info.set_tcp_keepalive_cnt(socket.get(zmq::sockopt::tcp_keepalive_cnt));
+  info.set_tcp_keepalive_intvl(socket.get(zmq::sockopt::tcp_keepalive_intvl));
+  return info;
+}
+
+} // namespace dunedaq::ipm
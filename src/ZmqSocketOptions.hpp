@@ -0,0 +1,75 @@
+/**
+ *
+ * @file ZmqSocketOptions.hpp IPM ZmqSocketOptions class
+ *
+ * Performance-related ZMQ socket options, read from the "socket_options" object of a connection_info and applied to
+ * a socket before it binds or connects. The object may name a preset ("default", "bulk" or "low-latency"), whose
+ * values are overridden by any options given alongside it. The accepted options are described by
+ * schema/ipm/socketoptions.jsonnet.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef IPM_SRC_ZMQSOCKETOPTIONS_HPP_
+#define IPM_SRC_ZMQSOCKETOPTIONS_HPP_
+
+#include "ipm/opmon/ipm.pb.h"
+
+#include "ers/Issue.hpp"
+#include "nlohmann/json.hpp"
+#include "zmq.hpp"
+
+#include <cstdint>
+#include <optional>
+#include <string>
+
+namespace dunedaq {
+
+/**
+ * @brief An ERS Error indicating that the socket_options in a connection_info could not be used
+ * @param option The offending option (or preset)
+ * @param reason Why it was rejected
+ * @cond Doxygen doesn't like ERS macros LCOV_EXCL_START
+ */
+ERS_DECLARE_ISSUE(ipm,
+                  InvalidSocketOption,
+                  "Invalid socket option " << option << ": " << reason,
+                  ((std::string)option)((std::string)reason)) // NOLINT
+/// @endcond LCOV_EXCL_STOP
+
+namespace ipm {
+
+class ZmqSocketOptions
+{
+public:
+  // Options left unset keep the ZMQ defaults
+  std::string preset{ "default" };
+  std::optional<int64_t> sndhwm;
+  std::optional<int64_t> rcvhwm;
+  std::optional<int64_t> sndbuf;
+  std::optional<int64_t> rcvbuf;
+  std::optional<int64_t> maxmsgsize;
+  std::optional<int64_t> tcp_keepalive;
+  std::optional<int64_t> tcp_keepalive_idle;
+  std::optional<int64_t> tcp_keepalive_cnt;
+  std::optional<int64_t> tcp_keepalive_intvl;
+
+  // Parse connection_info["socket_options"], which may be absent. Throws InvalidSocketOption on unknown presets or
+  // options, and on values of the wrong type or out of range.
+  static ZmqSocketOptions from_connection_info(const nlohmann::json& connection_info);
+
+  static ZmqSocketOptions from_preset(std::string const& preset);
+
+  // Set the options which have a value; throws zmq::error_t
+  void apply(zmq::socket_t& socket) const;
+
+  // The values in force on socket, for opmon
+  opmon::SocketOptionsInfo effective(zmq::socket_t& socket) const;
+};
+
+} // namespace ipm
+} // namespace dunedaq
+
+#endif // IPM_SRC_ZMQSOCKETOPTIONS_HPP_
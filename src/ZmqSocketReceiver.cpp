@@ -0,0 +1,188 @@
+/**
+ *
+ * @file ZmqSocketReceiver.cpp ipm ZmqSocketReceiver class
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "ZmqSocketReceiver.hpp"
+#include "ipm/ZmqContext.hpp"
+
+#include "logging/Logging.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace dunedaq::ipm {
+
+ZmqSocketReceiver::ZmqSocketReceiver(zmq::socket_t& socket, std::string const& endpoint, received_hook_t received_hook)
+  : m_socket(socket)
+  , m_endpoint(endpoint)
+  , m_received_hook(std::move(received_hook))
+{
+}
+
+bool
+ZmqSocketReceiver::receive(zmq::message_t& hdr, zmq::message_t& msg, const duration_t& timeout, bool no_tmoexcept_mode)
+{
+  zmq::recv_result_t res{};
+  zmq::pollitem_t poll_item{ m_socket.handle(), 0, ZMQ_POLLIN, 0 };
+
+  auto start_time = std::chrono::steady_clock::now();
+  do {
+
+    try {
+      TLOG_DEBUG(20) << "Endpoint " << m_endpoint << ": Going to receive header";
+      res = m_socket.recv(hdr);
+      TLOG_DEBUG(25) << "Endpoint " << m_endpoint << ": Recv res=" << res.value_or(0)
+                     << " for header (hdr.size() == " << hdr.size() << ")";
+    } catch (zmq::error_t const& err) {
+      throw ZmqReceiveError(ERS_HERE, err.what(), "header");
+    }
+    if (res || hdr.more()) {
+      TLOG_DEBUG(20) << "Endpoint " << m_endpoint << ": Going to receive data";
+
+      // ZMQ guarantees that the entire message has arrived
+
+      try {
+        res = m_socket.recv(msg);
+      } catch (zmq::error_t const& err) {
+        throw ZmqReceiveError(ERS_HERE, err.what(), "data");
+      }
+      TLOG_DEBUG(25) << "Endpoint " << m_endpoint << ": Recv res=" << res.value_or(0)
+                     << " for data (msg.size() == " << msg.size() << ")";
+      if (res && msg.more()) {
+        reassemble(msg);
+      }
+      break;
+    }
+
+    auto elapsed = std::chrono::duration_cast<duration_t>(std::chrono::steady_clock::now() - start_time);
+    if (elapsed >= timeout) {
+      break;
+    }
+
+    // Sleep until a message arrives so that it is picked up immediately, rather than retrying on a fixed period
+    try {
+      zmq::poll(&poll_item, 1, timeout == Receiver::s_block ? duration_t(-1) : timeout - elapsed);
+    } catch (zmq::error_t const& err) {
+      if (err.num() != EINTR) {
+        throw ZmqReceiveError(ERS_HERE, err.what(), "poll");
+      }
+    }
+  } while (true);
+
+  if (!res && !no_tmoexcept_mode) {
+    throw ReceiveTimeoutExpired(ERS_HERE, timeout.count());
+  }
+
+  if (res && m_received_hook) {
+    m_received_hook(std::string_view(static_cast<const char*>(hdr.data()), hdr.size()), msg.size());
+  }
+  return res.has_value();
+}
+
+Receiver::ResponseView
+ZmqSocketReceiver::receive_view(const duration_t& timeout, bool no_tmoexcept_mode)
+{
+  auto received = std::make_shared<ReceivedMessage>();
+  if (!receive(received->header, received->data, timeout, no_tmoexcept_mode)) {
+    return {};
+  }
+
+  TLOG_DEBUG(15) << "Endpoint " << m_endpoint << ": Returning view with metadata size " << received->header.size()
+                 << " and data size " << received->data.size();
+  auto data = static_cast<const char*>(received->data.data());
+  auto size = received->data.size();
+  std::string_view metadata(static_cast<const char*>(received->header.data()), received->header.size());
+  return Receiver::ResponseView(std::move(received), data, size, metadata);
+}
+
+Receiver::IntoResponse
+ZmqSocketReceiver::receive_into(void* dst, size_t capacity, const duration_t& timeout, bool no_tmoexcept_mode)
+{
+  Receiver::IntoResponse output;
+  zmq::message_t hdr, msg;
+
+  // The only copy of the data is the one out of the ZMQ message into the caller's buffer
+  if (receive(hdr, msg, timeout, no_tmoexcept_mode)) {
+    output.metadata.assign(static_cast<const char*>(hdr.data()), hdr.size());
+    output.size = msg.size();
+    output.truncated = msg.size() > capacity;
+    memcpy(dst, msg.data(), std::min(msg.size(), capacity));
+  }
+
+  TLOG_DEBUG(15) << "Endpoint " << m_endpoint << ": Received metadata size " << output.metadata.size()
+                 << " and data size " << output.size << " into a buffer of " << capacity << " bytes";
+  return output;
+}
+
+size_t
+ZmqSocketReceiver::receive_many(std::vector<Receiver::Response>& responses,
+                                size_t max_count,
+                                const duration_t& timeout)
+{
+  zmq::message_t hdr, msg;
+  size_t received = 0;
+  // Only the first message is waited for; after that, just drain what is already queued on the socket. Assigning
+  // into the caller's Responses reuses their buffers.
+  while (received < max_count && receive(hdr, msg, received == 0 ? timeout : Receiver::s_no_block, true)) {
+    auto& output = responses[received++];
+    output.metadata.assign(static_cast<const char*>(hdr.data()), hdr.size());
+    auto data = static_cast<const char*>(msg.data());
+    output.data.assign(data, data + msg.size());
+  }
+
+  TLOG_DEBUG(15) << "Endpoint " << m_endpoint << ": Received " << received << " of up to " << max_count
+                 << " messages";
+  return received;
+}
+
+bool
+ZmqSocketReceiver::wait_for_message(const duration_t& timeout, int wakeup_fd)
+{
+  zmq::pollitem_t poll_items[] = { { m_socket.handle(), 0, ZMQ_POLLIN, 0 }, { nullptr, wakeup_fd, ZMQ_POLLIN, 0 } };
+  try {
+    zmq::poll(poll_items, wakeup_fd >= 0 ? 2 : 1, timeout == Receiver::s_block ? duration_t(-1) : timeout);
+  } catch (zmq::error_t const& err) {
+    if (err.num() != EINTR) {
+      throw ZmqReceiveError(ERS_HERE, err.what(), "poll");
+    }
+  }
+  return (poll_items[0].revents & ZMQ_POLLIN) != 0;
+}
+
+void
+ZmqSocketReceiver::reassemble(zmq::message_t& msg)
+{
+  std::vector<zmq::message_t> parts;
+  size_t size = msg.size();
+  do {
+    parts.emplace_back();
+    try {
+      m_socket.recv(parts.back());
+    } catch (zmq::error_t const& err) {
+      throw ZmqReceiveError(ERS_HERE, err.what(), "data");
+    }
+    size += parts.back().size();
+  } while (parts.back().more());
+
+  zmq::message_t whole(size);
+  auto dest = static_cast<char*>(whole.data());
+  memcpy(dest, msg.data(), msg.size());
+  dest += msg.size();
+  for (auto& part : parts) {
+    memcpy(dest, part.data(), part.size());
+    dest += part.size();
+  }
+  msg = std::move(whole);
+}
+
+} // namespace dunedaq::ipm
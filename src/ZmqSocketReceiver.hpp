@@ -0,0 +1,65 @@
+/**
+ *
+ * @file ZmqSocketReceiver.hpp IPM ZmqSocketReceiver class
+ *
+ * The receiving side shared by ZmqReceiver and ZmqSubscriber: reads a topic frame and the data frame(s) following
+ * it from the plugin's socket, reassembling multipart data, and waits for POLLIN rather than retrying on a period.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef IPM_SRC_ZMQSOCKETRECEIVER_HPP_
+#define IPM_SRC_ZMQSOCKETRECEIVER_HPP_
+
+#include "ipm/Receiver.hpp"
+
+#include "zmq.hpp"
+
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace dunedaq::ipm {
+
+class ZmqSocketReceiver
+{
+public:
+  using duration_t = Receiver::duration_t;
+  // Called for each message received, with its topic and data size
+  using received_hook_t = std::function<void(std::string_view topic, size_t N)>;
+
+  // socket and endpoint (used in log messages) belong to the plugin and are only used once it is connected
+  ZmqSocketReceiver(zmq::socket_t& socket, std::string const& endpoint, received_hook_t received_hook = nullptr);
+
+  // Receive the header (topic) and data frames of the next message, waiting up to timeout for one. Returns false if
+  // the timeout expired, and throws ReceiveTimeoutExpired then unless no_tmoexcept_mode is set.
+  bool receive(zmq::message_t& hdr, zmq::message_t& msg, const duration_t& timeout, bool no_tmoexcept_mode);
+
+  // The counterparts of Receiver::receive_view_, receive_into_ and receive_many_, and of wait_for_message
+  Receiver::ResponseView receive_view(const duration_t& timeout, bool no_tmoexcept_mode);
+  Receiver::IntoResponse receive_into(void* dst, size_t capacity, const duration_t& timeout, bool no_tmoexcept_mode);
+  size_t receive_many(std::vector<Receiver::Response>& responses, size_t max_count, const duration_t& timeout);
+  bool wait_for_message(const duration_t& timeout, int wakeup_fd);
+
+private:
+  // Keeps both frames of a message alive for the lifetime of the ResponseViews referring to them
+  struct ReceivedMessage
+  {
+    zmq::message_t header;
+    zmq::message_t data;
+  };
+
+  // Senders may split a message into several data frames (see Sender::send_segments); join the rest of them onto msg
+  void reassemble(zmq::message_t& msg);
+
+  zmq::socket_t& m_socket;
+  std::string const& m_endpoint;
+  received_hook_t m_received_hook;
+};
+
+} // namespace dunedaq::ipm
+
+#endif // IPM_SRC_ZMQSOCKETRECEIVER_HPP_
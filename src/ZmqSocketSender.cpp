@@ -0,0 +1,211 @@
+/**
+ *
+ * @file ZmqSocketSender.cpp ipm ZmqSocketSender class
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "ZmqSocketSender.hpp"
+#include "ipm/ZmqContext.hpp"
+
+#include "logging/Logging.hpp"
+
+#include <chrono>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace dunedaq::ipm {
+
+ZmqSocketSender::ZmqSocketSender(Sender& sender,
+                                 zmq::socket_t& socket,
+                                 std::string const& endpoint,
+                                 sent_hook_t sent_hook)
+  : m_sender(sender)
+  , m_socket(socket)
+  , m_endpoint(endpoint)
+  , m_sent_hook(std::move(sent_hook))
+{
+}
+
+bool
+ZmqSocketSender::send(const void* message,
+                      size_t N,
+                      const duration_t& timeout,
+                      std::string_view topic,
+                      bool no_tmoexcept_mode)
+{
+  zmq::message_t msg(message, N);
+  return send_message(&msg, 1, timeout, topic, no_tmoexcept_mode);
+}
+
+bool
+ZmqSocketSender::send_owned(Sender::owned_buffer_t message,
+                            size_t N,
+                            const duration_t& timeout,
+                            std::string_view topic,
+                            bool no_tmoexcept_mode)
+{
+  // ZMQ frees the buffer (from its IO thread) once the message has been transmitted
+  auto hint = new Sender::owned_buffer_t(std::move(message));
+  zmq::message_t msg(
+    hint->get(), N, [](void*, void* buffer) { delete static_cast<Sender::owned_buffer_t*>(buffer); }, hint);
+  return send_message(&msg, 1, timeout, topic, no_tmoexcept_mode);
+}
+
+bool
+ZmqSocketSender::send_segments(const Sender::Segment* segments,
+                               size_t segment_count,
+                               size_t N,
+                               const duration_t& timeout,
+                               std::string_view topic,
+                               bool no_tmoexcept_mode)
+{
+  // Each segment goes out as its own frame of one multipart message, which the receivers reassemble
+  std::vector<zmq::message_t> parts;
+  parts.reserve(segment_count);
+  for (size_t ii = 0; ii < segment_count; ++ii) {
+    if (segments[ii].size != 0) {
+      parts.emplace_back(segments[ii].data, segments[ii].size);
+    }
+  }
+  TLOG_DEBUG(10) << "Endpoint " << m_endpoint << ": Sending " << N << " bytes in " << parts.size() << " segments";
+  return send_message(parts.data(), parts.size(), timeout, topic, no_tmoexcept_mode);
+}
+
+size_t
+ZmqSocketSender::send_batch(const Sender::BatchEntry* entries, size_t count, const duration_t& timeout)
+{
+  TLOG_DEBUG(10) << "Endpoint " << m_endpoint << ": Starting batch send of " << count << " messages";
+  auto start_time = std::chrono::steady_clock::now();
+  size_t accepted = 0;
+  for (; accepted < count; ++accepted) {
+    auto& entry = entries[accepted];
+    if (entry.size == 0) {
+      continue;
+    }
+
+    // Messages normally go straight into the socket's queue; send_message only waits once the high-water mark is
+    // reached
+    zmq::message_t msg(entry.message, entry.size);
+    auto elapsed = std::chrono::duration_cast<duration_t>(std::chrono::steady_clock::now() - start_time);
+    auto remaining = timeout == Sender::s_block ? Sender::s_block
+                                                : (elapsed < timeout ? timeout - elapsed : duration_t::zero());
+    if (!send_message(&msg, 1, remaining, entry.metadata, true)) {
+      break;
+    }
+  }
+  TLOG_DEBUG(15) << "Endpoint " << m_endpoint << ": Completed batch send, " << accepted << " of " << count
+                 << " messages accepted";
+  return accepted;
+}
+
+zmq::send_result_t
+ZmqSocketSender::send_frame(zmq::message_t& frame, zmq::send_flags flags)
+{
+  return m_socket.send(frame, flags);
+}
+
+bool
+ZmqSocketSender::try_send_message(zmq::message_t& topic_msg,
+                                  zmq::message_t* parts,
+                                  size_t part_count,
+                                  size_t& next_frame,
+                                  std::string_view topic)
+{
+  for (; next_frame <= part_count; ++next_frame) {
+    auto& frame = next_frame == 0 ? topic_msg : parts[next_frame - 1];
+    auto N = frame.size();
+    zmq::send_result_t res{};
+    try {
+      res = send_frame(frame, next_frame < part_count ? zmq::send_flags::sndmore : zmq::send_flags::none);
+    } catch (zmq::error_t const& err) {
+      throw ZmqSendError(ERS_HERE, err.what(), N, std::string(topic));
+    }
+    // Only whether each frame was queued is checked: ZMQ reports at most INT_MAX bytes for a frame it has taken whole
+    if (!res) {
+      if (next_frame != 0) {
+        m_sender.add_partial_multipart_failure();
+      }
+      return false;
+    }
+  }
+
+  if (m_sent_hook) {
+    size_t total = 0;
+    for (size_t ii = 0; ii < part_count; ++ii) {
+      total += parts[ii].size();
+    }
+    m_sent_hook(topic, total);
+  }
+  return true;
+}
+
+bool
+ZmqSocketSender::send_message(zmq::message_t* parts,
+                              size_t part_count,
+                              const duration_t& timeout,
+                              std::string_view topic,
+                              bool no_tmoexcept_mode)
+{
+  size_t N = 0;
+  for (size_t ii = 0; ii < part_count; ++ii) {
+    N += parts[ii].size();
+  }
+  TLOG_DEBUG(10) << "Endpoint " << m_endpoint << ": Starting send of " << N << " bytes";
+  auto start_time = std::chrono::steady_clock::now();
+  std::chrono::steady_clock::duration wait_time{};
+  zmq::pollitem_t poll_item{ m_socket.handle(), 0, ZMQ_POLLOUT, 0 };
+  zmq::message_t topic_msg(topic.data(), topic.size());
+  // Once the topic frame is queued the message is open on the socket, so a refused frame is retried on its own rather
+  // than restarting from the topic frame, whose data ZMQ has already taken
+  size_t next_frame = 0;
+  bool sent = false;
+  do {
+    sent = try_send_message(topic_msg, parts, part_count, next_frame, topic);
+    if (sent) {
+      break;
+    }
+    TLOG_DEBUG(2) << "Endpoint " << m_endpoint << ": Unable to send message";
+
+    auto elapsed = std::chrono::duration_cast<duration_t>(std::chrono::steady_clock::now() - start_time);
+    if (elapsed >= timeout) {
+      break;
+    }
+
+    // Sleep until the socket can accept the message (the HWM has drained) instead of retrying on a fixed period
+    auto poll_start = std::chrono::steady_clock::now();
+    try {
+      zmq::poll(&poll_item, 1, timeout == Sender::s_block ? duration_t(-1) : timeout - elapsed);
+    } catch (zmq::error_t const& err) {
+      if (err.num() != EINTR) {
+        throw ZmqSendError(ERS_HERE, err.what(), N, std::string(topic));
+      }
+    }
+    wait_time += std::chrono::steady_clock::now() - poll_start;
+    if (next_frame == 0) {
+      m_sender.add_send_retry();
+    }
+  } while (true);
+
+  m_sender.add_send_wait_time(wait_time);
+
+  if (!sent && next_frame != 0) {
+    // The frames already queued cannot be withdrawn, and the next message sent would be appended to them
+    throw ZmqSendError(ERS_HERE,
+                       "Timed out part of the way through a multipart message; the socket is left mid-message",
+                       N,
+                       std::string(topic));
+  }
+
+  if (!sent && !no_tmoexcept_mode) {
+    throw SendTimeoutExpired(ERS_HERE, timeout.count());
+  }
+
+  TLOG_DEBUG(15) << "Endpoint " << m_endpoint << ": Completed send of " << N << " bytes";
+  return sent;
+}
+
+} // namespace dunedaq::ipm
@@ -0,0 +1,83 @@
+/**
+ *
+ * @file ZmqSocketSender.hpp IPM ZmqSocketSender class
+ *
+ * The sending side shared by ZmqSender and ZmqPublisher: each message goes out on the plugin's socket as a topic
+ * frame followed by one or more data frames, waiting for POLLOUT when the socket is at its high-water mark. The
+ * retries, wait time and partial multipart failures are reported to the owning Sender.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef IPM_SRC_ZMQSOCKETSENDER_HPP_
+#define IPM_SRC_ZMQSOCKETSENDER_HPP_
+
+#include "ipm/Sender.hpp"
+
+#include "zmq.hpp"
+
+#include <functional>
+#include <string>
+#include <string_view>
+
+namespace dunedaq::ipm {
+
+class ZmqSocketSender
+{
+public:
+  using duration_t = Sender::duration_t;
+  // Called for each message once all of its frames are queued on the socket, with its topic and data size
+  using sent_hook_t = std::function<void(std::string_view topic, size_t N)>;
+
+  // socket and endpoint (used in log messages) belong to sender and are only used once it is connected
+  ZmqSocketSender(Sender& sender, zmq::socket_t& socket, std::string const& endpoint, sent_hook_t sent_hook = nullptr);
+  virtual ~ZmqSocketSender() = default;
+
+  // The counterparts of Sender::send_, send_owned_, send_segments_ and send_batch_
+  bool send(const void* message,
+            size_t N,
+            const duration_t& timeout,
+            std::string_view topic,
+            bool no_tmoexcept_mode);
+  bool send_owned(Sender::owned_buffer_t message,
+                  size_t N,
+                  const duration_t& timeout,
+                  std::string_view topic,
+                  bool no_tmoexcept_mode);
+  bool send_segments(const Sender::Segment* segments,
+                     size_t segment_count,
+                     size_t N,
+                     const duration_t& timeout,
+                     std::string_view topic,
+                     bool no_tmoexcept_mode);
+  size_t send_batch(const Sender::BatchEntry* entries, size_t count, const duration_t& timeout);
+
+protected:
+  // Queue one frame on the socket without waiting; overridden by the unit tests to make the socket refuse frames
+  virtual zmq::send_result_t send_frame(zmq::message_t& frame, zmq::send_flags flags);
+
+private:
+  // Queue the frames of a message, from next_frame on, without waiting. Frame 0 is topic_msg and frame ii + 1 is
+  // parts[ii]. Returns false if the socket refused a frame, leaving next_frame at it so that the send can resume there.
+  bool try_send_message(zmq::message_t& topic_msg,
+                        zmq::message_t* parts,
+                        size_t part_count,
+                        size_t& next_frame,
+                        std::string_view topic);
+  bool send_message(zmq::message_t* parts,
+                    size_t part_count,
+                    const duration_t& timeout,
+                    std::string_view topic,
+                    bool no_tmoexcept_mode);
+
+  Sender& m_sender;
+  zmq::socket_t& m_socket;
+  std::string const& m_endpoint;
+  sent_hook_t m_sent_hook;
+};
+
+} // namespace dunedaq::ipm
+
+#endif // IPM_SRC_ZMQSOCKETSENDER_HPP_
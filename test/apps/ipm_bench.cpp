@@ -0,0 +1,373 @@
+/**
+ * @file ipm_bench.cpp Throughput benchmark sweeping IPM plugins, transports and configurations
+ *
+ * Every combination of plugin pair, transport, message size, sender count, receiver count, ZMQ IO thread count and
+ * receive mode (polling receive() or a registered callback) given on the command line is run in turn: the senders
+ * push a fixed number of messages each as fast as they can, and the receivers count what arrives. The results are
+ * written as one JSON document.
+ *
+ * ZMQ only honours the IO thread count of a context before its first socket is created, so the runs for each IO
+ * thread count are made in a child process of their own.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "ipm/PluginInfo.hpp"
+#include "ipm/Receiver.hpp"
+#include "ipm/Sender.hpp"
+#include "ipm/Subscriber.hpp"
+#include "ipm/ZmqContext.hpp"
+
+#include "boost/program_options.hpp"
+#include "nlohmann/json.hpp"
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace dunedaq::ipm;
+
+namespace {
+
+struct PluginPair
+{
+  std::string sender;
+  std::string receiver;
+  bool publish;          // Every receiver gets every message, rather than each message going to one receiver
+  bool zmq;              // Runs over the inproc/ipc/tcp transports, and is affected by the IO thread count
+  bool one_to_one;       // Each sender needs a receiver of its own
+  std::string transport; // For plugins with a transport of their own
+};
+
+const std::vector<PluginPair> s_plugin_pairs{
+  { ZmqPluginNames.at(IpmPluginType::Sender), ZmqPluginNames.at(IpmPluginType::Receiver), false, true, false, "" },
+  { ZmqPluginNames.at(IpmPluginType::Publisher), ZmqPluginNames.at(IpmPluginType::Subscriber), true, true, false, "" },
+  { ShmPluginNames.at(IpmPluginType::Sender), ShmPluginNames.at(IpmPluginType::Receiver), false, false, true, "shm" },
+  { InprocPluginNames.at(IpmPluginType::Sender),
+    InprocPluginNames.at(IpmPluginType::Receiver),
+    false,
+    false,
+    false,
+    "inproc" },
+};
+
+struct RunConfig
+{
+  PluginPair const* plugins;
+  std::string transport;
+  size_t message_size;
+  size_t senders;
+  size_t receivers;
+  size_t io_threads;
+  bool callback;
+  size_t messages_per_sender;
+};
+
+// Receivers bind, so each run gets fresh endpoints; tcp ports are picked by the system
+std::string
+endpoint(RunConfig const& config, int run_id, size_t index)
+{
+  auto name = "ipm_bench_" + std::to_string(getpid()) + "_" + std::to_string(run_id) + "_" + std::to_string(index);
+  if (config.transport == "shm") {
+    return "shm://" + name;
+  }
+  if (config.transport == "inproc") {
+    return config.plugins->zmq ? "inproc://" + name : "inproc://ipm_bench_" + std::to_string(run_id);
+  }
+  if (config.transport == "ipc") {
+    return "ipc:///tmp/" + name;
+  }
+  return "tcp://127.0.0.1:*";
+}
+
+nlohmann::json
+run(RunConfig const& config, int run_id, std::chrono::milliseconds idle_timeout)
+{
+  bool publish = config.plugins->publish;
+  std::vector<std::shared_ptr<Sender>> senders;
+  std::vector<std::shared_ptr<Receiver>> receivers;
+  std::vector<std::string> endpoints;
+
+  if (publish) {
+    // Publishers bind and subscribers connect to all of them
+    for (size_t ii = 0; ii < config.senders; ++ii) {
+      senders.push_back(make_ipm_sender(config.plugins->sender));
+      endpoints.push_back(senders.back()->connect_for_sends({ { "connection_string", endpoint(config, run_id, ii) } }));
+    }
+    for (size_t ii = 0; ii < config.receivers; ++ii) {
+      auto subscriber = make_ipm_subscriber(config.plugins->receiver);
+      subscriber->connect_for_receives({ { "connection_strings", endpoints } });
+      subscriber->subscribe("");
+      receivers.push_back(subscriber);
+    }
+    // Give the subscriptions time to reach the publishers, which drop messages nobody has subscribed to yet
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  } else {
+    for (size_t ii = 0; ii < config.receivers; ++ii) {
+      receivers.push_back(make_ipm_receiver(config.plugins->receiver));
+      endpoints.push_back(
+        receivers.back()->connect_for_receives({ { "connection_string", endpoint(config, run_id, ii) } }));
+    }
+    for (size_t ii = 0; ii < config.senders; ++ii) {
+      senders.push_back(make_ipm_sender(config.plugins->sender));
+      senders.back()->connect_for_sends({ { "connection_string", endpoints[ii % endpoints.size()] } });
+    }
+  }
+
+  size_t sent_total = config.senders * config.messages_per_sender;
+  size_t expected = publish ? sent_total * config.receivers : sent_total;
+  std::atomic<size_t> received{ 0 };
+  std::atomic<size_t> sent{ 0 };
+  std::atomic<bool> senders_done{ false };
+  auto start_time = std::chrono::steady_clock::now();
+  std::atomic<std::chrono::steady_clock::rep> last_receive{ start_time.time_since_epoch().count() };
+  auto count_received = [&](size_t count) {
+    received += count;
+    last_receive = std::chrono::steady_clock::now().time_since_epoch().count();
+  };
+  // Receivers stop once everything has arrived, or once nothing has arrived for idle_timeout after the senders
+  // finished (messages were dropped)
+  auto finished = [&]() {
+    if (received.load() >= expected) {
+      return true;
+    }
+    auto idle = std::chrono::steady_clock::now().time_since_epoch().count() - last_receive.load();
+    return senders_done.load() && std::chrono::steady_clock::duration(idle) > idle_timeout;
+  };
+
+  std::vector<std::thread> threads;
+  if (config.callback) {
+    for (auto& receiver : receivers) {
+      receiver->register_callback([&](Receiver::Response&) { count_received(1); });
+    }
+  } else {
+    for (auto& receiver : receivers) {
+      threads.emplace_back([&, receiver]() {
+        while (!finished()) {
+          auto response = receiver->receive(std::chrono::milliseconds(10), Receiver::s_any_size, true);
+          if (!response.data.empty() || !response.metadata.empty()) {
+            count_received(1);
+            receiver->release(std::move(response));
+          }
+        }
+      });
+    }
+  }
+
+  std::vector<std::thread> sender_threads;
+  for (auto& sender : senders) {
+    sender_threads.emplace_back([&, sender]() {
+      std::vector<char> message(config.message_size, 'A');
+      for (size_t ii = 0; ii < config.messages_per_sender; ++ii) {
+        if (!sender->send(message.data(), message.size(), idle_timeout, "bench", true)) {
+          break;
+        }
+        ++sent;
+      }
+    });
+  }
+  for (auto& thread : sender_threads) {
+    thread.join();
+  }
+  auto send_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+  senders_done = true;
+
+  if (config.callback) {
+    while (!finished()) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    for (auto& receiver : receivers) {
+      receiver->unregister_callback();
+    }
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  auto end_time = std::chrono::steady_clock::time_point(std::chrono::steady_clock::duration(last_receive.load()));
+  auto seconds = std::chrono::duration<double>(end_time - start_time).count();
+  double received_messages = static_cast<double>(received.load());
+  if (publish) {
+    // Rates are per subscriber
+    received_messages /= config.receivers;
+  }
+
+  nlohmann::json result;
+  result["sender_plugin"] = config.plugins->sender;
+  result["receiver_plugin"] = config.plugins->receiver;
+  result["transport"] = config.transport;
+  result["message_size"] = config.message_size;
+  result["senders"] = config.senders;
+  result["receivers"] = config.receivers;
+  result["io_threads"] = config.plugins->zmq ? nlohmann::json(config.io_threads) : nlohmann::json(nullptr);
+  result["receive_mode"] = config.callback ? "callback" : "poll";
+  result["messages_sent"] = sent.load();
+  result["messages_received"] = received.load();
+  result["messages_lost"] = expected > received.load() ? expected - received.load() : 0;
+  result["send_seconds"] = send_seconds;
+  result["seconds"] = seconds;
+  result["messages_per_second"] = seconds > 0 ? received_messages / seconds : 0;
+  result["bytes_per_second"] = seconds > 0 ? received_messages * config.message_size / seconds : 0;
+  return result;
+}
+
+nlohmann::json
+run_all(std::vector<RunConfig> const& configs, std::chrono::milliseconds idle_timeout)
+{
+  auto results = nlohmann::json::array();
+  int run_id = 0;
+  for (auto& config : configs) {
+    std::cerr << config.plugins->sender << "/" << config.plugins->receiver << " over " << config.transport << ", "
+              << config.message_size << " B, " << config.senders << "x" << config.receivers << ", "
+              << (config.callback ? "callback" : "poll") << std::endl;
+    results.push_back(run(config, run_id++, idle_timeout));
+  }
+  return results;
+}
+
+// Run configs in a child process whose ZMQ context has io_threads IO threads, and collect its results
+nlohmann::json
+run_in_child(std::vector<RunConfig> const& configs, size_t io_threads, std::chrono::milliseconds idle_timeout)
+{
+  int fds[2];
+  if (pipe(fds) != 0) {
+    std::cerr << "Unable to create pipe" << std::endl;
+    return nlohmann::json::array();
+  }
+
+  auto pid = fork();
+  if (pid == 0) {
+    close(fds[0]);
+    ZmqContext::instance().set_context_threads(static_cast<int>(io_threads));
+    auto output = run_all(configs, idle_timeout).dump();
+    for (size_t written = 0; written < output.size();) {
+      auto res = write(fds[1], output.data() + written, output.size() - written);
+      if (res <= 0) {
+        break;
+      }
+      written += res;
+    }
+    close(fds[1]);
+    _exit(0);
+  }
+
+  close(fds[1]);
+  std::string output;
+  char buffer[4096];
+  ssize_t res = 0;
+  while ((res = read(fds[0], buffer, sizeof(buffer))) > 0) {
+    output.append(buffer, res);
+  }
+  close(fds[0]);
+  int status = 0;
+  waitpid(pid, &status, 0);
+  if (!WIFEXITED(status) || WEXITSTATUS(status) != 0 || output.empty()) {
+    std::cerr << "Runs with " << io_threads << " IO threads did not complete" << std::endl;
+    return nlohmann::json::array();
+  }
+  return nlohmann::json::parse(output);
+}
+
+} // namespace ""
+
+int
+main(int argc, char* argv[])
+{
+  std::vector<std::string> plugins{ "ZmqSender", "ZmqPublisher", "ShmSender", "InprocSender" };
+  std::vector<std::string> transports{ "inproc", "ipc", "tcp" };
+  std::vector<size_t> sizes{ 64, 1024, 65536, 1048576 };
+  std::vector<size_t> sender_counts{ 1 };
+  std::vector<size_t> receiver_counts{ 1 };
+  std::vector<size_t> io_thread_counts{ 1 };
+  std::vector<std::string> modes{ "poll", "callback" };
+  size_t messages = 10000;
+  size_t max_bytes = size_t(1) << 30;
+  int idle_timeout_ms = 1000;
+  std::string output_file;
+
+  namespace po = boost::program_options;
+  po::options_description desc("Measures IPM throughput over a sweep of plugins and configurations, writing JSON");
+  desc.add_options()("help,h", "Print this help")(
+    "plugins", po::value(&plugins)->multitoken(), "Sender plugins to measure, each with its matching receiver")(
+    "transports", po::value(&transports)->multitoken(), "Transports for the ZMQ plugins: inproc, ipc, tcp")(
+    "sizes,s", po::value(&sizes)->multitoken(), "Message sizes, in bytes")(
+    "senders", po::value(&sender_counts)->multitoken(), "Numbers of sending threads")(
+    "receivers", po::value(&receiver_counts)->multitoken(), "Numbers of receivers")(
+    "io-threads", po::value(&io_thread_counts)->multitoken(), "ZMQ context IO thread counts")(
+    "modes", po::value(&modes)->multitoken(), "Receive modes: poll, callback")(
+    "messages,n", po::value(&messages), "Messages per sender")(
+    "max-bytes", po::value(&max_bytes), "Limit on the bytes per sender, which reduces the messages for large sizes")(
+    "idle-timeout", po::value(&idle_timeout_ms), "Milliseconds without progress after which a run is ended")(
+    "output,o", po::value(&output_file), "File to write the JSON results to, instead of stdout");
+  try {
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+    if (vm.count("help")) {
+      std::cout << desc << std::endl;
+      return 0;
+    }
+  } catch (std::exception& ex) {
+    std::cerr << "Error parsing command line " << ex.what() << std::endl;
+    std::cerr << desc << std::endl;
+    return 0;
+  }
+
+  // One list of runs per IO thread count; plugins which do not use ZMQ only need running once
+  std::vector<std::vector<RunConfig>> configs(io_thread_counts.size());
+  for (auto& plugin : plugins) {
+    auto pair = std::find_if(
+      s_plugin_pairs.begin(), s_plugin_pairs.end(), [&](PluginPair const& pp) { return pp.sender == plugin; });
+    if (pair == s_plugin_pairs.end()) {
+      std::cerr << "Unknown sender plugin " << plugin << std::endl;
+      return 1;
+    }
+    auto plugin_transports = pair->zmq ? transports : std::vector<std::string>{ pair->transport };
+    for (size_t tt = 0; tt < (pair->zmq ? io_thread_counts.size() : 1); ++tt) {
+      for (auto& transport : plugin_transports) {
+        for (auto size : sizes) {
+          for (auto nsenders : sender_counts) {
+            for (auto nreceivers : receiver_counts) {
+              if (pair->one_to_one && nsenders != nreceivers) {
+                continue;
+              }
+              for (auto& mode : modes) {
+                auto count = std::max<size_t>(1, std::min(messages, max_bytes / std::max<size_t>(size, 1)));
+                configs[tt].push_back(RunConfig{
+                  &*pair, transport, size, nsenders, nreceivers, io_thread_counts[tt], mode == "callback", count });
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+
+  nlohmann::json output;
+  output["benchmark"] = "ipm_bench";
+  output["results"] = nlohmann::json::array();
+  for (size_t tt = 0; tt < configs.size(); ++tt) {
+    if (!configs[tt].empty()) {
+      auto results = run_in_child(configs[tt], io_thread_counts[tt], std::chrono::milliseconds(idle_timeout_ms));
+      output["results"].insert(output["results"].end(), results.begin(), results.end());
+    }
+  }
+
+  if (output_file.empty()) {
+    std::cout << output.dump(2) << std::endl;
+  } else {
+    std::ofstream(output_file) << output.dump(2) << std::endl;
+  }
+  return 0;
+}
@@ -0,0 +1,273 @@
+/**
+ * @file ipm_pingpong.cpp Round-trip latency benchmark for IPM plugins
+ *
+ * A pinger sends a message through one Sender/Receiver pair to a ponger, which echoes it back through a second pair,
+ * and the round-trip time is recorded. Pings are scheduled at a fixed rate and each round trip is timed from when its
+ * ping was due to be sent rather than from when it was actually sent, so that a stall which delays the following
+ * pings is counted against all of them (no coordinated omission). The latency percentiles are printed, and
+ * optionally written as JSON, together with the uncorrected ones timed from the actual send.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "ipm/PluginInfo.hpp"
+#include "ipm/Receiver.hpp"
+#include "ipm/Sender.hpp"
+#include "ipm/Subscriber.hpp"
+
+#include "boost/program_options.hpp"
+#include "nlohmann/json.hpp"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <numeric>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace dunedaq::ipm;
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+const std::map<std::string, std::string> s_receiver_plugins{
+  { ZmqPluginNames.at(IpmPluginType::Sender), ZmqPluginNames.at(IpmPluginType::Receiver) },
+  { ZmqPluginNames.at(IpmPluginType::Publisher), ZmqPluginNames.at(IpmPluginType::Subscriber) },
+  { ShmPluginNames.at(IpmPluginType::Sender), ShmPluginNames.at(IpmPluginType::Receiver) },
+  { InprocPluginNames.at(IpmPluginType::Sender), InprocPluginNames.at(IpmPluginType::Receiver) },
+};
+
+// One direction of the ping-pong: the receiver binds (or owns the channel) and the sender connects to it
+std::pair<std::shared_ptr<Sender>, std::shared_ptr<Receiver>>
+make_link(std::string const& sender_plugin, std::string const& connection_string)
+{
+  auto receiver_plugin = s_receiver_plugins.at(sender_plugin);
+  auto sender = make_ipm_sender(sender_plugin);
+  if (sender_plugin == ZmqPluginNames.at(IpmPluginType::Publisher)) {
+    auto endpoint = sender->connect_for_sends({ { "connection_string", connection_string } });
+    auto subscriber = make_ipm_subscriber(receiver_plugin);
+    subscriber->connect_for_receives({ { "connection_strings", { endpoint } } });
+    subscriber->subscribe("");
+    // Publishers drop messages until the subscription has reached them
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    return { sender, subscriber };
+  }
+
+  auto receiver = make_ipm_receiver(receiver_plugin);
+  auto endpoint = receiver->connect_for_receives({ { "connection_string", connection_string } });
+  sender->connect_for_sends({ { "connection_string", endpoint } });
+  return { sender, receiver };
+}
+
+std::string
+connection_string(std::string const& sender_plugin, std::string const& transport, std::string const& direction)
+{
+  auto name = "ipm_pingpong_" + std::to_string(getpid()) + "_" + direction;
+  if (sender_plugin == ShmPluginNames.at(IpmPluginType::Sender)) {
+    return "shm://" + name;
+  }
+  if (sender_plugin == InprocPluginNames.at(IpmPluginType::Sender) || transport == "inproc") {
+    return "inproc://" + name;
+  }
+  if (transport == "ipc") {
+    return "ipc:///tmp/" + name;
+  }
+  return "tcp://127.0.0.1:*";
+}
+
+// Latencies in nanoseconds, sorted in place
+nlohmann::json
+summarize(std::vector<uint64_t>& latencies)
+{
+  nlohmann::json summary;
+  if (latencies.empty()) {
+    return summary;
+  }
+  std::sort(latencies.begin(), latencies.end());
+  auto percentile_us = [&](double fraction) {
+    auto rank = static_cast<size_t>(fraction * (latencies.size() - 1) + 0.5);
+    return latencies[rank] / 1000.;
+  };
+  summary["mean"] = std::accumulate(latencies.begin(), latencies.end(), 0.) / latencies.size() / 1000.;
+  summary["p50"] = percentile_us(0.5);
+  summary["p90"] = percentile_us(0.9);
+  summary["p99"] = percentile_us(0.99);
+  summary["p99.9"] = percentile_us(0.999);
+  summary["max"] = latencies.back() / 1000.;
+  return summary;
+}
+
+void
+wait_until(clock_type::time_point when)
+{
+  // Sleeping can overshoot by tens of microseconds, which would be counted as latency; spin for the last stretch
+  // when there is a core to spare for it
+  static const bool s_spin = std::thread::hardware_concurrency() > 1;
+  constexpr auto spin_time = std::chrono::microseconds(50);
+  if (s_spin) {
+    std::this_thread::sleep_until(when - spin_time);
+    while (clock_type::now() < when) {
+    }
+  } else {
+    std::this_thread::sleep_until(when);
+  }
+}
+
+} // namespace ""
+
+int
+main(int argc, char* argv[])
+{
+  std::string plugin = ZmqPluginNames.at(IpmPluginType::Sender);
+  std::string transport = "tcp";
+  size_t message_size = 64;
+  size_t round_trips = 1000000;
+  size_t warmup = 10000;
+  double rate = 10000;
+  int timeout_ms = 1000;
+  std::string output_file;
+
+  namespace po = boost::program_options;
+  po::options_description desc("Measures the round-trip latency distribution of an IPM plugin");
+  desc.add_options()("help,h", "Print this help")(
+    "plugin,p", po::value(&plugin), "Sender plugin, used with its matching receiver in both directions")(
+    "transport,t", po::value(&transport), "Transport for the ZMQ plugins: inproc, ipc or tcp")(
+    "size,s", po::value(&message_size), "Message size, in bytes (at least 8)")(
+    "round-trips,n", po::value(&round_trips), "Number of round trips to measure")(
+    "warmup,w", po::value(&warmup), "Number of round trips to make before measuring")(
+    "rate,r", po::value(&rate), "Pings per second; 0 sends each ping as soon as the previous pong arrives")(
+    "timeout", po::value(&timeout_ms), "Milliseconds after which a pong is considered lost")(
+    "output,o", po::value(&output_file), "File to write the results to as JSON");
+  try {
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+    if (vm.count("help")) {
+      std::cout << desc << std::endl;
+      return 0;
+    }
+  } catch (std::exception& ex) {
+    std::cerr << "Error parsing command line " << ex.what() << std::endl;
+    std::cerr << desc << std::endl;
+    return 0;
+  }
+  if (s_receiver_plugins.count(plugin) == 0) {
+    std::cerr << "Unknown sender plugin " << plugin << std::endl;
+    return 1;
+  }
+  message_size = std::max(message_size, sizeof(uint64_t));
+
+  auto [ping_sender, ping_receiver] = make_link(plugin, connection_string(plugin, transport, "ping"));
+  auto [pong_sender, pong_receiver] = make_link(plugin, connection_string(plugin, transport, "pong"));
+
+  // The ponger echoes every ping straight back
+  std::atomic<bool> running{ true };
+  std::thread ponger([&, ping_receiver = ping_receiver, pong_sender = pong_sender]() {
+    while (running.load()) {
+      auto ping = ping_receiver->receive(std::chrono::milliseconds(100), Receiver::s_any_size, true);
+      if (!ping.data.empty()) {
+        pong_sender->send(ping.data.data(), ping.data.size(), Sender::s_block);
+        ping_receiver->release(std::move(ping));
+      }
+    }
+  });
+
+  std::vector<uint64_t> latencies;
+  std::vector<uint64_t> uncorrected_latencies;
+  latencies.reserve(round_trips);
+  uncorrected_latencies.reserve(round_trips);
+  size_t lost = 0;
+  std::vector<char> message(message_size, 'A');
+  auto interval = rate > 0 ? std::chrono::duration_cast<clock_type::duration>(std::chrono::duration<double>(1 / rate))
+                           : clock_type::duration::zero();
+  auto start_time = clock_type::now();
+  auto measure_start = start_time;
+  auto due = start_time;
+
+  for (uint64_t seq = 0; seq < warmup + round_trips; ++seq) {
+    if (rate > 0) {
+      due = start_time + interval * seq;
+      wait_until(due);
+    } else {
+      due = clock_type::now();
+    }
+    auto sent_at = clock_type::now();
+    memcpy(message.data(), &seq, sizeof(seq));
+    ping_sender->send(message.data(), message.size(), Sender::s_block);
+
+    // Skip any stale pongs of pings which were given up on
+    bool answered = false;
+    while (!answered) {
+      auto pong = pong_receiver->receive(std::chrono::milliseconds(timeout_ms), Receiver::s_any_size, true);
+      if (pong.data.size() < sizeof(uint64_t)) {
+        break;
+      }
+      uint64_t pong_seq = 0;
+      memcpy(&pong_seq, pong.data.data(), sizeof(pong_seq));
+      answered = pong_seq == seq;
+      pong_receiver->release(std::move(pong));
+    }
+    auto received_at = clock_type::now();
+
+    if (seq < warmup) {
+      if (seq + 1 == warmup) {
+        // Measurement starts now, so restart the schedule too
+        measure_start = clock_type::now();
+        start_time = measure_start - interval * (seq + 1);
+      }
+      continue;
+    }
+    if (!answered) {
+      ++lost;
+      continue;
+    }
+    using std::chrono::nanoseconds;
+    latencies.push_back(std::chrono::duration_cast<nanoseconds>(received_at - due).count());
+    uncorrected_latencies.push_back(std::chrono::duration_cast<nanoseconds>(received_at - sent_at).count());
+  }
+  auto seconds = std::chrono::duration<double>(clock_type::now() - measure_start).count();
+
+  running = false;
+  ponger.join();
+
+  nlohmann::json result;
+  result["benchmark"] = "ipm_pingpong";
+  result["sender_plugin"] = plugin;
+  result["receiver_plugin"] = s_receiver_plugins.at(plugin);
+  result["transport"] = transport;
+  result["message_size"] = message_size;
+  result["target_rate"] = rate;
+  result["round_trips"] = latencies.size();
+  result["lost"] = lost;
+  result["achieved_rate"] = seconds > 0 ? latencies.size() / seconds : 0;
+  result["latency_us"] = summarize(latencies);
+  result["uncorrected_latency_us"] = summarize(uncorrected_latencies);
+
+  std::cout << plugin << " (" << transport << "), " << message_size << " B, " << result["round_trips"]
+            << " round trips at " << rate << "/s, " << lost << " lost" << std::endl;
+  const std::vector<std::pair<std::string, std::string>> reports{ { "Latency", "latency_us" },
+                                                                   { "Uncorrected", "uncorrected_latency_us" } };
+  for (auto& [name, key] : reports) {
+    if (!result[key].empty()) {
+      std::cout << name << " (us): p50 " << result[key]["p50"] << ", p99 " << result[key]["p99"] << ", p99.9 "
+                << result[key]["p99.9"] << ", max " << result[key]["max"] << std::endl;
+    }
+  }
+  if (!output_file.empty()) {
+    std::ofstream(output_file) << result.dump(2) << std::endl;
+  }
+  return 0;
+}
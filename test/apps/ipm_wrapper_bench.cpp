@@ -0,0 +1,201 @@
+/**
+ * @file ipm_wrapper_bench.cpp Microbenchmarks of the Sender and Receiver base-class wrappers
+ *
+ * Null Sender and Receiver plugins, which do no I/O, are driven through the public send() and receive() wrappers
+ * and, for comparison, through their protected virtual implementations directly. The difference is the cost of the
+ * wrapper's state checks, opmon counters and timing. The null plugins can also execute the same TLOG_DEBUG sites as
+ * the ZMQ plugins' hot paths, and the counter and logging primitives are timed on their own, so that a regression can
+ * be pinned on one of them. Results are printed in ns/op and optionally written as JSON.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "ipm/LatencyHistogram.hpp"
+#include "ipm/Receiver.hpp"
+#include "ipm/Sender.hpp"
+
+#include "boost/program_options.hpp"
+#include "logging/Logging.hpp"
+#include "nlohmann/json.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace dunedaq::ipm;
+
+namespace {
+
+const std::string s_endpoint = "null://ipm_wrapper_bench";
+
+// With LogSites, send_ formats the same debug messages as ZmqSender::send_
+template<bool LogSites>
+class NullSender : public Sender
+{
+public:
+  std::string connect_for_sends(const nlohmann::json& /* connection_info */) override
+  {
+    m_can_send = true;
+    return s_endpoint;
+  }
+  bool can_send() const noexcept override { return m_can_send; }
+
+  bool call_send_(const void* message, message_size_t N)
+  {
+    return send_(message, N, s_no_block, "", false);
+  }
+
+protected:
+  bool send_(const void* message,
+             message_size_t N,
+             const duration_t& /* timeout */,
+             const std::string& /* metadata */,
+             bool /* no_tmoexcept_mode */) override
+  {
+    if constexpr (LogSites) {
+      TLOG_DEBUG(10) << "Endpoint " << s_endpoint << ": Starting send of " << N << " bytes";
+    }
+    m_last = message;
+    if constexpr (LogSites) {
+      TLOG_DEBUG(15) << "Endpoint " << s_endpoint << ": Completed send of " << N << " bytes";
+    }
+    return true;
+  }
+
+private:
+  bool m_can_send{ false };
+  const void* volatile m_last{ nullptr };
+};
+
+// With LogSites, receive_ formats the same debug message as ZmqReceiver::receive_
+template<bool LogSites>
+class NullReceiver : public Receiver
+{
+public:
+  explicit NullReceiver(size_t message_size)
+    : m_message_size(message_size)
+  {}
+
+  std::string connect_for_receives(const nlohmann::json& /* connection_info */) override
+  {
+    m_can_receive = true;
+    return s_endpoint;
+  }
+  bool can_receive() const noexcept override { return m_can_receive; }
+  void register_callback(std::function<void(Response&)> /* callback */) override {}
+  void unregister_callback() override {}
+
+  Response call_receive_() { return receive_(s_no_block, false); }
+
+protected:
+  Response receive_(const duration_t& /* timeout */, bool /* no_tmoexcept_mode */) override
+  {
+    auto output = make_response_(m_message_size);
+    output.data.resize(m_message_size);
+    if constexpr (LogSites) {
+      TLOG_DEBUG(15) << "Endpoint " << s_endpoint << ": Returning output with metadata size "
+                     << output.metadata.size() << " and data size " << output.data.size();
+    }
+    return output;
+  }
+
+private:
+  size_t m_message_size;
+  bool m_can_receive{ false };
+};
+
+double
+ns_per_op(size_t iterations, std::function<void()> const& op)
+{
+  // Warm up caches and branch predictors first
+  for (size_t ii = 0; ii < iterations / 10; ++ii) {
+    op();
+  }
+  auto start_time = std::chrono::steady_clock::now();
+  for (size_t ii = 0; ii < iterations; ++ii) {
+    op();
+  }
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start_time).count() / iterations;
+}
+
+} // namespace ""
+
+int
+main(int argc, char* argv[])
+{
+  size_t iterations = 10000000;
+  size_t message_size = 64;
+  std::string output_file;
+
+  namespace po = boost::program_options;
+  po::options_description desc("Measures the overhead of the IPM Sender and Receiver wrappers using null plugins. "
+                               "Debug log sites are timed at the TRACE levels currently enabled.");
+  desc.add_options()("help,h", "Print this help")(
+    "iterations,n", po::value(&iterations), "Number of operations timed per benchmark")(
+    "size,s", po::value(&message_size), "Message size, in bytes")(
+    "output,o", po::value(&output_file), "File to write the results to as JSON");
+  try {
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+    if (vm.count("help")) {
+      std::cout << desc << std::endl;
+      return 0;
+    }
+  } catch (std::exception& ex) {
+    std::cerr << "Error parsing command line " << ex.what() << std::endl;
+    std::cerr << desc << std::endl;
+    return 0;
+  }
+
+  NullSender<false> sender;
+  NullSender<true> logging_sender;
+  NullReceiver<false> receiver(message_size);
+  NullReceiver<true> logging_receiver(message_size);
+  sender.connect_for_sends({});
+  logging_sender.connect_for_sends({});
+  receiver.connect_for_receives({});
+  logging_receiver.connect_for_receives({});
+
+  std::vector<char> message(message_size, 'A');
+  std::atomic<uint64_t> counter{ 0 };
+  LatencyHistogram histogram;
+  std::vector<std::pair<std::string, std::function<void()>>> benchmarks{
+    { "send_ (direct)", [&] { sender.call_send_(message.data(), message.size()); } },
+    { "Sender::send", [&] { sender.send(message.data(), message.size(), Sender::s_no_block); } },
+    { "Sender::send, debug log sites",
+      [&] { logging_sender.send(message.data(), message.size(), Sender::s_no_block); } },
+    { "receive_ (direct)", [&] { receiver.release(receiver.call_receive_()); } },
+    { "Receiver::receive", [&] { receiver.release(receiver.receive(Receiver::s_no_block)); } },
+    { "Receiver::receive, debug log sites",
+      [&] { logging_receiver.release(logging_receiver.receive(Receiver::s_no_block)); } },
+    { "atomic counter increment", [&] { ++counter; } },
+    { "steady_clock::now", [&] { counter.store(std::chrono::steady_clock::now().time_since_epoch().count()); } },
+    { "LatencyHistogram::record", [&] { histogram.record_ns(++counter); } },
+    { "TLOG_DEBUG site", [&] { TLOG_DEBUG(10) << "Endpoint " << s_endpoint << ": " << ++counter << " bytes"; } },
+  };
+
+  nlohmann::json result;
+  result["benchmark"] = "ipm_wrapper_bench";
+  result["iterations"] = iterations;
+  result["message_size"] = message_size;
+  for (auto& [name, op] : benchmarks) {
+    auto ns = ns_per_op(iterations, op);
+    result["ns_per_op"][name] = ns;
+    std::cout << std::left << std::setw(40) << name << std::right << std::setw(10) << std::fixed
+              << std::setprecision(1) << ns << " ns/op" << std::endl;
+  }
+  if (!output_file.empty()) {
+    std::ofstream(output_file) << result.dump(2) << std::endl;
+  }
+  return 0;
+}
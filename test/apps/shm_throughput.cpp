@@ -0,0 +1,94 @@
+/**
+ * @file shm_throughput.cpp Compare the throughput of the shared-memory transport with ZMQ over ipc://
+ *
+ * For each transport, a sender thread pushes a fixed number of messages as fast as it can to a receiver in the same
+ * process, and the achieved message rate and bandwidth are reported.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "ipm/Receiver.hpp"
+#include "ipm/Sender.hpp"
+
+#include "boost/program_options.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace dunedaq::ipm;
+
+namespace {
+
+void
+measure(std::string const& sender_plugin,
+        std::string const& receiver_plugin,
+        std::string const& connection_string,
+        int message_size,
+        int nmessages)
+{
+  std::shared_ptr<Receiver> receiver = make_ipm_receiver(receiver_plugin);
+  receiver->connect_for_receives({ { "connection_string", connection_string } });
+  std::shared_ptr<Sender> sender = make_ipm_sender(sender_plugin);
+  sender->connect_for_sends({ { "connection_string", connection_string } });
+
+  std::vector<char> message(message_size, 'A');
+  auto start_time = std::chrono::steady_clock::now();
+  std::thread sender_thread([&]() {
+    for (int ii = 0; ii < nmessages; ++ii) {
+      sender->send(message.data(), message.size(), Sender::s_block);
+    }
+  });
+
+  std::vector<Receiver::Response> responses;
+  int received = 0;
+  try {
+    while (received < nmessages) {
+      received += receiver->receive_many(responses, 64, std::chrono::milliseconds(5000));
+    }
+  } catch (ReceiveTimeoutExpired const& exc) {
+    std::cout << connection_string << ": gave up waiting after " << received << " messages\n";
+  }
+  auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+  sender_thread.join();
+
+  std::cout << connection_string << ": " << received << " messages of " << message_size << " bytes in " << seconds
+            << " s, " << received / seconds / 1e6 << " Mmsg/s, "
+            << static_cast<double>(received) * message_size / seconds / 1e9 << " GB/s" << std::endl;
+}
+
+} // namespace ""
+
+int
+main(int argc, char* argv[])
+{
+  int message_size = 1024 * 1024;
+  int nmessages = 10000;
+  std::string shm_name = "shm://shm_throughput";
+  std::string ipc_name = "ipc:///tmp/ipm_shm_throughput";
+
+  namespace po = boost::program_options;
+  po::options_description desc("Compares ShmSender/ShmReceiver throughput with ZmqSender/ZmqReceiver over ipc://");
+  desc.add_options()("size,s", po::value<int>(&message_size), "Message size, in bytes")(
+    "messages,n", po::value<int>(&nmessages), "Number of messages to send")(
+    "shm", po::value<std::string>(&shm_name), "shm:// connection string to use")(
+    "ipc", po::value<std::string>(&ipc_name), "ipc:// connection string to use");
+  try {
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+  } catch (std::exception& ex) {
+    std::cerr << "Error parsing command line " << ex.what() << std::endl;
+    std::cerr << desc << std::endl;
+    return 0;
+  }
+
+  measure("ShmSender", "ShmReceiver", shm_name, message_size, nmessages);
+  measure("ZmqSender", "ZmqReceiver", ipc_name, message_size, nmessages);
+  return 0;
+}
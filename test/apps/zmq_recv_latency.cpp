@@ -0,0 +1,118 @@
+/**
+ * @file zmq_recv_latency.cpp Measure how quickly a timed receive wakes up when a message arrives
+ *
+ * A sender thread emits timestamped messages with idle gaps in between, so that the receiver is always waiting on an
+ * empty queue when the next message arrives. The delay between the send and the return from receive() is reported.
+ *
+ * With --baseline the receiver instead polls with non-blocking receives and a fixed sleep between them, as
+ * ZmqReceiver did before it waited for POLLIN, so that the two can be compared on the same machine.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "ipm/Receiver.hpp"
+#include "ipm/Sender.hpp"
+
+#include "boost/program_options.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace dunedaq::ipm;
+
+int
+main(int argc, char* argv[])
+{
+  std::string conString = "inproc://recv_latency";
+  int nmessages = 1000;
+  int interval_us = 2000;
+  int timeout_ms = 1000;
+  bool baseline = false;
+  int retry_period_us = 1000;
+
+  namespace po = boost::program_options;
+  po::options_description desc("Measures the wake-up latency of ZmqReceiver timed receives");
+  desc.add_options()("connection,c", po::value<std::string>(&conString), "Connection to use")(
+    "messages,n", po::value<int>(&nmessages), "Number of messages to send")(
+    "interval,i", po::value<int>(&interval_us), "Idle time between messages, in microseconds")(
+    "timeout,o", po::value<int>(&timeout_ms), "Receive timeout, in milliseconds")(
+    "baseline,b", po::bool_switch(&baseline), "Use the old sleep-and-retry receive loop instead of timed receives")(
+    "retry-period,r", po::value<int>(&retry_period_us), "Sleep between baseline receive attempts, in microseconds");
+  try {
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+  } catch (std::exception& ex) {
+    std::cerr << "Error parsing command line " << ex.what() << std::endl;
+    std::cerr << desc << std::endl;
+    return 0;
+  }
+
+  std::shared_ptr<Receiver> receiver = make_ipm_receiver("ZmqReceiver");
+  receiver->connect_for_receives({ { "connection_string", conString } });
+  std::shared_ptr<Sender> sender = make_ipm_sender("ZmqSender");
+  sender->connect_for_sends({ { "connection_string", conString } });
+
+  std::thread sender_thread([&]() {
+    for (int ii = 0; ii < nmessages; ++ii) {
+      std::this_thread::sleep_for(std::chrono::microseconds(interval_us));
+      auto sent = std::chrono::steady_clock::now().time_since_epoch().count();
+      sender->send(&sent, sizeof(sent), Sender::s_block);
+    }
+  });
+
+  // The loop ZmqReceiver used before waiting for POLLIN: try a non-blocking receive, sleep a fixed period if nothing
+  // was queued, and give up once the timeout has passed
+  auto baseline_receive = [&]() {
+    auto start_time = std::chrono::steady_clock::now();
+    do {
+      // Any size is accepted here since an empty response (nothing queued) would fail the size check
+      auto response = receiver->receive(Receiver::s_no_block, Receiver::s_any_size, true);
+      if (response.data.size() == sizeof(std::chrono::nanoseconds::rep)) {
+        return response;
+      }
+      std::this_thread::sleep_for(std::chrono::microseconds(retry_period_us));
+    } while (std::chrono::steady_clock::now() - start_time < std::chrono::milliseconds(timeout_ms));
+    throw ReceiveTimeoutExpired(ERS_HERE, timeout_ms);
+  };
+
+  std::vector<double> latencies_us;
+  latencies_us.reserve(nmessages);
+  try {
+    for (int ii = 0; ii < nmessages; ++ii) {
+      auto response = baseline ? baseline_receive()
+                               : receiver->receive(std::chrono::milliseconds(timeout_ms),
+                                                   sizeof(std::chrono::nanoseconds::rep));
+      auto received = std::chrono::steady_clock::now().time_since_epoch().count();
+      std::chrono::nanoseconds::rep sent;
+      memcpy(&sent, response.data.data(), sizeof(sent));
+      latencies_us.push_back(static_cast<double>(received - sent) / 1000.);
+    }
+  } catch (ReceiveTimeoutExpired const& exc) {
+    std::cout << "Gave up waiting after " << latencies_us.size() << " messages\n";
+  }
+  sender_thread.join();
+
+  if (latencies_us.empty()) {
+    return 1;
+  }
+
+  std::sort(latencies_us.begin(), latencies_us.end());
+  double sum = 0;
+  for (auto& latency : latencies_us) {
+    sum += latency;
+  }
+  std::cout << (baseline ? "Sleep-and-retry baseline" : "Timed receives") << ": received " << latencies_us.size()
+            << " messages. Wake-up latency (us): mean "
+            << sum / latencies_us.size() << ", median " << latencies_us[latencies_us.size() / 2] << ", p99 "
+            << latencies_us[latencies_us.size() * 99 / 100] << ", max " << latencies_us.back() << std::endl;
+  return 0;
+}
@@ -0,0 +1,109 @@
+/**
+ * @file BufferPool_test.cxx BufferPool class Unit Tests
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "ipm/BufferPool.hpp"
+
+#define BOOST_TEST_MODULE BufferPool_test // NOLINT
+
+#include "boost/test/unit_test.hpp"
+
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace dunedaq::ipm;
+
+BOOST_AUTO_TEST_SUITE(BufferPool_test)
+
+BOOST_AUTO_TEST_CASE(HitsAndMisses)
+{
+  BufferPool pool;
+  auto buffer = pool.acquire(1000);
+  BOOST_REQUIRE(buffer.empty());
+  BOOST_REQUIRE_EQUAL(buffer.capacity(), 1024);
+  BOOST_REQUIRE_EQUAL(pool.take_misses(), 1);
+  BOOST_REQUIRE_EQUAL(pool.take_hits(), 0);
+
+  buffer.resize(1000);
+  auto data = buffer.data();
+  pool.release(std::move(buffer));
+  BOOST_REQUIRE_EQUAL(pool.bytes_held(), 1024);
+
+  // Any size in the same class gets the same buffer back, emptied
+  auto reused = pool.acquire(600);
+  BOOST_REQUIRE_EQUAL(reused.data(), data);
+  BOOST_REQUIRE(reused.empty());
+  BOOST_REQUIRE_EQUAL(pool.take_hits(), 1);
+  BOOST_REQUIRE_EQUAL(pool.take_misses(), 0);
+  BOOST_REQUIRE_EQUAL(pool.bytes_held(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(SizeClasses)
+{
+  BufferPool pool;
+  pool.release(pool.acquire(1024));
+  pool.take_misses();
+
+  // A larger request cannot use the pooled 1 KiB buffer
+  auto larger = pool.acquire(1025);
+  BOOST_REQUIRE_GE(larger.capacity(), 1025);
+  BOOST_REQUIRE_EQUAL(pool.take_misses(), 1);
+  BOOST_REQUIRE_EQUAL(pool.bytes_held(), 1024);
+
+  // A buffer which does not fill its class is filed under the class below
+  std::vector<char> odd;
+  odd.reserve(3000);
+  pool.release(std::move(odd));
+  auto reused = pool.acquire(2048);
+  BOOST_REQUIRE_GE(reused.capacity(), 3000);
+  BOOST_REQUIRE_EQUAL(pool.take_hits(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(Limits)
+{
+  BufferPool pool(4096);
+
+  // Small buffers are not worth keeping
+  std::vector<char> tiny;
+  tiny.reserve(16);
+  pool.release(std::move(tiny));
+  BOOST_REQUIRE_EQUAL(pool.bytes_held(), 0);
+
+  pool.release(pool.acquire(4096));
+  BOOST_REQUIRE_EQUAL(pool.bytes_held(), 4096);
+
+  // The pool is full, so this one is freed
+  pool.release(pool.acquire(256));
+  BOOST_REQUIRE_EQUAL(pool.bytes_held(), 4096);
+}
+
+BOOST_AUTO_TEST_CASE(MultipleThreads)
+{
+  BufferPool pool;
+  const int n_threads = 4;
+  const int n_iterations = 10000;
+
+  std::vector<std::thread> threads;
+  for (int tt = 0; tt < n_threads; ++tt) {
+    threads.emplace_back([&, tt] {
+      for (int ii = 0; ii < n_iterations; ++ii) {
+        auto buffer = pool.acquire(256 << (tt + ii % 3));
+        buffer.resize(100, 'x');
+        pool.release(std::move(buffer));
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  BOOST_REQUIRE_EQUAL(pool.take_hits() + pool.take_misses(), n_threads * n_iterations);
+  BOOST_REQUIRE_LE(pool.bytes_held(), BufferPool::s_default_max_bytes_held);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
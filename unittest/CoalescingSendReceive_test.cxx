@@ -0,0 +1,311 @@
+/**
+ * @file CoalescingSendReceive_test.cxx Test CoalescingSender to CoalescingReceiver transfer
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "CoalescedBatch.hpp"
+#include "ipm/PluginInfo.hpp"
+#include "ipm/Receiver.hpp"
+#include "ipm/Sender.hpp"
+#include "ipm/Subscriber.hpp"
+
+#define BOOST_TEST_MODULE CoalescingSendReceive_test // NOLINT
+
+#include "boost/test/unit_test.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace dunedaq::ipm;
+
+BOOST_AUTO_TEST_SUITE(CoalescingSendReceive_test)
+
+BOOST_AUTO_TEST_CASE(BatchFrame)
+{
+  CoalescedBatch batch;
+  BOOST_REQUIRE(batch.empty());
+  std::vector<std::pair<const char*, size_t>> messages;
+  BOOST_REQUIRE(CoalescedBatch::unpack(batch.data(), batch.bytes(), messages));
+  BOOST_REQUIRE(messages.empty());
+
+  std::string first = "first";
+  std::string second = "second message";
+  batch.append(first.data(), first.size());
+  auto bytes = batch.bytes();
+  batch.append(second.data(), second.size());
+  batch.append(nullptr, 0);
+  BOOST_REQUIRE_EQUAL(batch.count(), 3);
+  BOOST_REQUIRE(CoalescedBatch::unpack(batch.data(), batch.bytes(), messages));
+  BOOST_REQUIRE_EQUAL(messages.size(), 3);
+  BOOST_REQUIRE_EQUAL(std::string(messages[0].first, messages[0].second), first);
+  BOOST_REQUIRE_EQUAL(std::string(messages[1].first, messages[1].second), second);
+  BOOST_REQUIRE_EQUAL(messages[2].second, 0);
+
+  // A truncated or padded frame, or one without the magic number, is not a batch
+  BOOST_REQUIRE(!CoalescedBatch::unpack(batch.data(), batch.bytes() - 1, messages));
+  BOOST_REQUIRE(messages.empty());
+  std::vector<char> padded(batch.data(), batch.data() + batch.bytes());
+  padded.push_back(0);
+  BOOST_REQUIRE(!CoalescedBatch::unpack(padded.data(), padded.size(), messages));
+  std::string plain = "TEST MESSAGE";
+  BOOST_REQUIRE(!CoalescedBatch::unpack(plain.data(), plain.size(), messages));
+
+  batch.truncate(bytes, 1);
+  BOOST_REQUIRE(CoalescedBatch::unpack(batch.data(), batch.bytes(), messages));
+  BOOST_REQUIRE_EQUAL(messages.size(), 1);
+  BOOST_REQUIRE_EQUAL(std::string(messages[0].first, messages[0].second), first);
+
+  batch.clear();
+  BOOST_REQUIRE(batch.empty());
+  BOOST_REQUIRE_EQUAL(batch.bytes(), CoalescedBatch::s_header_size);
+}
+
+BOOST_AUTO_TEST_CASE(ManySmallMessages)
+{
+  auto the_receiver = make_ipm_receiver(CoalescingPluginNames.at(IpmPluginType::Receiver));
+  auto the_sender = make_ipm_sender(CoalescingPluginNames.at(IpmPluginType::Sender));
+  BOOST_REQUIRE(!the_receiver->can_receive());
+  BOOST_REQUIRE(!the_sender->can_send());
+
+  nlohmann::json config_json = { { "connection_string", "inproc://coalescing_many" },
+                                 { "inner_plugin", "InprocSender" },
+                                 { "coalesce_max_messages", 10 },
+                                 { "coalesce_max_delay_us", 1000000 } };
+  the_sender->connect_for_sends(config_json);
+  config_json["inner_plugin"] = "InprocReceiver";
+  the_receiver->connect_for_receives(config_json);
+  BOOST_REQUIRE(the_receiver->can_receive());
+  BOOST_REQUIRE(the_sender->can_send());
+
+  const int message_count = 100;
+  for (int ii = 0; ii < message_count; ++ii) {
+    auto message = std::to_string(ii);
+    BOOST_REQUIRE(the_sender->send(message.data(), message.size(), Sender::s_block, "meta"));
+  }
+  for (int ii = 0; ii < message_count; ++ii) {
+    auto response = the_receiver->receive(std::chrono::milliseconds(1000));
+    BOOST_REQUIRE_EQUAL(std::string(response.data.begin(), response.data.end()), std::to_string(ii));
+    BOOST_REQUIRE_EQUAL(response.metadata, "meta");
+  }
+  BOOST_REQUIRE_EXCEPTION(the_receiver->receive(std::chrono::milliseconds(10)),
+                          ReceiveTimeoutExpired,
+                          [&](ReceiveTimeoutExpired) { return true; });
+}
+
+BOOST_AUTO_TEST_CASE(DeadlineAndMetadataFlushes)
+{
+  auto the_receiver = make_ipm_receiver("CoalescingReceiver");
+  auto the_sender = make_ipm_sender("CoalescingSender");
+  nlohmann::json config_json = { { "connection_string", "tcp://127.0.0.1:*" }, { "coalesce_max_delay_us", 1000 } };
+  config_json["connection_string"] = the_receiver->connect_for_receives(config_json);
+  the_sender->connect_for_sends(config_json);
+
+  // A lone message goes out once its deadline passes
+  std::string message = "TEST";
+  BOOST_REQUIRE(the_sender->send(message.data(), message.size(), Sender::s_block, "first"));
+  auto response = the_receiver->receive(std::chrono::milliseconds(5000));
+  BOOST_REQUIRE_EQUAL(std::string(response.data.begin(), response.data.end()), message);
+  BOOST_REQUIRE_EQUAL(response.metadata, "first");
+
+  // Each message keeps its own metadata
+  BOOST_REQUIRE(the_sender->send(message.data(), message.size(), Sender::s_block, "first"));
+  BOOST_REQUIRE(the_sender->send(message.data(), message.size(), Sender::s_block, "second"));
+  BOOST_REQUIRE(the_sender->send(message.data(), message.size(), Sender::s_block, "second"));
+  BOOST_REQUIRE_EQUAL(the_receiver->receive(std::chrono::milliseconds(5000)).metadata, "first");
+  BOOST_REQUIRE_EQUAL(the_receiver->receive(std::chrono::milliseconds(5000)).metadata, "second");
+  BOOST_REQUIRE_EQUAL(the_receiver->receive(std::chrono::milliseconds(5000)).metadata, "second");
+
+  // Messages which were not coalesced pass through unchanged
+  auto plain_sender = make_ipm_sender("ZmqSender");
+  plain_sender->connect_for_sends(config_json);
+  BOOST_REQUIRE(plain_sender->send(message.data(), message.size(), Sender::s_block, "plain"));
+  response = the_receiver->receive(std::chrono::milliseconds(5000));
+  BOOST_REQUIRE_EQUAL(std::string(response.data.begin(), response.data.end()), message);
+  BOOST_REQUIRE_EQUAL(response.metadata, "plain");
+}
+
+BOOST_AUTO_TEST_CASE(Subscriptions)
+{
+  auto the_subscriber = make_ipm_subscriber("CoalescingReceiver");
+  auto the_sender = make_ipm_sender("CoalescingSender");
+  the_subscriber->subscribe("wanted");
+  nlohmann::json config_json = { { "connection_string", "inproc://coalescing_subscriptions" },
+                                 { "inner_plugin", "ZmqSubscriber" },
+                                 { "coalesce_max_delay_us", 1000 } };
+  the_subscriber->connect_for_receives(config_json);
+  config_json["inner_plugin"] = "ZmqPublisher";
+  the_sender->connect_for_sends(config_json);
+  std::this_thread::sleep_for(std::chrono::milliseconds(100)); // Let the subscription reach the publisher
+
+  std::string message = "TEST";
+  BOOST_REQUIRE(the_sender->send(message.data(), message.size(), Sender::s_block, "unwanted"));
+  BOOST_REQUIRE(the_sender->send(message.data(), message.size(), Sender::s_block, "wanted"));
+  BOOST_REQUIRE(the_sender->send(message.data(), message.size(), Sender::s_block, "unwanted"));
+  BOOST_REQUIRE_EQUAL(the_subscriber->receive(std::chrono::milliseconds(5000)).metadata, "wanted");
+  BOOST_REQUIRE_EXCEPTION(the_subscriber->receive(std::chrono::milliseconds(100)),
+                          ReceiveTimeoutExpired,
+                          [&](ReceiveTimeoutExpired) { return true; });
+
+  // Subscriptions need an inner Subscriber
+  auto not_subscriber = make_ipm_subscriber("CoalescingReceiver");
+  not_subscriber->connect_for_receives({ { "connection_string", "inproc://coalescing_not_subscriber" },
+                                         { "inner_plugin", "InprocReceiver" } });
+  BOOST_REQUIRE_EXCEPTION(
+    not_subscriber->subscribe("wanted"), dunedaq::ipm::CoalescingError, [&](dunedaq::ipm::CoalescingError) {
+      return true;
+    });
+}
+
+BOOST_AUTO_TEST_CASE(BackPressure)
+{
+  // Nothing reads the inner queue, which holds two batches, so once the flusher thread is stuck on a third and the
+  // batch being filled is full too, sends stop being accepted instead of batches being dropped
+  auto the_receiver = make_ipm_receiver("CoalescingReceiver");
+  auto the_sender = make_ipm_sender("CoalescingSender");
+  nlohmann::json config_json = { { "connection_string", "inproc://coalescing_back_pressure" },
+                                 { "inner_plugin", "InprocReceiver" },
+                                 { "queue_capacity", 2 },
+                                 { "coalesce_max_messages", 1 },
+                                 { "coalesce_flush_timeout_ms", 10 } };
+  the_receiver->connect_for_receives(config_json);
+  config_json["inner_plugin"] = "InprocSender";
+  the_sender->connect_for_sends(config_json);
+
+  int accepted = 0;
+  for (; accepted < 100; ++accepted) {
+    auto message = std::to_string(accepted);
+    if (!the_sender->send(message.data(), message.size(), Sender::s_no_block, "", true)) {
+      break;
+    }
+  }
+  BOOST_REQUIRE_LT(accepted, 100);
+  BOOST_REQUIRE_EXCEPTION(the_sender->send("TEST", 4, std::chrono::milliseconds(10)),
+                          SendTimeoutExpired,
+                          [&](SendTimeoutExpired) { return true; });
+
+  // Every accepted message arrives, in order
+  for (int ii = 0; ii < accepted; ++ii) {
+    auto response = the_receiver->receive(std::chrono::milliseconds(5000));
+    BOOST_REQUIRE_EQUAL(std::string(response.data.begin(), response.data.end()), std::to_string(ii));
+  }
+  BOOST_REQUIRE_EXCEPTION(the_receiver->receive(std::chrono::milliseconds(50)),
+                          ReceiveTimeoutExpired,
+                          [&](ReceiveTimeoutExpired) { return true; });
+}
+
+BOOST_AUTO_TEST_CASE(EmptyBatch)
+{
+  auto the_receiver = make_ipm_receiver("CoalescingReceiver");
+  auto plain_sender = make_ipm_sender("InprocSender");
+  nlohmann::json config_json = { { "connection_string", "inproc://coalescing_empty_batch" },
+                                 { "inner_plugin", "InprocReceiver" } };
+  the_receiver->connect_for_receives(config_json);
+  plain_sender->connect_for_sends(config_json);
+
+  // A batch without messages is not a message: the receive goes on waiting for the rest of its timeout
+  CoalescedBatch empty_batch;
+  auto batch_metadata = CoalescedBatch::batch_metadata("");
+  BOOST_REQUIRE(plain_sender->send(empty_batch.data(), empty_batch.bytes(), Sender::s_block, batch_metadata));
+  BOOST_REQUIRE_EXCEPTION(the_receiver->receive(std::chrono::milliseconds(50)),
+                          ReceiveTimeoutExpired,
+                          [&](ReceiveTimeoutExpired) { return true; });
+  BOOST_REQUIRE(the_receiver->receive(std::chrono::milliseconds(10), Receiver::s_any_size, true).data.empty());
+
+  std::string message = "TEST";
+  BOOST_REQUIRE(plain_sender->send(empty_batch.data(), empty_batch.bytes(), Sender::s_block, batch_metadata));
+  BOOST_REQUIRE(plain_sender->send(message.data(), message.size(), Sender::s_block));
+  auto response = the_receiver->receive(Receiver::s_block);
+  BOOST_REQUIRE_EQUAL(std::string(response.data.begin(), response.data.end()), message);
+}
+
+BOOST_AUTO_TEST_CASE(BatchLikePayload)
+{
+  auto the_receiver = make_ipm_receiver("CoalescingReceiver");
+  auto plain_sender = make_ipm_sender("InprocSender");
+  nlohmann::json config_json = { { "connection_string", "inproc://coalescing_batch_like" },
+                                 { "inner_plugin", "InprocReceiver" } };
+  the_receiver->connect_for_receives(config_json);
+  plain_sender->connect_for_sends(config_json);
+
+  // Only the metadata marks a batch, so a payload which happens to be a well-formed frame is passed through whole
+  CoalescedBatch frame;
+  frame.append("A", 1);
+  frame.append("B", 1);
+  BOOST_REQUIRE(plain_sender->send(frame.data(), frame.bytes(), Sender::s_block, "plain"));
+  auto response = the_receiver->receive(std::chrono::milliseconds(1000));
+  BOOST_REQUIRE_EQUAL(response.data.size(), frame.bytes());
+  BOOST_REQUIRE_EQUAL(response.metadata, "plain");
+
+  // and a malformed batch is dropped
+  std::string message = "TEST";
+  BOOST_REQUIRE(
+    plain_sender->send(message.data(), message.size(), Sender::s_block, CoalescedBatch::batch_metadata("plain")));
+  BOOST_REQUIRE(the_receiver->receive(std::chrono::milliseconds(50), Receiver::s_any_size, true).data.empty());
+
+  // The suffix is reserved
+  auto the_sender = make_ipm_sender("CoalescingSender");
+  config_json["inner_plugin"] = "InprocSender";
+  the_sender->connect_for_sends(config_json);
+  BOOST_REQUIRE_EXCEPTION(
+    the_sender->send(message.data(), message.size(), Sender::s_block, CoalescedBatch::batch_metadata("plain")),
+    dunedaq::ipm::CoalescingError,
+    [&](dunedaq::ipm::CoalescingError) { return true; });
+}
+
+BOOST_AUTO_TEST_CASE(ReceiveWhileWaiting)
+{
+  auto the_receiver = make_ipm_receiver("CoalescingReceiver");
+  the_receiver->connect_for_receives(
+    { { "connection_string", "inproc://coalescing_receive_while_waiting" }, { "inner_plugin", "InprocReceiver" } });
+
+  // A receive waiting on the inner receiver does not hold up one from another thread
+  std::thread waiter([&]() { the_receiver->receive(std::chrono::milliseconds(1000), Receiver::s_any_size, true); });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  auto start_time = std::chrono::steady_clock::now();
+  BOOST_REQUIRE(the_receiver->receive_view(Receiver::s_no_block, Receiver::s_any_size, true).empty());
+  BOOST_REQUIRE(std::chrono::steady_clock::now() - start_time < std::chrono::milliseconds(500));
+  waiter.join();
+}
+
+BOOST_AUTO_TEST_CASE(CallbackTest)
+{
+  auto the_receiver = make_ipm_receiver("CoalescingReceiver");
+  auto the_sender = make_ipm_sender("CoalescingSender");
+  nlohmann::json config_json = { { "connection_string", "inproc://coalescing_callback" },
+                                 { "inner_plugin", "InprocReceiver" },
+                                 { "coalesce_max_delay_us", 1000 } };
+  the_receiver->connect_for_receives(config_json);
+  config_json["inner_plugin"] = "InprocSender";
+  the_sender->connect_for_sends(config_json);
+
+  const int message_count = 50;
+  std::atomic<int> received{ 0 };
+  std::atomic<bool> in_order{ true };
+  the_receiver->register_callback([&](Receiver::Response& response) {
+    if (std::string(response.data.begin(), response.data.end()) != std::to_string(received.load())) {
+      in_order = false;
+    }
+    ++received;
+  });
+  for (int ii = 0; ii < message_count; ++ii) {
+    auto message = std::to_string(ii);
+    BOOST_REQUIRE(the_sender->send(message.data(), message.size(), Sender::s_block));
+  }
+  auto start = std::chrono::steady_clock::now();
+  while (received < message_count && std::chrono::steady_clock::now() - start < std::chrono::seconds(5)) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  the_receiver->unregister_callback();
+  BOOST_REQUIRE_EQUAL(received.load(), message_count);
+  BOOST_REQUIRE(in_order);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
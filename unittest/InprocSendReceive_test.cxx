@@ -0,0 +1,198 @@
+/**
+ * @file InprocSendReceive_test.cxx Test InprocSender to InprocReceiver transfer
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "InprocChannel.hpp"
+#include "ipm/PluginInfo.hpp"
+#include "ipm/Receiver.hpp"
+#include "ipm/Sender.hpp"
+
+#define BOOST_TEST_MODULE InprocSendReceive_test // NOLINT
+
+#include "boost/test/unit_test.hpp"
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace dunedaq::ipm;
+
+BOOST_AUTO_TEST_SUITE(InprocSendReceive_test)
+
+BOOST_AUTO_TEST_CASE(SendReceiveTest)
+{
+  auto the_receiver = make_ipm_receiver(InprocPluginNames.at(IpmPluginType::Receiver));
+  BOOST_REQUIRE(the_receiver != nullptr);
+  BOOST_REQUIRE(!the_receiver->can_receive());
+
+  auto the_sender = make_ipm_sender(InprocPluginNames.at(IpmPluginType::Sender));
+  BOOST_REQUIRE(the_sender != nullptr);
+  BOOST_REQUIRE(!the_sender->can_send());
+
+  nlohmann::json config_json;
+  config_json["connection_string"] = "inproc://sendreceive";
+  the_receiver->connect_for_receives(config_json);
+  the_sender->connect_for_sends(config_json);
+
+  BOOST_REQUIRE(the_receiver->can_receive());
+  BOOST_REQUIRE(the_sender->can_send());
+
+  BOOST_REQUIRE_EXCEPTION(the_receiver->receive(std::chrono::milliseconds(10)),
+                          dunedaq::ipm::ReceiveTimeoutExpired,
+                          [&](dunedaq::ipm::ReceiveTimeoutExpired) { return true; });
+
+  std::vector<char> test_data{ 'T', 'E', 'S', 'T' };
+  BOOST_REQUIRE(the_sender->send(test_data.data(), test_data.size(), Sender::s_no_block, "meta"));
+  auto response = the_receiver->receive(Receiver::s_block);
+  BOOST_REQUIRE_EQUAL(std::string(response.data.begin(), response.data.end()), "TEST");
+  BOOST_REQUIRE_EQUAL(response.metadata, "meta");
+}
+
+BOOST_AUTO_TEST_CASE(OwnershipTransferTest)
+{
+  nlohmann::json config_json;
+  config_json["connection_string"] = "inproc://ownership";
+  auto the_receiver = make_ipm_receiver("InprocReceiver");
+  the_receiver->connect_for_receives(config_json);
+  auto the_sender = make_ipm_sender("InprocSender");
+  the_sender->connect_for_sends(config_json);
+
+  bool released = false;
+  auto raw = new char[4]{ 'T', 'E', 'S', 'T' };
+  Sender::owned_buffer_t buffer(raw, [&](char* ptr) {
+    released = true;
+    delete[] ptr; // NOLINT
+  });
+  BOOST_REQUIRE(the_sender->send(std::move(buffer), 4, Sender::s_no_block));
+  BOOST_REQUIRE(!released);
+
+  // The receiver sees the very buffer that was sent, and releases it with the view
+  {
+    auto view = the_receiver->receive_view(Receiver::s_block);
+    BOOST_REQUIRE(view.data() == raw);
+    BOOST_REQUIRE_EQUAL(view.size(), 4);
+  }
+  BOOST_REQUIRE(released);
+}
+
+// Needs several GiB of memory, so it only runs when asked for:
+//   InprocSendReceive_test --run_test=InprocSendReceive_test/LargeMessageTest
+// Sender_test covers the handling of sizes bigger than INT_MAX in the default run.
+BOOST_AUTO_TEST_CASE(LargeMessageTest, *boost::unit_test::disabled())
+{
+  nlohmann::json config_json;
+  config_json["connection_string"] = "inproc://large";
+  auto the_receiver = make_ipm_receiver("InprocReceiver");
+  auto the_sender = make_ipm_sender("InprocSender");
+  the_receiver->connect_for_receives(config_json);
+  the_sender->connect_for_sends(config_json);
+
+  // Bigger than INT_MAX. The buffer is left uninitialized apart from a few markers, so that only the pages which are
+  // written to (and the received copy) take up memory.
+  const Sender::message_size_t large_size = (size_t(1) << 31) + 16;
+  auto mark = [&](char* data) {
+    data[0] = 'F';
+    data[size_t(1) << 31] = 'M';
+    data[large_size - 1] = 'L';
+  };
+  auto check = [&](const char* data) {
+    BOOST_REQUIRE_EQUAL(data[0], 'F');
+    BOOST_REQUIRE_EQUAL(data[size_t(1) << 31], 'M');
+    BOOST_REQUIRE_EQUAL(data[large_size - 1], 'L');
+  };
+
+  {
+    std::unique_ptr<char[]> buffer(new char[large_size]); // NOLINT
+    mark(buffer.get());
+    BOOST_REQUIRE(the_sender->send(buffer.get(), large_size, Sender::s_block));
+  }
+  {
+    auto response = the_receiver->receive(Receiver::s_block, large_size);
+    BOOST_REQUIRE_EQUAL(response.data.size(), large_size);
+    check(response.data.data());
+  }
+
+  Sender::owned_buffer_t buffer(new char[large_size], [](char* ptr) { delete[] ptr; }); // NOLINT
+  mark(buffer.get());
+  BOOST_REQUIRE(the_sender->send(std::move(buffer), large_size, Sender::s_block));
+  auto view = the_receiver->receive_view(Receiver::s_block, large_size);
+  BOOST_REQUIRE_EQUAL(view.size(), large_size);
+  check(view.data());
+}
+
+BOOST_AUTO_TEST_CASE(FullQueueTest)
+{
+  nlohmann::json config_json;
+  config_json["connection_string"] = "inproc://fullqueue";
+  config_json["queue_capacity"] = 4;
+  auto the_sender = make_ipm_sender("InprocSender");
+  the_sender->connect_for_sends(config_json);
+  auto the_receiver = make_ipm_receiver("InprocReceiver");
+  the_receiver->connect_for_receives(config_json);
+
+  std::vector<char> test_data{ 'T', 'E', 'S', 'T' };
+  size_t sent = 0;
+  while (the_sender->send(test_data.data(), test_data.size(), Sender::s_no_block, "", true)) {
+    ++sent;
+  }
+  BOOST_REQUIRE_EQUAL(sent, 4);
+  BOOST_REQUIRE_EXCEPTION(the_sender->send(test_data.data(), test_data.size(), std::chrono::milliseconds(10)),
+                          dunedaq::ipm::SendTimeoutExpired,
+                          [&](dunedaq::ipm::SendTimeoutExpired) { return true; });
+
+  // A blocked sender is woken as soon as the receiver makes room
+  std::thread sender_thread([&]() {
+    for (int ii = 0; ii < 1000; ++ii) {
+      the_sender->send(test_data.data(), test_data.size(), Sender::s_block);
+    }
+  });
+  for (int ii = 0; ii < 1004; ++ii) {
+    auto response = the_receiver->receive(std::chrono::milliseconds(1000));
+    BOOST_REQUIRE_EQUAL(response.data.size(), 4);
+  }
+  sender_thread.join();
+}
+
+BOOST_AUTO_TEST_CASE(BadConnectionString)
+{
+  auto the_sender = make_ipm_sender("InprocSender");
+  BOOST_REQUIRE_EXCEPTION(the_sender->connect_for_sends({ { "connection_string", "tcp://127.0.0.1:1234" } }),
+                          dunedaq::ipm::InprocOperationError,
+                          [&](dunedaq::ipm::InprocOperationError) { return true; });
+  BOOST_REQUIRE(!the_sender->can_send());
+}
+
+BOOST_AUTO_TEST_CASE(CallbackTest)
+{
+  nlohmann::json config_json;
+  config_json["connection_string"] = "inproc://callback";
+  auto the_receiver = make_ipm_receiver("InprocReceiver");
+  the_receiver->connect_for_receives(config_json);
+  auto the_sender = make_ipm_sender("InprocSender");
+  the_sender->connect_for_sends(config_json);
+
+  std::atomic<int> received = 0;
+  the_receiver->register_view_callback([&](Receiver::ResponseView& view) {
+    if (view.size() == 4) {
+      ++received;
+    }
+  });
+
+  std::vector<char> test_data{ 'T', 'E', 'S', 'T' };
+  for (int ii = 0; ii < 10; ++ii) {
+    the_sender->send(test_data.data(), test_data.size(), Sender::s_block);
+  }
+  for (int ii = 0; ii < 1000 && received.load() < 10; ++ii) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  the_receiver->unregister_callback();
+  BOOST_REQUIRE_EQUAL(received.load(), 10);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
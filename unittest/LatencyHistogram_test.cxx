@@ -0,0 +1,94 @@
+/**
+ * @file LatencyHistogram_test.cxx LatencyHistogram class Unit Tests
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "ipm/LatencyHistogram.hpp"
+
+#define BOOST_TEST_MODULE LatencyHistogram_test // NOLINT
+
+#include "boost/test/unit_test.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+using namespace dunedaq::ipm;
+
+BOOST_AUTO_TEST_SUITE(LatencyHistogram_test)
+
+BOOST_AUTO_TEST_CASE(Buckets)
+{
+  // Every value lies in a bucket whose top is no more than 25% above it, and buckets are in increasing order
+  uint64_t previous_upper = 0;
+  for (uint64_t ns = 1; ns < (uint64_t(1) << 40); ns = ns * 3 / 2 + 1) {
+    auto index = LatencyHistogram::bucket_index(ns);
+    BOOST_REQUIRE_LT(index, LatencyHistogram::s_bucket_count);
+    auto upper = LatencyHistogram::bucket_upper_ns(index);
+    BOOST_REQUIRE_GE(upper, ns);
+    BOOST_REQUIRE_LE(upper, ns + ns / 4);
+    BOOST_REQUIRE_GE(upper, previous_upper);
+    previous_upper = upper;
+  }
+  BOOST_REQUIRE_LT(LatencyHistogram::bucket_index(UINT64_MAX), LatencyHistogram::s_bucket_count);
+  BOOST_REQUIRE_EQUAL(LatencyHistogram::bucket_upper_ns(LatencyHistogram::bucket_index(UINT64_MAX)), UINT64_MAX);
+}
+
+BOOST_AUTO_TEST_CASE(Percentiles)
+{
+  LatencyHistogram histogram;
+  auto empty = histogram.take();
+  BOOST_REQUIRE_EQUAL(empty.count, 0);
+  BOOST_REQUIRE_EQUAL(empty.p99_us, 0);
+
+  // 1..1000 microseconds
+  for (int ii = 1; ii <= 1000; ++ii) {
+    histogram.record(std::chrono::microseconds(ii));
+  }
+  auto summary = histogram.take();
+  BOOST_REQUIRE_EQUAL(summary.count, 1000);
+  BOOST_REQUIRE_GE(summary.p50_us, 500);
+  BOOST_REQUIRE_LE(summary.p50_us, 500 * 1.25);
+  BOOST_REQUIRE_GE(summary.p90_us, 900);
+  BOOST_REQUIRE_LE(summary.p90_us, 1000);
+  BOOST_REQUIRE_GE(summary.p99_us, 990);
+  BOOST_REQUIRE_LE(summary.p99_us, 1000);
+  BOOST_REQUIRE_EQUAL(summary.max_us, 1000);
+
+  // take() starts again from empty
+  BOOST_REQUIRE_EQUAL(histogram.take().count, 0);
+
+  histogram.record(std::chrono::nanoseconds(-5));
+  summary = histogram.take();
+  BOOST_REQUIRE_EQUAL(summary.count, 1);
+  BOOST_REQUIRE_EQUAL(summary.max_us, 0);
+}
+
+BOOST_AUTO_TEST_CASE(MultipleThreads)
+{
+  LatencyHistogram histogram;
+  const int n_threads = 4;
+  const int n_records = 100000;
+
+  std::vector<std::thread> threads;
+  for (int tt = 0; tt < n_threads; ++tt) {
+    threads.emplace_back([&, tt] {
+      for (int ii = 0; ii < n_records; ++ii) {
+        histogram.record_ns(static_cast<uint64_t>(tt * n_records + ii));
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  auto summary = histogram.take();
+  BOOST_REQUIRE_EQUAL(summary.count, n_threads * n_records);
+  BOOST_REQUIRE_EQUAL(summary.max_us, (n_threads * n_records - 1) / 1000.);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
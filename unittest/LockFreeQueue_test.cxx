@@ -0,0 +1,95 @@
+/**
+ * @file LockFreeQueue_test.cxx LockFreeQueue class Unit Tests
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "LockFreeQueue.hpp"
+
+#define BOOST_TEST_MODULE LockFreeQueue_test // NOLINT
+
+#include "boost/test/unit_test.hpp"
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace dunedaq::ipm;
+
+BOOST_AUTO_TEST_SUITE(LockFreeQueue_test)
+
+BOOST_AUTO_TEST_CASE(Capacity)
+{
+  LockFreeQueue<int> queue(5);
+  BOOST_REQUIRE_EQUAL(queue.capacity(), 8);
+  BOOST_REQUIRE(queue.empty());
+
+  for (int ii = 0; ii < 8; ++ii) {
+    BOOST_REQUIRE(queue.try_push(int(ii)));
+  }
+  BOOST_REQUIRE_EQUAL(queue.size(), 8);
+
+  int overflow = 100;
+  BOOST_REQUIRE(!queue.try_push(std::move(overflow)));
+
+  int value = -1;
+  for (int ii = 0; ii < 8; ++ii) {
+    BOOST_REQUIRE(queue.try_pop(value));
+    BOOST_REQUIRE_EQUAL(value, ii);
+  }
+  BOOST_REQUIRE(!queue.try_pop(value));
+  BOOST_REQUIRE(queue.empty());
+}
+
+BOOST_AUTO_TEST_CASE(MoveOnly)
+{
+  LockFreeQueue<std::string> queue(2);
+  std::string item(1000, 'A');
+  BOOST_REQUIRE(queue.try_push(std::move(item)));
+
+  std::string popped;
+  BOOST_REQUIRE(queue.try_pop(popped));
+  BOOST_REQUIRE_EQUAL(popped.size(), 1000);
+}
+
+BOOST_AUTO_TEST_CASE(MultipleProducersAndConsumers)
+{
+  const int n_threads = 4;
+  const int n_items = 100000;
+  LockFreeQueue<int> queue(64);
+
+  std::atomic<long> sum = 0;
+  std::atomic<int> popped = 0;
+  std::vector<std::thread> threads;
+  for (int tt = 0; tt < n_threads; ++tt) {
+    threads.emplace_back([&]() {
+      for (int ii = 1; ii <= n_items; ++ii) {
+        while (!queue.try_push(int(ii))) {
+          std::this_thread::yield();
+        }
+      }
+    });
+    threads.emplace_back([&]() {
+      int value;
+      while (popped.load() < n_threads * n_items) {
+        if (queue.try_pop(value)) {
+          sum += value;
+          popped++;
+        } else {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  BOOST_REQUIRE_EQUAL(sum.load(), static_cast<long>(n_threads) * n_items * (n_items + 1) / 2);
+  BOOST_REQUIRE(queue.empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -13,7 +13,17 @@
 
 #include "boost/test/unit_test.hpp"
 
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <set>
+#include <stdexcept>
 #include <string>
+#include <thread>
 #include <vector>
 
 using namespace dunedaq::ipm;
@@ -34,6 +44,10 @@ public:
 
   void register_callback(std::function<void(Response&)> callback) { m_callback_adapter.set_callback(callback); }
   void unregister_callback() { m_callback_adapter.clear_callback(); }
+  void set_dispatch_workers(size_t worker_count, bool preserve_order)
+  {
+    m_callback_adapter.set_dispatch_workers(worker_count, preserve_order);
+  }
 
   std::string connect_for_receives(const nlohmann::json& /* connection_info */)
   {
@@ -42,6 +56,9 @@ public:
     return "";
   }
   bool can_receive() const noexcept override { return m_can_receive; }
+  size_t receive_count() const { return m_receive_count; }
+  // While set, receive_ waits out its timeout (up to a second) and returns nothing
+  void set_empty(bool empty) { m_empty = empty; }
   void sabotage_my_receiving_ability()
   {
     unregister_callback();
@@ -49,16 +66,23 @@ public:
   }
 
 protected:
-  Receiver::Response receive_(const duration_t& /* timeout */, bool /*no_tmoexcept_mode*/) override
+  Receiver::Response receive_(const duration_t& timeout, bool /*no_tmoexcept_mode*/) override
   {
-    Receiver::Response output;
-    output.data = std::vector<char>(s_bytes_on_each_receive, 'A');
+    if (m_empty) {
+      std::this_thread::sleep_for(std::min(timeout, duration_t(1000)));
+      return {};
+    }
+    auto output = make_response_(s_bytes_on_each_receive);
+    output.data.assign(s_bytes_on_each_receive, 'A');
     output.metadata = "";
+    ++m_receive_count;
     return output;
   }
 
 private:
   bool m_can_receive;
+  std::atomic<size_t> m_receive_count{ 0 };
+  std::atomic<bool> m_empty{ false };
   CallbackAdapter m_callback_adapter;
 };
 
@@ -121,4 +145,216 @@ BOOST_AUTO_TEST_CASE(Callback)
   BOOST_REQUIRE_GT(callback_call_count, 0);
 }
 
+BOOST_AUTO_TEST_CASE(CallbackException)
+{
+  ReceiverImpl the_receiver;
+  the_receiver.connect_for_receives({});
+
+  // A throwing callback is reported, and does not stop later messages from being dispatched
+  std::atomic<size_t> callback_call_count = 0;
+  the_receiver.register_callback([&](Receiver::Response&) {
+    if (callback_call_count++ == 0) {
+      throw std::runtime_error("callback failure");
+    }
+  });
+  while (callback_call_count.load() < 2) {
+    usleep(1000);
+  }
+  the_receiver.unregister_callback();
+}
+
+BOOST_AUTO_TEST_CASE(ResponseView)
+{
+  ReceiverImpl the_receiver;
+
+  nlohmann::json j;
+  the_receiver.connect_for_receives(j);
+
+  auto view = the_receiver.receive_view(Receiver::s_no_block);
+  BOOST_REQUIRE(!view.empty());
+  BOOST_REQUIRE_EQUAL(view.size(), static_cast<size_t>(ReceiverImpl::s_bytes_on_each_receive));
+  BOOST_REQUIRE_EQUAL(view.data()[0], 'A');
+  BOOST_REQUIRE_EQUAL(view.metadata(), "");
+
+  BOOST_REQUIRE_EXCEPTION(the_receiver.receive_view(Receiver::s_no_block, ReceiverImpl::s_bytes_on_each_receive - 1),
+                          dunedaq::ipm::UnexpectedNumberOfBytes,
+                          [&](dunedaq::ipm::UnexpectedNumberOfBytes) { return true; });
+
+  std::atomic<size_t> callback_call_count = 0;
+  the_receiver.register_view_callback([&](Receiver::ResponseView& view) {
+    if (view.size() == ReceiverImpl::s_bytes_on_each_receive) {
+      callback_call_count++;
+    }
+  });
+  usleep(10000);
+  the_receiver.unregister_callback();
+
+  BOOST_REQUIRE_GT(callback_call_count, 0);
+}
+
+BOOST_AUTO_TEST_CASE(ReceiveMany)
+{
+  ReceiverImpl the_receiver;
+  std::vector<Receiver::Response> responses;
+
+  BOOST_REQUIRE_EXCEPTION(the_receiver.receive_many(responses, 4, Receiver::s_no_block),
+                          dunedaq::ipm::KnownStateForbidsReceive,
+                          [&](dunedaq::ipm::KnownStateForbidsReceive) { return true; });
+
+  nlohmann::json j;
+  the_receiver.connect_for_receives(j);
+
+  BOOST_REQUIRE_EQUAL(the_receiver.receive_many(responses, 4, Receiver::s_no_block), 4);
+  BOOST_REQUIRE_EQUAL(responses.size(), 4);
+  for (auto& response : responses) {
+    BOOST_REQUIRE_EQUAL(response.data.size(), static_cast<size_t>(ReceiverImpl::s_bytes_on_each_receive));
+  }
+
+  BOOST_REQUIRE_EQUAL(the_receiver.receive_many(responses, 0, Receiver::s_no_block), 0);
+  BOOST_REQUIRE(responses.empty());
+
+  BOOST_REQUIRE_EXCEPTION(
+    the_receiver.receive_many(responses, 2, Receiver::s_no_block, ReceiverImpl::s_bytes_on_each_receive - 1),
+    dunedaq::ipm::UnexpectedNumberOfBytes,
+    [&](dunedaq::ipm::UnexpectedNumberOfBytes) { return true; });
+}
+
+BOOST_AUTO_TEST_CASE(ReceiveInto)
+{
+  ReceiverImpl the_receiver;
+  char buffer[ReceiverImpl::s_bytes_on_each_receive + 1] = {};
+
+  BOOST_REQUIRE_EXCEPTION(the_receiver.receive_into(buffer, sizeof(buffer), Receiver::s_no_block),
+                          dunedaq::ipm::KnownStateForbidsReceive,
+                          [&](dunedaq::ipm::KnownStateForbidsReceive) { return true; });
+
+  the_receiver.connect_for_receives({});
+
+  auto result = the_receiver.receive_into(buffer, sizeof(buffer), Receiver::s_no_block);
+  BOOST_REQUIRE_EQUAL(result.size, static_cast<size_t>(ReceiverImpl::s_bytes_on_each_receive));
+  BOOST_REQUIRE(!result.truncated);
+  BOOST_REQUIRE_EQUAL(std::string(buffer), std::string(ReceiverImpl::s_bytes_on_each_receive, 'A'));
+
+  // Only as much as fits is copied, and the full size is reported
+  std::fill(buffer, buffer + sizeof(buffer), 0);
+  result = the_receiver.receive_into(buffer, 4, Receiver::s_no_block);
+  BOOST_REQUIRE_EQUAL(result.size, static_cast<size_t>(ReceiverImpl::s_bytes_on_each_receive));
+  BOOST_REQUIRE(result.truncated);
+  BOOST_REQUIRE_EQUAL(std::string(buffer), "AAAA");
+
+  BOOST_REQUIRE_EXCEPTION(
+    the_receiver.receive_into(buffer, sizeof(buffer), Receiver::s_no_block, ReceiverImpl::s_bytes_on_each_receive - 1),
+    dunedaq::ipm::UnexpectedNumberOfBytes,
+    [&](dunedaq::ipm::UnexpectedNumberOfBytes) { return true; });
+}
+
+BOOST_AUTO_TEST_CASE(ReleaseReusesBuffer)
+{
+  ReceiverImpl the_receiver;
+  the_receiver.connect_for_receives({});
+
+  auto response = the_receiver.receive(Receiver::s_no_block);
+  auto data = response.data.data();
+  the_receiver.release(std::move(response));
+
+  response = the_receiver.receive(Receiver::s_no_block);
+  BOOST_REQUIRE_EQUAL(response.data.data(), data);
+  BOOST_REQUIRE_EQUAL(response.data.size(), static_cast<size_t>(ReceiverImpl::s_bytes_on_each_receive));
+}
+
+BOOST_AUTO_TEST_CASE(CallbackWorkers)
+{
+  ReceiverImpl the_receiver;
+
+  nlohmann::json j;
+  the_receiver.connect_for_receives(j);
+
+  std::mutex thread_ids_mutex;
+  std::set<std::thread::id> thread_ids;
+  std::atomic<size_t> callback_call_count = 0;
+  auto callback = [&](Receiver::Response& res) {
+    if (res.data.size() == ReceiverImpl::s_bytes_on_each_receive) {
+      callback_call_count++;
+    }
+    std::lock_guard<std::mutex> lk(thread_ids_mutex);
+    thread_ids.insert(std::this_thread::get_id());
+  };
+
+  the_receiver.set_dispatch_workers(4, false);
+  the_receiver.register_callback(callback);
+  usleep(10000);
+  the_receiver.unregister_callback();
+
+  BOOST_REQUIRE_GT(callback_call_count, 0);
+  BOOST_REQUIRE(thread_ids.count(std::this_thread::get_id()) == 0);
+
+  // Every message carries the same metadata, so ordered dispatch must keep them all on one worker
+  callback_call_count = 0;
+  thread_ids.clear();
+  the_receiver.set_dispatch_workers(4, true);
+  the_receiver.register_callback(callback);
+  usleep(10000);
+  the_receiver.unregister_callback();
+
+  BOOST_REQUIRE_GT(callback_call_count, 0);
+  BOOST_REQUIRE_EQUAL(thread_ids.size(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(CallbackWorkersDrainOnShutdown)
+{
+  // Slow callbacks keep the work queues full, so there are always messages queued when the callback is unregistered;
+  // every message taken from the receiver must still reach the callback
+  for (bool preserve_order : { false, true }) {
+    ReceiverImpl the_receiver;
+    the_receiver.connect_for_receives({});
+    std::atomic<size_t> callback_call_count = 0;
+    the_receiver.set_dispatch_workers(2, preserve_order);
+    the_receiver.register_callback([&](Receiver::Response&) {
+      usleep(100);
+      ++callback_call_count;
+    });
+    usleep(20000);
+    the_receiver.unregister_callback();
+
+    // The receive thread may have stopped with a message kept by wait_for_message, which the next receive returns
+    auto received = the_receiver.receive_count();
+    the_receiver.receive(Receiver::s_no_block);
+    size_t kept = the_receiver.receive_count() == received ? 1 : 0;
+
+    BOOST_REQUIRE_GT(callback_call_count, 0);
+    BOOST_REQUIRE_EQUAL(callback_call_count.load() + kept, received);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(DefaultWaitForMessage)
+{
+  ReceiverImpl the_receiver;
+  the_receiver.connect_for_receives({});
+
+  // The message received while waiting is returned by the next receive, without another call to receive_
+  BOOST_REQUIRE(the_receiver.wait_for_message(Receiver::s_block, -1));
+  BOOST_REQUIRE(the_receiver.wait_for_message(Receiver::s_block, -1));
+  BOOST_REQUIRE_EQUAL(the_receiver.receive_count(), 1);
+  auto response = the_receiver.receive(Receiver::s_no_block);
+  BOOST_REQUIRE_EQUAL(response.data.size(), static_cast<size_t>(ReceiverImpl::s_bytes_on_each_receive));
+  BOOST_REQUIRE_EQUAL(the_receiver.receive_count(), 1);
+
+  // Without messages it waits out the timeout, or returns once the wakeup fd is signalled
+  the_receiver.set_empty(true);
+  auto start_time = std::chrono::steady_clock::now();
+  BOOST_REQUIRE(!the_receiver.wait_for_message(std::chrono::milliseconds(250), -1));
+  BOOST_REQUIRE(std::chrono::steady_clock::now() - start_time >= std::chrono::milliseconds(250));
+
+  int wakeup_fd = eventfd(0, EFD_CLOEXEC);
+  BOOST_REQUIRE(wakeup_fd >= 0);
+  std::thread waker([&]() {
+    usleep(50000);
+    uint64_t one = 1;
+    BOOST_REQUIRE_EQUAL(write(wakeup_fd, &one, sizeof(one)), static_cast<ssize_t>(sizeof(one)));
+  });
+  BOOST_REQUIRE(!the_receiver.wait_for_message(Receiver::s_block, wakeup_fd));
+  waker.join();
+  close(wakeup_fd);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -12,7 +12,15 @@
 
 #include "boost/test/unit_test.hpp"
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
 #include <string>
+#include <thread>
 #include <vector>
 
 using namespace dunedaq::ipm;
@@ -39,7 +47,7 @@ public:
 
 protected:
   bool send_(const void* /* message */,
-             int /* N */,
+             message_size_t /* N */,
              const duration_t& /* timeout */,
              const std::string& /* metadata */,
              bool /*no_tmoexcept_mode*/) override
@@ -52,6 +60,99 @@ private:
   bool m_can_send;
 };
 
+// Records the sizes passed down to it without reading the data, so that sizes bigger than the buffer can be used
+class SizeRecordingSender : public Sender
+{
+public:
+  std::string connect_for_sends(const nlohmann::json& /* connection_info */) override { return ""; }
+  bool can_send() const noexcept override { return true; }
+
+  std::vector<message_size_t> sizes;
+
+protected:
+  bool send_(const void* /* message */,
+             message_size_t N,
+             const duration_t& /* timeout */,
+             const std::string& /* metadata */,
+             bool /*no_tmoexcept_mode*/) override
+  {
+    sizes.push_back(N);
+    return true;
+  }
+
+  bool send_segments_(const Segment* /* segments */,
+                      size_t /* segment_count */,
+                      message_size_t N,
+                      const duration_t& /* timeout */,
+                      std::string const& /* metadata */,
+                      bool /*no_tmoexcept_mode*/) override
+  {
+    sizes.push_back(N);
+    return true;
+  }
+};
+
+// Records what it sends, and holds send_ until opened
+class GatedSender : public Sender
+{
+public:
+  ~GatedSender() { stop_async_sends(); }
+
+  std::string connect_for_sends(const nlohmann::json& /* connection_info */) override { return ""; }
+  bool can_send() const noexcept override { return true; }
+
+  void close_gate()
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    m_open = false;
+  }
+  void open_gate()
+  {
+    {
+      std::lock_guard<std::mutex> lk(m_mutex);
+      m_open = true;
+    }
+    m_cv.notify_all();
+  }
+  // Waits until send_ is held at the closed gate
+  void wait_for_sender()
+  {
+    std::unique_lock<std::mutex> lk(m_mutex);
+    m_cv.wait(lk, [&] { return m_waiting; });
+  }
+
+  std::vector<std::string> sent;
+  std::vector<std::string> metadata;
+  std::atomic<bool> result{ true };
+  std::atomic<bool> throw_error{ false };
+
+protected:
+  bool send_(const void* message,
+             message_size_t N,
+             const duration_t& /* timeout */,
+             const std::string& message_metadata,
+             bool /*no_tmoexcept_mode*/) override
+  {
+    std::unique_lock<std::mutex> lk(m_mutex);
+    m_waiting = true;
+    m_cv.notify_all();
+    m_cv.wait(lk, [&] { return m_open; });
+    m_waiting = false;
+    if (throw_error) {
+      throw std::runtime_error("transport failure");
+    }
+    sent.emplace_back(static_cast<const char*>(message), N);
+    metadata.push_back(message_metadata);
+    return result;
+  }
+
+private:
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  bool m_open{ true };
+  bool m_waiting{ false };
+};
+
 } // namespace ""
 
 BOOST_AUTO_TEST_CASE(CopyAndMoveSemantics)
@@ -102,6 +203,238 @@ BOOST_AUTO_TEST_CASE(BadInput)
 
   std::vector<char> random_data{ 'T', 'E', 'S', 'T' };
   BOOST_REQUIRE_NO_THROW(the_sender.send(random_data.data(), 0, Sender::s_no_block));
+
+  // message_size_t is unsigned, so a negative size arrives as a huge one
+  int negative_size = -1;
+  BOOST_REQUIRE_EXCEPTION(the_sender.send(random_data.data(), negative_size, Sender::s_no_block),
+                          dunedaq::ipm::InvalidMessageSize,
+                          [&](dunedaq::ipm::InvalidMessageSize) { return true; });
+  std::vector<Sender::Segment> segments{ { random_data.data(), 4 }, { random_data.data(), size_t(-4) } };
+  BOOST_REQUIRE_EXCEPTION(the_sender.send_segments(segments, Sender::s_no_block),
+                          dunedaq::ipm::InvalidMessageSize,
+                          [&](dunedaq::ipm::InvalidMessageSize) { return true; });
+  std::vector<Sender::BatchEntry> batch{ { random_data.data(), 4, "" }, { random_data.data(), size_t(-1), "" } };
+  BOOST_REQUIRE_EXCEPTION(the_sender.send_batch(batch, Sender::s_no_block),
+                          dunedaq::ipm::InvalidMessageSize,
+                          [&](dunedaq::ipm::InvalidMessageSize) { return true; });
+}
+
+BOOST_AUTO_TEST_CASE(LargeSizes)
+{
+  SizeRecordingSender the_sender;
+
+  // Bigger than INT_MAX, passed down whole. The data is never read, so a small buffer stands in for it.
+  const Sender::message_size_t large_size = (size_t(1) << 31) + 16;
+  std::vector<char> random_data{ 'T', 'E', 'S', 'T' };
+  BOOST_REQUIRE(the_sender.send(random_data.data(), large_size, Sender::s_no_block));
+  BOOST_REQUIRE(the_sender.send(std::make_unique<char[]>(4), large_size, Sender::s_no_block));
+
+  // Segments which only add up to more than INT_MAX
+  std::vector<Sender::Segment> segments{ { random_data.data(), size_t(1) << 30 },
+                                         { random_data.data(), size_t(1) << 30 },
+                                         { random_data.data(), 16 } };
+  BOOST_REQUIRE(the_sender.send_segments(segments, Sender::s_no_block));
+
+  std::vector<Sender::BatchEntry> batch{ { random_data.data(), 4, "" }, { random_data.data(), large_size, "" } };
+  BOOST_REQUIRE_EQUAL(the_sender.send_batch(batch, Sender::s_no_block), 2);
+
+  BOOST_REQUIRE(the_sender.sizes ==
+                std::vector<Sender::message_size_t>({ large_size, large_size, large_size, 4, large_size }));
+
+  // The largest size accepted, and the first one rejected
+  BOOST_REQUIRE(the_sender.send(random_data.data(), Sender::s_max_message_size, Sender::s_no_block));
+  BOOST_REQUIRE_EQUAL(the_sender.sizes.back(), Sender::s_max_message_size);
+  BOOST_REQUIRE_EXCEPTION(the_sender.send(random_data.data(), Sender::s_max_message_size + 1, Sender::s_no_block),
+                          dunedaq::ipm::InvalidMessageSize,
+                          [&](dunedaq::ipm::InvalidMessageSize) { return true; });
+  segments.push_back({ random_data.data(), Sender::s_max_message_size });
+  BOOST_REQUIRE_EXCEPTION(the_sender.send_segments(segments, Sender::s_no_block),
+                          dunedaq::ipm::InvalidMessageSize,
+                          [&](dunedaq::ipm::InvalidMessageSize) { return true; });
+  BOOST_REQUIRE_EQUAL(the_sender.sizes.size(), 6);
+}
+
+BOOST_AUTO_TEST_CASE(OwnedBuffer)
+{
+  SenderImpl the_sender;
+  nlohmann::json j;
+  the_sender.connect_for_sends(j);
+
+  size_t deleter_calls = 0;
+  Sender::owned_buffer_t buffer(new char[4]{ 'T', 'E', 'S', 'T' }, [&](char* ptr) {
+    ++deleter_calls;
+    delete[] ptr; // NOLINT
+  });
+  BOOST_REQUIRE(the_sender.send(std::move(buffer), 4, Sender::s_no_block));
+  BOOST_REQUIRE_EQUAL(deleter_calls, 1);
+
+  BOOST_REQUIRE_NO_THROW(the_sender.send(std::make_unique<char[]>(10), 10, Sender::s_no_block));
+
+  BOOST_REQUIRE_EXCEPTION(the_sender.send(Sender::owned_buffer_t(), 10, Sender::s_no_block),
+                          dunedaq::ipm::NullPointerPassedToSend,
+                          [&](dunedaq::ipm::NullPointerPassedToSend) { return true; });
+}
+
+BOOST_AUTO_TEST_CASE(Segments)
+{
+  SenderImpl the_sender;
+  std::vector<char> header{ 'H', 'D', 'R' };
+  std::vector<char> payload{ 'T', 'E', 'S', 'T' };
+  std::vector<Sender::Segment> segments{ { header.data(), 3 }, { payload.data(), 4 } };
+
+  BOOST_REQUIRE_EXCEPTION(the_sender.send_segments(segments, Sender::s_no_block),
+                          dunedaq::ipm::KnownStateForbidsSend,
+                          [&](dunedaq::ipm::KnownStateForbidsSend) { return true; });
+
+  nlohmann::json j;
+  the_sender.connect_for_sends(j);
+  BOOST_REQUIRE(the_sender.send_segments(segments, Sender::s_no_block));
+  BOOST_REQUIRE(the_sender.send_segments({}, Sender::s_no_block));
+
+  segments.push_back({ nullptr, 10 });
+  BOOST_REQUIRE_EXCEPTION(the_sender.send_segments(segments, Sender::s_no_block),
+                          dunedaq::ipm::NullPointerPassedToSend,
+                          [&](dunedaq::ipm::NullPointerPassedToSend) { return true; });
+}
+
+BOOST_AUTO_TEST_CASE(Batch)
+{
+  SenderImpl the_sender;
+  std::vector<char> random_data{ 'T', 'E', 'S', 'T' };
+  std::vector<Sender::BatchEntry> batch{ { random_data.data(), 4, "" }, { random_data.data(), 2, "half" } };
+
+  BOOST_REQUIRE_EXCEPTION(the_sender.send_batch(batch, Sender::s_no_block),
+                          dunedaq::ipm::KnownStateForbidsSend,
+                          [&](dunedaq::ipm::KnownStateForbidsSend) { return true; });
+
+  nlohmann::json j;
+  the_sender.connect_for_sends(j);
+  BOOST_REQUIRE_EQUAL(the_sender.send_batch(batch, Sender::s_no_block), 2);
+  BOOST_REQUIRE_EQUAL(the_sender.send_batch(nullptr, 0, Sender::s_no_block), 0);
+
+  batch.push_back({ nullptr, 10, "" });
+  BOOST_REQUIRE_EXCEPTION(the_sender.send_batch(batch, Sender::s_no_block),
+                          dunedaq::ipm::NullPointerPassedToSend,
+                          [&](dunedaq::ipm::NullPointerPassedToSend) { return true; });
+}
+
+BOOST_AUTO_TEST_CASE(AsyncSend)
+{
+  GatedSender the_sender;
+  std::vector<std::future<bool>> results;
+  for (int ii = 0; ii < 10; ++ii) {
+    auto message = std::to_string(ii);
+    results.push_back(the_sender.send_async(message.data(), message.size(), Sender::s_block, "meta"));
+  }
+  size_t deleter_calls = 0;
+  Sender::owned_buffer_t buffer(new char[4]{ 'T', 'E', 'S', 'T' }, [&](char* ptr) {
+    ++deleter_calls;
+    delete[] ptr; // NOLINT
+  });
+  std::promise<bool> callback_result;
+  the_sender.send_async(
+    std::move(buffer), 4, Sender::s_block, "", [&](bool sent, std::exception_ptr) { callback_result.set_value(sent); });
+
+  for (auto& result : results) {
+    BOOST_REQUIRE(result.get());
+  }
+  BOOST_REQUIRE(callback_result.get_future().get());
+  BOOST_REQUIRE(the_sender.flush_async(Sender::s_block));
+  BOOST_REQUIRE_EQUAL(deleter_calls, 1);
+  BOOST_REQUIRE_EQUAL(the_sender.sent.size(), 11);
+  for (int ii = 0; ii < 10; ++ii) {
+    BOOST_REQUIRE_EQUAL(the_sender.sent[ii], std::to_string(ii));
+    BOOST_REQUIRE_EQUAL(the_sender.metadata[ii], "meta");
+  }
+  BOOST_REQUIRE_EQUAL(the_sender.sent[10], "TEST");
+}
+
+BOOST_AUTO_TEST_CASE(AsyncQueueFull)
+{
+  GatedSender the_sender;
+  the_sender.set_async_queue_capacity(2);
+  the_sender.close_gate();
+
+  // The first message is held in send_, the next two fill the queue, and the last is dropped without blocking
+  std::string message = "TEST";
+  auto first = the_sender.send_async(message.data(), message.size(), Sender::s_block);
+  the_sender.wait_for_sender();
+  auto second = the_sender.send_async(message.data(), message.size(), Sender::s_block);
+  auto third = the_sender.send_async(message.data(), message.size(), Sender::s_block);
+  auto dropped = the_sender.send_async(message.data(), message.size(), Sender::s_block);
+  BOOST_REQUIRE(dropped.wait_for(std::chrono::seconds(0)) == std::future_status::ready);
+  BOOST_REQUIRE(!dropped.get());
+  BOOST_REQUIRE(!the_sender.flush_async(std::chrono::milliseconds(10)));
+
+  the_sender.open_gate();
+  BOOST_REQUIRE(the_sender.flush_async(std::chrono::milliseconds(5000)));
+  BOOST_REQUIRE(first.get());
+  BOOST_REQUIRE(second.get());
+  BOOST_REQUIRE(third.get());
+  BOOST_REQUIRE_EQUAL(the_sender.sent.size(), 3);
+}
+
+BOOST_AUTO_TEST_CASE(AsyncErrors)
+{
+  SenderImpl unconnected_sender;
+  std::string message = "TEST";
+  BOOST_REQUIRE_EXCEPTION(unconnected_sender.send_async(message.data(), message.size(), Sender::s_no_block),
+                          dunedaq::ipm::KnownStateForbidsSend,
+                          [&](dunedaq::ipm::KnownStateForbidsSend) { return true; });
+
+  GatedSender the_sender;
+  BOOST_REQUIRE_EXCEPTION(the_sender.send_async(nullptr, 10, Sender::s_no_block),
+                          dunedaq::ipm::NullPointerPassedToSend,
+                          [&](dunedaq::ipm::NullPointerPassedToSend) { return true; });
+
+  // A send which times out completes with false, and an exception is passed on through the future
+  the_sender.result = false;
+  BOOST_REQUIRE(!the_sender.send_async(message.data(), message.size(), Sender::s_no_block).get());
+  the_sender.throw_error = true;
+  auto failed = the_sender.send_async(message.data(), message.size(), Sender::s_no_block);
+  BOOST_REQUIRE_THROW(failed.get(), std::runtime_error);
+
+  // Once stopped, nothing more is sent
+  the_sender.throw_error = false;
+  the_sender.stop_async_sends();
+  BOOST_REQUIRE(!the_sender.send_async(message.data(), message.size(), Sender::s_no_block).get());
+}
+
+BOOST_AUTO_TEST_CASE(AsyncStopWhileSending)
+{
+  // Messages given to send_async while it is being stopped must still complete, one way or the other
+  GatedSender the_sender;
+  std::string message = "TEST";
+  the_sender.send_async(message.data(), message.size(), Sender::s_no_block).get();
+
+  const int n_threads = 4;
+  std::atomic<bool> stopped{ false };
+  std::vector<std::vector<std::future<bool>>> results(n_threads);
+  std::vector<std::thread> producers;
+  for (int ii = 0; ii < n_threads; ++ii) {
+    producers.emplace_back([&, ii]() {
+      while (!stopped.load()) {
+        results[ii].push_back(the_sender.send_async(message.data(), message.size(), Sender::s_no_block));
+      }
+      // A few more after the stop, some of which may have passed the running check before it
+      for (int jj = 0; jj < 10; ++jj) {
+        results[ii].push_back(the_sender.send_async(message.data(), message.size(), Sender::s_no_block));
+      }
+    });
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  the_sender.stop_async_sends();
+  stopped = true;
+  for (auto& producer : producers) {
+    producer.join();
+  }
+
+  for (auto& thread_results : results) {
+    for (auto& result : thread_results) {
+      BOOST_REQUIRE(result.wait_for(std::chrono::seconds(0)) == std::future_status::ready);
+    }
+  }
+  BOOST_REQUIRE(the_sender.flush_async(Sender::s_no_block));
 }
 
 BOOST_AUTO_TEST_SUITE_END()
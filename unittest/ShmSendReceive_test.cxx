@@ -0,0 +1,268 @@
+/**
+ * @file ShmSendReceive_test.cxx Test ShmSender to ShmReceiver transfer
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "ShmRing.hpp"
+#include "ipm/PluginInfo.hpp"
+#include "ipm/Receiver.hpp"
+#include "ipm/Sender.hpp"
+
+#define BOOST_TEST_MODULE ShmSendReceive_test // NOLINT
+
+#include "boost/test/unit_test.hpp"
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace dunedaq::ipm;
+
+BOOST_AUTO_TEST_SUITE(ShmSendReceive_test)
+
+BOOST_AUTO_TEST_CASE(SendReceiveTest)
+{
+  auto the_receiver = make_ipm_receiver(ShmPluginNames.at(IpmPluginType::Receiver));
+  BOOST_REQUIRE(the_receiver != nullptr);
+  BOOST_REQUIRE(!the_receiver->can_receive());
+
+  auto the_sender = make_ipm_sender(ShmPluginNames.at(IpmPluginType::Sender));
+  BOOST_REQUIRE(the_sender != nullptr);
+  BOOST_REQUIRE(!the_sender->can_send());
+
+  nlohmann::json config_json;
+  config_json["connection_string"] = "shm://ipm_test_sendreceive";
+  the_receiver->connect_for_receives(config_json);
+  the_sender->connect_for_sends(config_json);
+
+  BOOST_REQUIRE(the_receiver->can_receive());
+  BOOST_REQUIRE(the_sender->can_send());
+
+  BOOST_REQUIRE_EXCEPTION(the_receiver->receive(std::chrono::milliseconds(10)),
+                          dunedaq::ipm::ReceiveTimeoutExpired,
+                          [&](dunedaq::ipm::ReceiveTimeoutExpired) { return true; });
+
+  std::vector<char> test_data{ 'T', 'E', 'S', 'T' };
+  BOOST_REQUIRE(the_sender->send(test_data.data(), test_data.size(), Sender::s_no_block, "meta"));
+  auto response = the_receiver->receive(Receiver::s_block);
+  BOOST_REQUIRE_EQUAL(std::string(response.data.begin(), response.data.end()), "TEST");
+  BOOST_REQUIRE_EQUAL(response.metadata, "meta");
+
+  std::vector<Sender::Segment> segments{ { test_data.data(), 2 }, { test_data.data(), 4 } };
+  BOOST_REQUIRE(the_sender->send_segments(segments, Sender::s_no_block));
+  response = the_receiver->receive(Receiver::s_block);
+  BOOST_REQUIRE_EQUAL(std::string(response.data.begin(), response.data.end()), "TETEST");
+}
+
+BOOST_AUTO_TEST_CASE(BadConnectionString)
+{
+  auto the_receiver = make_ipm_receiver("ShmReceiver");
+  BOOST_REQUIRE_EXCEPTION(the_receiver->connect_for_receives({ { "connection_string", "tcp://127.0.0.1:1234" } }),
+                          dunedaq::ipm::ShmOperationError,
+                          [&](dunedaq::ipm::ShmOperationError) { return true; });
+  BOOST_REQUIRE(!the_receiver->can_receive());
+}
+
+BOOST_AUTO_TEST_CASE(FullRingTest)
+{
+  nlohmann::json config_json;
+  config_json["connection_string"] = "shm://ipm_test_fullring";
+  config_json["shm_capacity"] = 4096;
+
+  // The sender may connect first; it attaches once the receiver has created the ring
+  auto the_sender = make_ipm_sender("ShmSender");
+  the_sender->connect_for_sends(config_json);
+  auto the_receiver = make_ipm_receiver("ShmReceiver");
+  the_receiver->connect_for_receives(config_json);
+
+  std::vector<char> test_data(1000, 'A');
+  size_t sent = 0;
+  while (the_sender->send(test_data.data(), test_data.size(), Sender::s_no_block, "", true)) {
+    ++sent;
+  }
+  BOOST_REQUIRE_EQUAL(sent, 4); // 4 records of 1000 bytes plus headers fill 4096 bytes
+  BOOST_REQUIRE_EXCEPTION(the_sender->send(test_data.data(), test_data.size(), std::chrono::milliseconds(10)),
+                          dunedaq::ipm::SendTimeoutExpired,
+                          [&](dunedaq::ipm::SendTimeoutExpired) { return true; });
+
+  std::vector<char> too_large(8192, 'B');
+  BOOST_REQUIRE_EXCEPTION(the_sender->send(too_large.data(), too_large.size(), Sender::s_block),
+                          dunedaq::ipm::ShmMessageTooLarge,
+                          [&](dunedaq::ipm::ShmMessageTooLarge) { return true; });
+
+  // A blocked sender is woken as soon as the receiver makes room, and records wrap around the end of the ring
+  std::thread sender_thread([&]() {
+    for (int ii = 0; ii < 100; ++ii) {
+      the_sender->send(test_data.data(), test_data.size(), Sender::s_block);
+    }
+  });
+  for (int ii = 0; ii < 104; ++ii) {
+    auto response = the_receiver->receive(std::chrono::milliseconds(1000));
+    BOOST_REQUIRE_EQUAL(response.data.size(), 1000);
+    BOOST_REQUIRE_EQUAL(response.data[999], 'A');
+  }
+  sender_thread.join();
+}
+
+BOOST_AUTO_TEST_CASE(StaleSegment)
+{
+  // A receiver which dies without cleaning up leaves its segment behind, holding a message nobody read
+  const std::string name = "ipm_test_stale";
+  auto child = fork();
+  BOOST_REQUIRE(child >= 0);
+  if (child == 0) {
+    ShmRing dead_receiver(name, 4096, true);
+    ShmRing writer(name, 0, false);
+    Sender::Segment segment{ "OLD", 3 };
+    std::chrono::steady_clock::duration wait_time{};
+    writer.write("", &segment, 1, 3, ShmRing::duration_t::zero(), wait_time);
+    _exit(0);
+  }
+  int status = 0;
+  BOOST_REQUIRE_EQUAL(waitpid(child, &status, 0), child);
+  BOOST_REQUIRE(std::filesystem::exists("/dev/shm/ipm_" + name));
+
+  // A new receiver starts from a fresh segment
+  nlohmann::json config_json = { { "connection_string", "shm://" + name } };
+  auto the_receiver = make_ipm_receiver("ShmReceiver");
+  the_receiver->connect_for_receives(config_json);
+  auto the_sender = make_ipm_sender("ShmSender");
+  the_sender->connect_for_sends(config_json);
+  BOOST_REQUIRE_EXCEPTION(the_receiver->receive(std::chrono::milliseconds(10)),
+                          dunedaq::ipm::ReceiveTimeoutExpired,
+                          [&](dunedaq::ipm::ReceiveTimeoutExpired) { return true; });
+  BOOST_REQUIRE(the_sender->send("NEW", 3, Sender::s_no_block));
+  auto response = the_receiver->receive(std::chrono::milliseconds(1000));
+  BOOST_REQUIRE_EQUAL(std::string(response.data.begin(), response.data.end()), "NEW");
+
+  // but not from one whose receiver is still running
+  auto second_receiver = make_ipm_receiver("ShmReceiver");
+  BOOST_REQUIRE_EXCEPTION(second_receiver->connect_for_receives(config_json),
+                          dunedaq::ipm::ShmOperationError,
+                          [&](dunedaq::ipm::ShmOperationError) { return true; });
+
+  the_receiver.reset();
+  BOOST_REQUIRE(!std::filesystem::exists("/dev/shm/ipm_" + name));
+}
+
+BOOST_AUTO_TEST_CASE(Reconnect)
+{
+  const std::string name = "ipm_test_reconnect";
+  nlohmann::json config_json = { { "connection_string", "shm://" + name }, { "shm_capacity", 4096 } };
+
+  // A sender which connects first creates nothing, so leaves nothing behind
+  {
+    auto early_sender = make_ipm_sender("ShmSender");
+    early_sender->connect_for_sends(config_json);
+    BOOST_REQUIRE(!early_sender->send("TEST", 4, Sender::s_no_block, "", true));
+  }
+  BOOST_REQUIRE(!std::filesystem::exists("/dev/shm/ipm_" + name));
+
+  auto the_sender = make_ipm_sender("ShmSender");
+  the_sender->connect_for_sends(config_json);
+  auto the_receiver = make_ipm_receiver("ShmReceiver");
+  the_receiver->connect_for_receives(config_json);
+  BOOST_REQUIRE(the_sender->send("FIRST", 5, Sender::s_no_block));
+  BOOST_REQUIRE_EQUAL(the_receiver->receive(std::chrono::milliseconds(1000)).data.size(), 5);
+
+  // Once the receiver has gone, sends wait for a new one, and then reach it
+  the_receiver.reset();
+  BOOST_REQUIRE(!the_sender->send("LOST", 4, std::chrono::milliseconds(10), "", true));
+  std::thread sender_thread([&]() { the_sender->send("SECOND", 6, std::chrono::milliseconds(5000)); });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  the_receiver = make_ipm_receiver("ShmReceiver");
+  the_receiver->connect_for_receives(config_json);
+  auto response = the_receiver->receive(std::chrono::milliseconds(5000));
+  BOOST_REQUIRE_EQUAL(std::string(response.data.begin(), response.data.end()), "SECOND");
+  sender_thread.join();
+
+  // A sender blocked on a full ring moves on when its receiver is replaced
+  std::vector<char> test_data(1000, 'A');
+  while (the_sender->send(test_data.data(), test_data.size(), Sender::s_no_block, "", true)) {
+  }
+  // Top up with messages of the same size as the next one, so that it cannot fit in what is left
+  while (the_sender->send("FILL!", 5, Sender::s_no_block, "", true)) {
+  }
+  sender_thread = std::thread([&]() { the_sender->send("THIRD", 5, std::chrono::milliseconds(5000)); });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  the_receiver.reset();
+  the_receiver = make_ipm_receiver("ShmReceiver");
+  the_receiver->connect_for_receives(config_json);
+  response = the_receiver->receive(std::chrono::milliseconds(5000));
+  BOOST_REQUIRE_EQUAL(std::string(response.data.begin(), response.data.end()), "THIRD");
+  sender_thread.join();
+}
+
+BOOST_AUTO_TEST_CASE(SingleSender)
+{
+  const std::string name = "ipm_test_single_sender";
+  nlohmann::json config_json = { { "connection_string", "shm://" + name } };
+  auto the_receiver = make_ipm_receiver("ShmReceiver");
+  the_receiver->connect_for_receives(config_json);
+
+  // A sender which exits without detaching leaves its claim behind, which the next sender takes over
+  auto child = fork();
+  BOOST_REQUIRE(child >= 0);
+  if (child == 0) {
+    new ShmRing(name, 0, false); // NOLINT
+    _exit(0);
+  }
+  int status = 0;
+  BOOST_REQUIRE_EQUAL(waitpid(child, &status, 0), child);
+
+  auto the_sender = make_ipm_sender("ShmSender");
+  the_sender->connect_for_sends(config_json);
+
+  // but a second sender cannot join one which is still running
+  auto second_sender = make_ipm_sender("ShmSender");
+  BOOST_REQUIRE_EXCEPTION(second_sender->connect_for_sends(config_json),
+                          dunedaq::ipm::ShmOperationError,
+                          [&](dunedaq::ipm::ShmOperationError) { return true; });
+
+  BOOST_REQUIRE(the_sender->send("FIRST", 5, Sender::s_no_block));
+  the_sender.reset();
+  second_sender->connect_for_sends(config_json);
+  BOOST_REQUIRE(second_sender->send("SECOND", 6, Sender::s_no_block));
+
+  auto response = the_receiver->receive(std::chrono::milliseconds(1000));
+  BOOST_REQUIRE_EQUAL(std::string(response.data.begin(), response.data.end()), "FIRST");
+  response = the_receiver->receive(std::chrono::milliseconds(1000));
+  BOOST_REQUIRE_EQUAL(std::string(response.data.begin(), response.data.end()), "SECOND");
+}
+
+BOOST_AUTO_TEST_CASE(CallbackTest)
+{
+  nlohmann::json config_json;
+  config_json["connection_string"] = "shm://ipm_test_callback";
+  auto the_receiver = make_ipm_receiver("ShmReceiver");
+  the_receiver->connect_for_receives(config_json);
+  auto the_sender = make_ipm_sender("ShmSender");
+  the_sender->connect_for_sends(config_json);
+
+  std::atomic<int> received = 0;
+  the_receiver->register_callback([&](Receiver::Response& response) {
+    if (response.data.size() == 4) {
+      ++received;
+    }
+  });
+
+  std::vector<char> test_data{ 'T', 'E', 'S', 'T' };
+  for (int ii = 0; ii < 10; ++ii) {
+    the_sender->send(test_data.data(), test_data.size(), Sender::s_block);
+  }
+  for (int ii = 0; ii < 1000 && received.load() < 10; ++ii) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  the_receiver->unregister_callback();
+  BOOST_REQUIRE_EQUAL(received.load(), 10);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
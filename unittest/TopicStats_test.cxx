@@ -0,0 +1,103 @@
+/**
+ * @file TopicStats_test.cxx TopicStats class Unit Tests
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "TopicStats.hpp"
+
+#define BOOST_TEST_MODULE TopicStats_test // NOLINT
+
+#include "boost/test/unit_test.hpp"
+
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace dunedaq::ipm;
+
+namespace {
+std::map<std::string, opmon::TopicInfo>
+take_all(TopicStats& stats)
+{
+  std::map<std::string, opmon::TopicInfo> result;
+  for (auto& [topic, info] : stats.take()) {
+    result[topic] = info;
+  }
+  return result;
+}
+} // namespace ""
+
+BOOST_AUTO_TEST_SUITE(TopicStats_test)
+
+BOOST_AUTO_TEST_CASE(Counting)
+{
+  TopicStats stats;
+  stats.add("A", 10);
+  stats.add("A", 20);
+  stats.add("B", 5);
+
+  auto infos = take_all(stats);
+  BOOST_REQUIRE_EQUAL(infos.size(), 2);
+  BOOST_REQUIRE_EQUAL(infos["A"].messages(), 2);
+  BOOST_REQUIRE_EQUAL(infos["A"].bytes(), 30);
+  BOOST_REQUIRE_EQUAL(infos["B"].messages(), 1);
+  BOOST_REQUIRE_EQUAL(infos["B"].bytes(), 5);
+  BOOST_REQUIRE_GT(infos["A"].messages_per_second(), 0);
+  BOOST_REQUIRE_GT(infos["A"].bytes_per_second(), infos["A"].messages_per_second());
+
+  // Counters are reset, and idle topics are left out
+  stats.add("B", 7);
+  infos = take_all(stats);
+  BOOST_REQUIRE_EQUAL(infos.size(), 1);
+  BOOST_REQUIRE_EQUAL(infos["B"].bytes(), 7);
+}
+
+BOOST_AUTO_TEST_CASE(Overflow)
+{
+  TopicStats stats(2);
+  stats.add("A", 1);
+  stats.add("B", 1);
+  stats.add("C", 1);
+  stats.add("D", 1);
+  stats.add("A", 1);
+
+  auto infos = take_all(stats);
+  BOOST_REQUIRE_EQUAL(infos.size(), 3);
+  BOOST_REQUIRE_EQUAL(infos["A"].messages(), 2);
+  BOOST_REQUIRE_EQUAL(infos["B"].messages(), 1);
+  BOOST_REQUIRE_EQUAL(infos[std::string(TopicStats::s_overflow_topic)].messages(), 2);
+  BOOST_REQUIRE_EQUAL(infos.count("C"), 0);
+}
+
+BOOST_AUTO_TEST_CASE(MultipleThreads)
+{
+  TopicStats stats(4);
+  const int n_threads = 4;
+  const int n_messages = 10000;
+
+  std::vector<std::thread> threads;
+  for (int tt = 0; tt < n_threads; ++tt) {
+    threads.emplace_back([&, tt] {
+      for (int ii = 0; ii < n_messages; ++ii) {
+        stats.add("topic" + std::to_string((tt + ii) % 8), 1);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  uint64_t total = 0;
+  auto infos = take_all(stats);
+  BOOST_REQUIRE_EQUAL(infos.size(), 5);
+  for (auto& [topic, info] : infos) {
+    total += info.messages();
+  }
+  BOOST_REQUIRE_EQUAL(total, n_threads * n_messages);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
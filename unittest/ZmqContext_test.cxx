@@ -0,0 +1,179 @@
+/**
+ * @file ZmqContext_test.cxx ZmqContext IO thread settings Unit Tests
+ *
+ * The IO thread settings only take effect when ZMQ starts its IO threads, on creation of the first socket, so the
+ * test cases which create sockets come last.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "ipm/Receiver.hpp"
+#include "ipm/Sender.hpp"
+#include "ipm/ZmqContext.hpp"
+
+#define BOOST_TEST_MODULE ZmqContext_test // NOLINT
+
+#include "boost/test/unit_test.hpp"
+
+#include <sched.h>
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <set>
+#include <string>
+#include <vector>
+
+using namespace dunedaq::ipm;
+
+namespace {
+
+const int s_name_prefix = 7;
+
+// Thread IDs of the ZMQ IO threads of this process
+std::vector<pid_t>
+io_thread_ids()
+{
+  std::vector<pid_t> tids;
+  for (auto& task : std::filesystem::directory_iterator("/proc/self/task")) {
+    std::string name;
+    std::getline(std::ifstream(task.path() / "comm"), name);
+    if (name.find("ZMQbg/IO") != std::string::npos) {
+      BOOST_TEST_MESSAGE("IO thread " << task.path().filename() << " is named " << name);
+      BOOST_REQUIRE_EQUAL(name.rfind(std::to_string(s_name_prefix) + "/", 0), 0);
+      tids.push_back(std::stoi(task.path().filename()));
+    }
+  }
+  return tids;
+}
+
+} // namespace ""
+
+BOOST_AUTO_TEST_SUITE(ZmqContext_test)
+
+BOOST_AUTO_TEST_CASE(InvalidSettings)
+{
+  auto& context = ZmqContext::instance();
+  auto is_setting_error = [](ZmqContextSettingError const&) { return true; };
+  BOOST_REQUIRE_EXCEPTION(context.set_io_thread_affinity({ -1 }), ZmqContextSettingError, is_setting_error);
+  BOOST_REQUIRE_EXCEPTION(context.set_io_thread_affinity({ CPU_SETSIZE }), ZmqContextSettingError, is_setting_error);
+  BOOST_REQUIRE_EXCEPTION(context.set_io_thread_scheduling(12345, 0), ZmqContextSettingError, is_setting_error);
+  BOOST_REQUIRE_EXCEPTION(context.set_io_thread_scheduling(SCHED_OTHER, 5), ZmqContextSettingError, is_setting_error);
+  BOOST_REQUIRE_EXCEPTION(context.set_io_thread_scheduling(SCHED_FIFO, 1000), ZmqContextSettingError, is_setting_error);
+  BOOST_REQUIRE_EXCEPTION(context.set_io_thread_name_prefix(-1), ZmqContextSettingError, is_setting_error);
+}
+
+BOOST_AUTO_TEST_CASE(NoThreadsBeforeConnect)
+{
+  // The plugins create their sockets, in the context they are given, when they connect
+  auto the_receiver = make_ipm_receiver("ZmqReceiver");
+  auto the_sender = make_ipm_sender("ZmqSender");
+  auto the_subscriber = make_ipm_receiver("ZmqSubscriber");
+  auto the_publisher = make_ipm_sender("ZmqPublisher");
+  BOOST_REQUIRE(io_thread_ids().empty());
+}
+
+BOOST_AUTO_TEST_CASE(IoThreadPlacement)
+{
+  // Pin the IO threads to the last CPU this process may use, which differs from the default whenever there is more
+  // than one
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  BOOST_REQUIRE_EQUAL(sched_getaffinity(0, sizeof(allowed), &allowed), 0);
+  int cpu = CPU_SETSIZE - 1;
+  while (!CPU_ISSET(cpu, &allowed)) {
+    --cpu;
+  }
+
+  auto& context = ZmqContext::instance();
+  context.set_context_threads(2);
+  context.set_io_thread_affinity({ cpu });
+  context.set_io_thread_scheduling(SCHED_BATCH, 0);
+  context.set_io_thread_name_prefix(s_name_prefix);
+
+  // Creating the sockets starts the IO threads; a message over TCP makes sure they have run
+  auto the_receiver = make_ipm_receiver("ZmqReceiver");
+  auto the_sender = make_ipm_sender("ZmqSender");
+  auto endpoint = the_receiver->connect_for_receives({ { "connection_string", "tcp://127.0.0.1:*" } });
+  the_sender->connect_for_sends({ { "connection_string", endpoint } });
+  std::vector<char> test_data{ 'T', 'E', 'S', 'T' };
+  the_sender->send(test_data.data(), test_data.size(), Sender::s_block);
+  BOOST_REQUIRE_EQUAL(the_receiver->receive(Receiver::s_block).data.size(), test_data.size());
+
+  auto tids = io_thread_ids();
+  BOOST_REQUIRE_EQUAL(tids.size(), 2);
+  for (auto tid : tids) {
+    cpu_set_t affinity;
+    CPU_ZERO(&affinity);
+    BOOST_REQUIRE_EQUAL(sched_getaffinity(tid, sizeof(affinity), &affinity), 0);
+    BOOST_REQUIRE_EQUAL(CPU_COUNT(&affinity), 1);
+    BOOST_REQUIRE(CPU_ISSET(cpu, &affinity));
+    BOOST_REQUIRE_EQUAL(sched_getscheduler(tid), SCHED_BATCH);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(NamedContexts)
+{
+  auto& context = ZmqContext::instance("ipm_test");
+  BOOST_REQUIRE_NE(&context, &ZmqContext::instance());
+  BOOST_REQUIRE_EQUAL(&context, &ZmqContext::instance("ipm_test"));
+  BOOST_REQUIRE_EQUAL(&ZmqContext::instance(""), &ZmqContext::instance());
+  BOOST_REQUIRE_EQUAL(context.name(), "ipm_test");
+
+  // inproc endpoints can only be reached from the same context
+  std::vector<char> test_data{ 'T', 'E', 'S', 'T' };
+  auto the_receiver = make_ipm_receiver("ZmqReceiver");
+  auto the_sender = make_ipm_sender("ZmqSender");
+  nlohmann::json connection_info = { { "connection_string", "inproc://named_context_test" },
+                                     { "zmq_context", "ipm_test" } };
+  the_receiver->connect_for_receives(connection_info);
+  the_sender->connect_for_sends(connection_info);
+  the_sender->send(test_data.data(), test_data.size(), Sender::s_block);
+  BOOST_REQUIRE_EQUAL(the_receiver->receive(Receiver::s_block).data.size(), test_data.size());
+
+  // Once connected, a socket stays in its context
+  connection_info["zmq_context"] = "other";
+  BOOST_REQUIRE_EXCEPTION(the_sender->connect_for_sends(connection_info),
+                          ZmqOperationError,
+                          [](ZmqOperationError const&) { return true; });
+
+  // TCP connects sockets in different contexts
+  auto tcp_receiver = make_ipm_receiver("ZmqReceiver");
+  auto tcp_sender = make_ipm_sender("ZmqSender");
+  auto endpoint =
+    tcp_receiver->connect_for_receives({ { "connection_string", "tcp://127.0.0.1:*" }, { "zmq_context", "ipm_test" } });
+  tcp_sender->connect_for_sends({ { "connection_string", endpoint } });
+  tcp_sender->send(test_data.data(), test_data.size(), Sender::s_block);
+  BOOST_REQUIRE_EQUAL(tcp_receiver->receive(Receiver::s_block).data.size(), test_data.size());
+}
+
+BOOST_AUTO_TEST_CASE(NamedContextSettings)
+{
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  BOOST_REQUIRE_EQUAL(sched_getaffinity(0, sizeof(allowed), &allowed), 0);
+  int cpu = 0;
+  while (!CPU_ISSET(cpu, &allowed)) {
+    ++cpu;
+  }
+
+  // Named contexts read their own environment variables
+  setenv("IPM_ZMQ_IO_THREAD_AFFINITY_ENV_CONTEXT", std::to_string(cpu).c_str(), 1);
+  BOOST_REQUIRE(ZmqContext::instance("env-context").io_thread_affinity() == std::set<int>{ cpu });
+  BOOST_REQUIRE(ZmqContext::instance("ipm_test").io_thread_affinity().empty());
+
+  // numa<N> contexts run on the CPUs of their node
+  if (std::filesystem::exists("/sys/devices/system/node/node0/cpulist")) {
+    auto& affinity = ZmqContext::instance("numa0").io_thread_affinity();
+    BOOST_REQUIRE(!affinity.empty());
+    for (auto numa_cpu : affinity) {
+      BOOST_REQUIRE(CPU_ISSET(numa_cpu, &allowed));
+    }
+  } else {
+    BOOST_TEST_MESSAGE("No NUMA node information, skipping the numa0 context check");
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -15,6 +15,7 @@
 
 #include "boost/test/unit_test.hpp"
 
+#include <chrono>
 #include <string>
 #include <vector>
 
@@ -29,6 +30,23 @@ elapsed_time_milliseconds(std::chrono::steady_clock::time_point const& then)
     std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - then).count());
 }
 
+// A publisher drops messages until the subscription has reached it (the "slow joiner"), so send again until one
+// arrives, giving up after about 5 seconds
+template<typename SendFunction>
+Receiver::Response
+resend_until_received(SendFunction send, Subscriber& receiver)
+{
+  for (int ii = 0; ii < 50; ++ii) {
+    send();
+    auto response = receiver.receive(std::chrono::milliseconds(100), Receiver::s_any_size, true);
+    if (!response.data.empty()) {
+      return response;
+    }
+  }
+  BOOST_FAIL("No message received");
+  return {};
+}
+
 BOOST_AUTO_TEST_CASE(SendReceiveTest)
 {
   auto the_receiver = make_ipm_subscriber("ZmqSubscriber");
@@ -74,6 +92,50 @@ BOOST_AUTO_TEST_CASE(SendReceiveTest)
     [&](dunedaq::ipm::ReceiveTimeoutExpired) { return elapsed_time_milliseconds(before_recv) >= 2000; });
 }
 
+BOOST_AUTO_TEST_CASE(SegmentedSendTest)
+{
+  auto the_receiver = make_ipm_subscriber("ZmqSubscriber");
+  auto the_sender = make_ipm_sender("ZmqPublisher");
+  nlohmann::json config_json;
+  config_json["connection_string"] = "inproc://segments";
+  the_sender->connect_for_sends(config_json);
+  the_receiver->connect_for_receives(config_json);
+  the_receiver->subscribe("testTopic");
+
+  std::vector<char> header{ 'H', 'D', 'R' };
+  std::vector<char> payload{ 'P', 'A', 'Y', 'L', 'O', 'A', 'D' };
+  std::vector<Sender::Segment> segments{ { header.data(), 3 }, { payload.data(), 7 } };
+  auto response = resend_until_received(
+    [&]() { BOOST_REQUIRE(the_sender->send_segments(segments, Sender::s_no_block, "testTopic")); }, *the_receiver);
+  BOOST_REQUIRE_EQUAL(std::string(response.data.begin(), response.data.end()), "HDRPAYLOAD");
+  BOOST_REQUIRE_EQUAL(response.metadata, "testTopic");
+}
+
+BOOST_AUTO_TEST_CASE(SubscribeBeforeConnect)
+{
+  // The socket only exists once connected, so these are applied then
+  auto the_receiver = make_ipm_subscriber("ZmqSubscriber");
+  the_receiver->subscribe("testTopic");
+  the_receiver->subscribe("droppedTopic");
+  the_receiver->unsubscribe("droppedTopic");
+
+  auto the_sender = make_ipm_sender("ZmqPublisher");
+  nlohmann::json config_json;
+  config_json["connection_string"] = "inproc://subscribe_first";
+  the_sender->connect_for_sends(config_json);
+  the_receiver->connect_for_receives(config_json);
+
+  std::vector<char> test_data{ 'T', 'E', 'S', 'T' };
+  auto response = resend_until_received(
+    [&]() {
+      the_sender->send(test_data.data(), test_data.size(), Sender::s_no_block, "droppedTopic");
+      the_sender->send(test_data.data(), test_data.size(), Sender::s_no_block, "testTopic");
+    },
+    *the_receiver);
+  BOOST_REQUIRE_EQUAL(response.metadata, "testTopic");
+  BOOST_REQUIRE_EQUAL(response.data.size(), test_data.size());
+}
+
 BOOST_AUTO_TEST_CASE(CallbackTest)
 {
 
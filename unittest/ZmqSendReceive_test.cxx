@@ -13,7 +13,9 @@
 
 #include "boost/test/unit_test.hpp"
 
+#include <memory>
 #include <string>
+#include <thread>
 #include <vector>
 
 using namespace dunedaq::ipm;
@@ -48,6 +50,263 @@ BOOST_AUTO_TEST_CASE(SendReceiveTest)
   BOOST_REQUIRE_EQUAL(response.data[3], 'T');
 }
 
+BOOST_AUTO_TEST_CASE(ZeroCopySendTest)
+{
+  auto the_receiver = make_ipm_receiver("ZmqReceiver");
+  auto the_sender = make_ipm_sender("ZmqSender");
+
+  nlohmann::json empty_json = nlohmann::json::object();
+  the_receiver->connect_for_receives(empty_json);
+  the_sender->connect_for_sends(empty_json);
+
+  std::atomic<bool> buffer_released = false;
+  Sender::owned_buffer_t buffer(new char[4]{ 'T', 'E', 'S', 'T' }, [&](char* ptr) {
+    delete[] ptr; // NOLINT
+    buffer_released = true;
+  });
+
+  the_sender->send(std::move(buffer), 4, Sender::s_no_block);
+  auto response = the_receiver->receive(Receiver::s_block);
+  BOOST_REQUIRE_EQUAL(response.data.size(), 4);
+  BOOST_REQUIRE_EQUAL(response.data[0], 'T');
+  BOOST_REQUIRE_EQUAL(response.data[3], 'T');
+
+  while (!buffer_released.load()) {
+    usleep(1000);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(ResponseViewTest)
+{
+  auto the_receiver = make_ipm_receiver("ZmqReceiver");
+  auto the_sender = make_ipm_sender("ZmqSender");
+
+  nlohmann::json empty_json = nlohmann::json::object();
+  the_receiver->connect_for_receives(empty_json);
+  the_sender->connect_for_sends(empty_json);
+
+  std::vector<char> test_data{ 'T', 'E', 'S', 'T' };
+  the_sender->send(test_data.data(), test_data.size(), Sender::s_no_block, "meta");
+  auto view = the_receiver->receive_view(Receiver::s_block);
+  BOOST_REQUIRE_EQUAL(view.size(), 4);
+  BOOST_REQUIRE_EQUAL(std::string(view.data(), view.size()), "TEST");
+  BOOST_REQUIRE_EQUAL(view.metadata(), "meta");
+
+  std::atomic<bool> message_received = false;
+  the_receiver->register_view_callback([&](Receiver::ResponseView& res) {
+    BOOST_REQUIRE_EQUAL(std::string(res.data(), res.size()), "TEST");
+    message_received = true;
+  });
+  the_sender->send(test_data.data(), test_data.size(), Sender::s_no_block);
+  while (!message_received.load()) {
+    usleep(15000);
+  }
+  the_receiver->unregister_callback();
+}
+
+// Needs several GiB of memory, so it only runs when asked for:
+//   ZmqSendReceive_test --run_test=ZmqSendReceive_test/LargeMessageTest
+// Sender_test and ZmqSocketSender_test cover the handling of sizes bigger than INT_MAX in the default run.
+BOOST_AUTO_TEST_CASE(LargeMessageTest, *boost::unit_test::disabled())
+{
+  nlohmann::json config_json;
+  config_json["connection_string"] = "inproc://large";
+  auto the_receiver = make_ipm_receiver("ZmqReceiver");
+  auto the_sender = make_ipm_sender("ZmqSender");
+  the_receiver->connect_for_receives(config_json);
+  the_sender->connect_for_sends(config_json);
+
+  // Bigger than INT_MAX. The buffer is left uninitialized apart from a few markers, so that only the pages which are
+  // written to (and the copy ZMQ makes of a copied send) take up memory. The views avoid a copy on the receive side.
+  const Sender::message_size_t large_size = (size_t(1) << 31) + 16;
+  auto mark = [&](char* data) {
+    data[0] = 'F';
+    data[size_t(1) << 31] = 'M';
+    data[large_size - 1] = 'L';
+  };
+  auto check = [&](const char* data) {
+    BOOST_REQUIRE_EQUAL(data[0], 'F');
+    BOOST_REQUIRE_EQUAL(data[size_t(1) << 31], 'M');
+    BOOST_REQUIRE_EQUAL(data[large_size - 1], 'L');
+  };
+
+  {
+    std::unique_ptr<char[]> buffer(new char[large_size]); // NOLINT
+    mark(buffer.get());
+    BOOST_REQUIRE(the_sender->send(buffer.get(), large_size, Sender::s_block));
+  }
+  {
+    auto view = the_receiver->receive_view(Receiver::s_block, large_size);
+    BOOST_REQUIRE_EQUAL(view.size(), large_size);
+    check(view.data());
+  }
+
+  Sender::owned_buffer_t buffer(new char[large_size], [](char* ptr) { delete[] ptr; }); // NOLINT
+  mark(buffer.get());
+  BOOST_REQUIRE(the_sender->send(std::move(buffer), large_size, Sender::s_block));
+  auto view = the_receiver->receive_view(Receiver::s_block, large_size);
+  BOOST_REQUIRE_EQUAL(view.size(), large_size);
+  check(view.data());
+}
+
+BOOST_AUTO_TEST_CASE(BackPressureTest)
+{
+  auto the_sender = make_ipm_sender("ZmqSender");
+  nlohmann::json config_json;
+  config_json["connection_string"] = "tcp://127.0.0.1:29871";
+  the_sender->connect_for_sends(config_json);
+
+  std::vector<char> test_data{ 'T', 'E', 'S', 'T' };
+
+  // Nobody is listening yet, so the send has to wait out its timeout
+  auto before_send = std::chrono::steady_clock::now();
+  BOOST_REQUIRE_EXCEPTION(the_sender->send(test_data.data(), test_data.size(), std::chrono::milliseconds(100)),
+                          dunedaq::ipm::SendTimeoutExpired,
+                          [&](dunedaq::ipm::SendTimeoutExpired) {
+                            return std::chrono::steady_clock::now() - before_send >= std::chrono::milliseconds(100);
+                          });
+
+  // The send completes as soon as a receiver shows up, rather than at the end of its timeout
+  auto the_receiver = make_ipm_receiver("ZmqReceiver");
+  std::thread receiver_thread([&]() {
+    usleep(50000);
+    the_receiver->connect_for_receives(config_json);
+  });
+  before_send = std::chrono::steady_clock::now();
+  BOOST_REQUIRE(the_sender->send(test_data.data(), test_data.size(), std::chrono::milliseconds(5000)));
+  BOOST_REQUIRE_LT(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - before_send)
+                     .count(),
+                   2500);
+  receiver_thread.join();
+
+  auto response = the_receiver->receive(Receiver::s_block);
+  BOOST_REQUIRE_EQUAL(response.data.size(), 4);
+}
+
+BOOST_AUTO_TEST_CASE(SegmentedSendTest)
+{
+  auto the_receiver = make_ipm_receiver("ZmqReceiver");
+  auto the_sender = make_ipm_sender("ZmqSender");
+  nlohmann::json config_json;
+  config_json["connection_string"] = "inproc://segments";
+  the_receiver->connect_for_receives(config_json);
+  the_sender->connect_for_sends(config_json);
+
+  std::vector<char> header{ 'H', 'D', 'R' };
+  std::vector<char> payload{ 'P', 'A', 'Y', 'L', 'O', 'A', 'D' };
+  std::vector<Sender::Segment> segments{ { header.data(), 3 }, { nullptr, 0 }, { payload.data(), 7 } };
+  BOOST_REQUIRE(the_sender->send_segments(segments, Sender::s_no_block, "segmented"));
+
+  auto response = the_receiver->receive(Receiver::s_block);
+  BOOST_REQUIRE_EQUAL(std::string(response.data.begin(), response.data.end()), "HDRPAYLOAD");
+  BOOST_REQUIRE_EQUAL(response.metadata, "segmented");
+
+  // Single-segment messages following a segmented one are unaffected
+  BOOST_REQUIRE(the_sender->send_segments(segments, Sender::s_no_block));
+  BOOST_REQUIRE(the_sender->send(payload.data(), payload.size(), Sender::s_no_block));
+  auto view = the_receiver->receive_view(Receiver::s_block);
+  BOOST_REQUIRE_EQUAL(std::string_view(view.data(), view.size()), "HDRPAYLOAD");
+  view = the_receiver->receive_view(Receiver::s_block);
+  BOOST_REQUIRE_EQUAL(std::string_view(view.data(), view.size()), "PAYLOAD");
+}
+
+BOOST_AUTO_TEST_CASE(BatchSendTest)
+{
+  auto the_receiver = make_ipm_receiver("ZmqReceiver");
+  auto the_sender = make_ipm_sender("ZmqSender");
+  nlohmann::json config_json;
+  config_json["connection_string"] = "inproc://batch";
+  the_receiver->connect_for_receives(config_json);
+  the_sender->connect_for_sends(config_json);
+
+  std::vector<char> first{ 'O', 'N', 'E' };
+  std::vector<char> second{ 'T', 'W', 'O', '!' };
+  std::vector<Sender::BatchEntry> batch{ { first.data(), 3, "first" },
+                                         { nullptr, 0, "" },
+                                         { second.data(), 4, "second" } };
+  BOOST_REQUIRE_EQUAL(the_sender->send_batch(batch, Sender::s_no_block), 3);
+
+  auto response = the_receiver->receive(Receiver::s_block);
+  BOOST_REQUIRE_EQUAL(response.data.size(), 3);
+  BOOST_REQUIRE_EQUAL(response.metadata, "first");
+  response = the_receiver->receive(Receiver::s_block);
+  BOOST_REQUIRE_EQUAL(response.data.size(), 4);
+  BOOST_REQUIRE_EQUAL(response.metadata, "second");
+
+  // With nobody connected, nothing can be accepted within the timeout
+  auto unconnected_sender = make_ipm_sender("ZmqSender");
+  unconnected_sender->connect_for_sends({ { "connection_string", "tcp://127.0.0.1:29872" } });
+  BOOST_REQUIRE_EQUAL(unconnected_sender->send_batch(batch, std::chrono::milliseconds(10), true), 0);
+  BOOST_REQUIRE_EXCEPTION(unconnected_sender->send_batch(batch, std::chrono::milliseconds(10)),
+                          dunedaq::ipm::SendTimeoutExpired,
+                          [&](dunedaq::ipm::SendTimeoutExpired) { return true; });
+}
+
+BOOST_AUTO_TEST_CASE(ReceiveManyTest)
+{
+  auto the_receiver = make_ipm_receiver("ZmqReceiver");
+  auto the_sender = make_ipm_sender("ZmqSender");
+  nlohmann::json config_json;
+  config_json["connection_string"] = "inproc://receive_many";
+  the_receiver->connect_for_receives(config_json);
+  the_sender->connect_for_sends(config_json);
+
+  std::vector<Receiver::Response> responses;
+  BOOST_REQUIRE_EQUAL(the_receiver->receive_many(responses, 10, std::chrono::milliseconds(10), 0, true), 0);
+  BOOST_REQUIRE_EXCEPTION(the_receiver->receive_many(responses, 10, std::chrono::milliseconds(10)),
+                          dunedaq::ipm::ReceiveTimeoutExpired,
+                          [&](dunedaq::ipm::ReceiveTimeoutExpired) { return true; });
+
+  for (char ii = 0; ii < 5; ++ii) {
+    std::vector<char> test_data(ii + 1, ii);
+    the_sender->send(test_data.data(), test_data.size(), Sender::s_block, "many");
+  }
+
+  // At most max_count are taken; the rest stay queued for the next call
+  BOOST_REQUIRE_EQUAL(the_receiver->receive_many(responses, 3, Receiver::s_block), 3);
+  for (char ii = 0; ii < 3; ++ii) {
+    BOOST_REQUIRE_EQUAL(responses[ii].data.size(), static_cast<size_t>(ii + 1));
+    BOOST_REQUIRE_EQUAL(responses[ii].data[0], ii);
+    BOOST_REQUIRE_EQUAL(responses[ii].metadata, "many");
+  }
+  BOOST_REQUIRE_EQUAL(the_receiver->receive_many(responses, 3, Receiver::s_block), 2);
+  BOOST_REQUIRE_EQUAL(responses[1].data.size(), 5);
+}
+
+BOOST_AUTO_TEST_CASE(ReceiveIntoTest)
+{
+  auto the_receiver = make_ipm_receiver("ZmqReceiver");
+  auto the_sender = make_ipm_sender("ZmqSender");
+  nlohmann::json config_json;
+  config_json["connection_string"] = "inproc://receive_into";
+  the_receiver->connect_for_receives(config_json);
+  the_sender->connect_for_sends(config_json);
+
+  char buffer[8] = {};
+  auto result = the_receiver->receive_into(buffer, sizeof(buffer), std::chrono::milliseconds(10), 0, true);
+  BOOST_REQUIRE_EQUAL(result.size, 0);
+  BOOST_REQUIRE(result.metadata.empty());
+
+  std::string test_data = "TEST";
+  the_sender->send(test_data.data(), test_data.size(), Sender::s_block, "into");
+  result = the_receiver->receive_into(buffer, sizeof(buffer), Receiver::s_block);
+  BOOST_REQUIRE_EQUAL(result.size, 4);
+  BOOST_REQUIRE(!result.truncated);
+  BOOST_REQUIRE_EQUAL(result.metadata, "into");
+  BOOST_REQUIRE_EQUAL(std::string(buffer, result.size), test_data);
+
+  test_data = "A MESSAGE LONGER THAN THE BUFFER";
+  the_sender->send(test_data.data(), test_data.size(), Sender::s_block);
+  result = the_receiver->receive_into(buffer, sizeof(buffer), Receiver::s_block);
+  BOOST_REQUIRE_EQUAL(result.size, test_data.size());
+  BOOST_REQUIRE(result.truncated);
+  BOOST_REQUIRE_EQUAL(std::string(buffer, sizeof(buffer)), test_data.substr(0, sizeof(buffer)));
+
+  // The truncated message has been consumed
+  result = the_receiver->receive_into(buffer, sizeof(buffer), std::chrono::milliseconds(10), 0, true);
+  BOOST_REQUIRE_EQUAL(result.size, 0);
+}
+
 BOOST_AUTO_TEST_CASE(CallbackTest)
 {
 
@@ -0,0 +1,115 @@
+/**
+ * @file ZmqSocketOptions_test.cxx ZmqSocketOptions class Unit Tests
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "ZmqSocketOptions.hpp"
+#include "ipm/Receiver.hpp"
+#include "ipm/Sender.hpp"
+#include "ipm/ZmqContext.hpp"
+
+#define BOOST_TEST_MODULE ZmqSocketOptions_test // NOLINT
+
+#include "boost/test/unit_test.hpp"
+
+#include <string>
+#include <vector>
+
+using namespace dunedaq::ipm;
+
+BOOST_AUTO_TEST_SUITE(ZmqSocketOptions_test)
+
+BOOST_AUTO_TEST_CASE(Parsing)
+{
+  auto options = ZmqSocketOptions::from_connection_info(nlohmann::json::object());
+  BOOST_REQUIRE_EQUAL(options.preset, "default");
+  BOOST_REQUIRE(!options.sndhwm);
+  BOOST_REQUIRE(!options.rcvbuf);
+
+  // Explicit options override the preset
+  options = ZmqSocketOptions::from_connection_info(
+    { { "socket_options", { { "preset", "bulk" }, { "sndhwm", 50 }, { "maxmsgsize", 1048576 } } } });
+  BOOST_REQUIRE_EQUAL(options.preset, "bulk");
+  BOOST_REQUIRE_EQUAL(*options.sndhwm, 50);
+  BOOST_REQUIRE_EQUAL(*options.rcvhwm, *ZmqSocketOptions::from_preset("bulk").rcvhwm);
+  BOOST_REQUIRE_EQUAL(*options.maxmsgsize, 1048576);
+  BOOST_REQUIRE_EQUAL(*options.tcp_keepalive, 1);
+
+  options = ZmqSocketOptions::from_connection_info({ { "socket_options", { { "preset", "low-latency" } } } });
+  BOOST_REQUIRE(options.sndhwm);
+  BOOST_REQUIRE(!options.sndbuf);
+}
+
+BOOST_AUTO_TEST_CASE(Validation)
+{
+  std::vector<nlohmann::json> invalid{
+    { { "socket_options", 1000 } },
+    { { "socket_options", { { "preset", "fastest" } } } },
+    { { "socket_options", { { "preset", 1 } } } },
+    { { "socket_options", { { "sndhmw", 1000 } } } },
+    { { "socket_options", { { "sndhwm", "1000" } } } },
+    { { "socket_options", { { "sndhwm", 10.5 } } } },
+    { { "socket_options", { { "sndhwm", -1 } } } },
+    { { "socket_options", { { "sndbuf", 4294967296 } } } },
+    { { "socket_options", { { "tcp_keepalive", 2 } } } },
+    { { "socket_options", { { "maxmsgsize", 18446744073709551615ULL } } } },
+  };
+  for (auto& connection_info : invalid) {
+    BOOST_TEST_CONTEXT(connection_info.dump())
+    {
+      BOOST_REQUIRE_EXCEPTION(ZmqSocketOptions::from_connection_info(connection_info),
+                              dunedaq::ipm::InvalidSocketOption,
+                              [&](dunedaq::ipm::InvalidSocketOption) { return true; });
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(ApplyAndReadBack)
+{
+  zmq::socket_t socket(ZmqContext::instance().GetContext(), zmq::socket_type::push);
+  auto defaults = ZmqSocketOptions().effective(socket);
+
+  auto options = ZmqSocketOptions::from_connection_info(
+    { { "socket_options", { { "preset", "bulk" }, { "sndhwm", 1234 }, { "maxmsgsize", 65536 } } } });
+  options.apply(socket);
+  auto info = options.effective(socket);
+  BOOST_REQUIRE_EQUAL(info.preset(), "bulk");
+  BOOST_REQUIRE_EQUAL(info.sndhwm(), 1234);
+  BOOST_REQUIRE_EQUAL(info.rcvhwm(), *options.rcvhwm);
+  BOOST_REQUIRE_EQUAL(info.maxmsgsize(), 65536);
+  BOOST_REQUIRE_EQUAL(info.tcp_keepalive(), 1);
+  BOOST_REQUIRE_EQUAL(info.tcp_keepalive_idle(), *options.tcp_keepalive_idle);
+  BOOST_REQUIRE_NE(info.sndhwm(), defaults.sndhwm());
+  socket.close();
+}
+
+BOOST_AUTO_TEST_CASE(PluginsRejectInvalidOptions)
+{
+  nlohmann::json bad_options = { { "socket_options", { { "rcvhwm", -5 } } } };
+  BOOST_REQUIRE_EXCEPTION(make_ipm_receiver("ZmqReceiver")->connect_for_receives(bad_options),
+                          dunedaq::ipm::InvalidSocketOption,
+                          [&](dunedaq::ipm::InvalidSocketOption) { return true; });
+  BOOST_REQUIRE_EXCEPTION(make_ipm_sender("ZmqSender")->connect_for_sends(bad_options),
+                          dunedaq::ipm::InvalidSocketOption,
+                          [&](dunedaq::ipm::InvalidSocketOption) { return true; });
+}
+
+BOOST_AUTO_TEST_CASE(SendReceiveWithOptions)
+{
+  auto the_receiver = make_ipm_receiver("ZmqReceiver");
+  auto the_sender = make_ipm_sender("ZmqSender");
+  auto endpoint = the_receiver->connect_for_receives(
+    { { "connection_string", "tcp://127.0.0.1:*" }, { "socket_options", { { "preset", "bulk" } } } });
+  the_sender->connect_for_sends(
+    { { "connection_string", endpoint }, { "socket_options", { { "preset", "low-latency" }, { "sndbuf", -1 } } } });
+
+  std::vector<char> test_data{ 'T', 'E', 'S', 'T' };
+  the_sender->send(test_data.data(), test_data.size(), Sender::s_block);
+  auto response = the_receiver->receive(Receiver::s_block);
+  BOOST_REQUIRE_EQUAL(response.data.size(), 4);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,184 @@
+/**
+ * @file ZmqSocketSender_test.cxx ZmqSocketSender class Unit Tests
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "ZmqSocketSender.hpp"
+#include "ipm/Sender.hpp"
+#include "ipm/ZmqContext.hpp"
+
+#define BOOST_TEST_MODULE ZmqSocketSender_test // NOLINT
+
+#include "boost/test/unit_test.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <string>
+#include <vector>
+
+using namespace dunedaq::ipm;
+
+BOOST_AUTO_TEST_SUITE(ZmqSocketSender_test)
+
+namespace {
+
+class SenderImpl : public Sender
+{
+public:
+  std::string connect_for_sends(const nlohmann::json& /* connection_info */) override { return ""; }
+  bool can_send() const noexcept override { return true; }
+
+protected:
+  bool send_(const void* /* message */,
+             message_size_t /* N */,
+             const duration_t& /* timeout */,
+             const std::string& /* metadata */,
+             bool /*no_tmoexcept_mode*/) override
+  {
+    return true;
+  }
+};
+
+// Refuses frames as though the socket stopped accepting them part of the way through a message
+class RefusingSocketSender : public ZmqSocketSender
+{
+public:
+  using ZmqSocketSender::ZmqSocketSender;
+
+  // Refuse the frame_index'th frame passed to the socket (counting from 0), and the following count - 1 attempts
+  void refuse(size_t frame_index, size_t count)
+  {
+    m_refuse_at = frame_index;
+    m_refuse_count = count;
+  }
+  size_t frames_attempted() const { return m_frames; }
+
+protected:
+  zmq::send_result_t send_frame(zmq::message_t& frame, zmq::send_flags flags) override
+  {
+    if (m_frames++ >= m_refuse_at && m_refuse_count > 0) {
+      --m_refuse_count;
+      return {};
+    }
+    return ZmqSocketSender::send_frame(frame, flags);
+  }
+
+private:
+  size_t m_frames{ 0 };
+  size_t m_refuse_at{ 0 };
+  size_t m_refuse_count{ 0 };
+};
+
+// Takes every frame without passing it to the socket, reporting at most INT_MAX bytes sent as ZMQ does. The frame data
+// is never read, so its size can be bigger than the buffer behind it.
+class SwallowingSocketSender : public ZmqSocketSender
+{
+public:
+  using ZmqSocketSender::ZmqSocketSender;
+
+  std::vector<size_t> frame_sizes;
+
+protected:
+  zmq::send_result_t send_frame(zmq::message_t& frame, zmq::send_flags /* flags */) override
+  {
+    frame_sizes.push_back(frame.size());
+    return std::min(frame.size(), size_t(std::numeric_limits<int>::max()));
+  }
+};
+
+// Receive every frame of the next message
+std::vector<std::string>
+receive_frames(zmq::socket_t& socket)
+{
+  std::vector<std::string> frames;
+  zmq::message_t frame;
+  do {
+    BOOST_REQUIRE(socket.recv(frame));
+    frames.emplace_back(static_cast<const char*>(frame.data()), frame.size());
+  } while (frame.more());
+  return frames;
+}
+
+struct SocketPair
+{
+  SocketPair()
+  {
+    pull.bind("inproc://zmq_socket_sender_test");
+    push.connect("inproc://zmq_socket_sender_test");
+    pull.set(zmq::sockopt::rcvtimeo, 1000);
+  }
+
+  zmq::context_t context;
+  zmq::socket_t pull{ context, zmq::socket_type::pull };
+  zmq::socket_t push{ context, zmq::socket_type::push };
+  std::string endpoint{ "inproc://zmq_socket_sender_test" };
+};
+
+} // namespace ""
+
+BOOST_AUTO_TEST_CASE(RefusedTopicFrame)
+{
+  SocketPair sockets;
+  SenderImpl sender;
+  RefusingSocketSender socket_sender(sender, sockets.push, sockets.endpoint);
+
+  // Nothing is queued yet, so the whole message is sent again
+  socket_sender.refuse(0, 2);
+  BOOST_REQUIRE(socket_sender.send("DATA", 4, std::chrono::milliseconds(1000), "topic", false));
+  BOOST_REQUIRE_EQUAL(socket_sender.frames_attempted(), 4);
+  BOOST_REQUIRE(receive_frames(sockets.pull) == std::vector<std::string>({ "topic", "DATA" }));
+}
+
+BOOST_AUTO_TEST_CASE(PartialMultipartMessage)
+{
+  SocketPair sockets;
+  SenderImpl sender;
+  RefusingSocketSender socket_sender(sender, sockets.push, sockets.endpoint);
+
+  // The topic frame and first segment are queued before the second segment is refused; the send resumes from it
+  socket_sender.refuse(2, 3);
+  std::vector<Sender::Segment> segments{ { "AAA", 3 }, { "BBB", 3 }, { "CCC", 3 } };
+  BOOST_REQUIRE(socket_sender.send_segments(segments.data(), segments.size(), 9, Sender::s_block, "topic", false));
+  BOOST_REQUIRE_EQUAL(socket_sender.frames_attempted(), 7);
+  BOOST_REQUIRE(receive_frames(sockets.pull) == std::vector<std::string>({ "topic", "AAA", "BBB", "CCC" }));
+
+  // The socket is left between messages, so the next one is framed correctly
+  BOOST_REQUIRE(socket_sender.send("NEXT", 4, Sender::s_no_block, "other", false));
+  BOOST_REQUIRE(receive_frames(sockets.pull) == std::vector<std::string>({ "other", "NEXT" }));
+}
+
+BOOST_AUTO_TEST_CASE(PartialMultipartTimeout)
+{
+  SocketPair sockets;
+  SenderImpl sender;
+  RefusingSocketSender socket_sender(sender, sockets.push, sockets.endpoint);
+
+  // A message which cannot be completed is not reported as a timeout, as the socket has been left mid-message
+  socket_sender.refuse(1, size_t(-1));
+  BOOST_REQUIRE_EXCEPTION(socket_sender.send("DATA", 4, std::chrono::milliseconds(10), "topic", true),
+                          ZmqSendError,
+                          [&](ZmqSendError) { return true; });
+}
+
+BOOST_AUTO_TEST_CASE(FrameLargerThanIntMax)
+{
+  SocketPair sockets;
+  SenderImpl sender;
+  std::vector<size_t> sent_sizes;
+  SwallowingSocketSender socket_sender(
+    sender, sockets.push, sockets.endpoint, [&](std::string_view, size_t N) { sent_sizes.push_back(N); });
+
+  // The buffer is handed to ZMQ without a copy, so a small one can stand in for it
+  const size_t large_size = (size_t(1) << 31) + 16;
+  char data[4] = { 'T', 'E', 'S', 'T' };
+  Sender::owned_buffer_t buffer(data, [](char*) {});
+  BOOST_REQUIRE(socket_sender.send_owned(std::move(buffer), large_size, Sender::s_no_block, "topic", false));
+  BOOST_REQUIRE(socket_sender.frame_sizes == std::vector<size_t>({ 5, large_size }));
+  BOOST_REQUIRE(sent_sizes == std::vector<size_t>({ large_size }));
+}
+
+BOOST_AUTO_TEST_SUITE_END()